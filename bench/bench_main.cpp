@@ -0,0 +1,215 @@
+/*
+ * Микробенчмарки ядра для запуска под simavr (env:bench).
+ *
+ * Системный тик переносится на Timer2, Timer1 работает без предделителя
+ * и вместе со счётчиком переполнений даёт 32-битный счётчик тактов CPU.
+ * Каждая операция замеряется отдельно; минимум не содержит прерываний
+ * тика, среднее и максимум - содержат. Из результатов вычтены накладные
+ * расходы самого замера.
+ *
+ * Формат вывода (разбирается tools/bench.py):
+ *   BENCH <имя> <повторы> <мин> <среднее> <макс>
+ *   MEM <свободно байт>
+ *   BENCH_DONE
+ * После вывода CPU засыпает с запрещёнными прерываниями, и simavr
+ * завершает работу.
+ */
+
+#include <avr/sleep.h>
+#include "kernel/kernel.h"
+#include "fs/fs.h"
+#include "fs/logger.h"
+#include "driver/timer.h"
+#include "driver/gpio.h"
+#include "system/monitor.h"
+
+namespace
+{
+    volatile uint16_t overflows = 0;
+    volatile uint32_t sink = 0;
+    uint32_t overhead = 0;
+
+    GPIO benchPin(12);
+    String payload32("0123456789abcdef0123456789abcdef");
+
+    struct Benchmark
+    {
+        const char* name;           // В PROGMEM
+        void (*run)();
+        void (*setup)();            // Вызывается один раз перед замерами, может быть nullptr
+        void (*prepare)();          // Вызывается перед каждым повтором вне замера, может быть nullptr
+        uint16_t reps;
+    };
+
+    /**
+     * @brief Текущее значение 32-битного счётчика тактов
+     */
+    inline uint32_t cycles()
+    {
+        uint8_t sreg = SREG;
+        cli();
+        uint16_t lo = TCNT1;
+        uint16_t hi = overflows;
+        if ((TIFR1 & (1 << TOV1)) && lo < 0x8000) hi++;
+        SREG = sreg;
+        return ((uint32_t)hi << 16) | lo;
+    }
+
+    // Четыре разные функции: планировщик не принимает одну задачу дважды
+    void task0() {}
+    void task1() {}
+    void task2() {}
+    void task3() {}
+    void (*const tasks[])() = {task0, task1, task2, task3};
+
+    // Задачи с большим периодом: run() только проверяет готовность
+    void addIdleTasks()
+    {
+        for (uint8_t t = 0; t < 4; t++) kernel.addTask(tasks[t], 60000UL, t);
+    }
+
+    // Период 1 мс: после waitTick() готовы все задачи
+    void makeTasksDue()
+    {
+        for (uint8_t t = 0; t < 4; t++) kernel.setPeriod(tasks[t], 1);
+    }
+
+    // Ожидание начала новой миллисекунды: все задачи с периодом 1 мс готовы
+    void waitTick()
+    {
+        uint32_t now = sysTimer.millis();
+        while (sysTimer.millis() == now) {}
+    }
+
+    void benchNothing() {}
+    void benchMillis() { sink += sysTimer.millis(); }
+    void benchMicros() { sink += sysTimer.micros(); }
+    void benchUptime() { sink += (uint32_t)sysTimer.uptimeMicros(); }
+    void benchRun() { kernel.run(); }
+    void benchFsWrite() { sink += fs.writeFile("bench.txt", payload32); }
+    void benchFsRead() { sink += fs.readFile("bench.txt").length(); }
+    void benchFsExists() { sink += fs.fileExists("bench.txt"); }
+    void benchLog() { logger.log("bench"); }
+    void benchLogRecord() { LOG_MSG(MSG_TASK_OVERRUN, 3); }
+    void benchGpioWrite() { benchPin.toggle(); }
+
+    const char nameMillis[] PROGMEM = "timer_millis";
+    const char nameMicros[] PROGMEM = "timer_micros";
+    const char nameUptime[] PROGMEM = "timer_uptime";
+    const char nameRunIdle[] PROGMEM = "sched_run_idle";
+    const char nameRunDue[] PROGMEM = "sched_run_due";
+    const char nameFsWrite[] PROGMEM = "fs_write_32";
+    const char nameFsRead[] PROGMEM = "fs_read_32";
+    const char nameFsExists[] PROGMEM = "fs_exists";
+    const char nameLog[] PROGMEM = "logger_log";
+    const char nameLogRecord[] PROGMEM = "logger_record";
+    const char nameGpio[] PROGMEM = "gpio_toggle";
+
+    // Порядок важен: sched_run_due переводит задачи sched_run_idle на период 1 мс
+    const Benchmark benchmarks[] =
+    {
+        {nameMillis,   benchMillis,    nullptr,      nullptr,  200},
+        {nameMicros,   benchMicros,    nullptr,      nullptr,  200},
+        {nameUptime,   benchUptime,    nullptr,      nullptr,  200},
+        {nameRunIdle,  benchRun,       addIdleTasks, nullptr,  200},
+        {nameRunDue,   benchRun,       makeTasksDue, waitTick, 50},
+        {nameFsWrite,  benchFsWrite,   nullptr,      nullptr,  100},
+        {nameFsRead,   benchFsRead,    nullptr,      nullptr,  100},
+        {nameFsExists, benchFsExists,  nullptr,      nullptr,  100},
+        {nameLog,      benchLog,       nullptr,      nullptr,  20},
+        {nameLogRecord, benchLogRecord, nullptr,     nullptr,  20},
+        {nameGpio,     benchGpioWrite, nullptr,      nullptr,  200},
+    };
+
+    /**
+     * @brief Замер одной операции
+     * @return Такты без накладных расходов замера
+     */
+    uint32_t measure(void (*run)())
+    {
+        uint32_t start = cycles();
+        run();
+        uint32_t elapsed = cycles() - start;
+        return (elapsed > overhead) ? elapsed - overhead : 0;
+    }
+
+    void runBenchmark(const Benchmark& b)
+    {
+        if (b.setup) b.setup();
+        uint32_t minCycles = 0xFFFFFFFFUL, maxCycles = 0, total = 0;
+        for (uint16_t i = 0; i < b.reps; i++)
+        {
+            if (b.prepare) b.prepare();
+            uint32_t c = measure(b.run);
+            if (c < minCycles) minCycles = c;
+            if (c > maxCycles) maxCycles = c;
+            total += c;
+        }
+
+        Serial.print(F("BENCH "));
+        Serial.print((const __FlashStringHelper*)b.name);
+        Serial.print(' ');
+        Serial.print(b.reps);
+        Serial.print(' ');
+        Serial.print(minCycles);
+        Serial.print(' ');
+        Serial.print(total / b.reps);
+        Serial.print(' ');
+        Serial.println(maxCycles);
+        Serial.flush();
+    }
+}
+
+ISR(TIMER1_OVF_vect)
+{
+    overflows++;
+}
+
+void setup()
+{
+    Serial.begin(115200);
+
+    sysTimer.begin(HwTimers::TIMER_2);
+    logger.begin();
+    benchPin.setMode(GPIO::GPIO_OUTPUT);
+    fs.createFile("bench.txt", payload32);
+
+    // Timer1: нормальный режим без предделителя, прерывание по переполнению
+    HwTimers::acquire(HwTimers::TIMER_1, HwTimers::OWNER_BENCH);
+    noInterrupts();
+    TCCR1A = 0;
+    TCCR1B = (1 << CS10);
+    TCNT1 = 0;
+    TIFR1 = (1 << TOV1);
+    TIMSK1 = (1 << TOIE1);
+    interrupts();
+
+    // Накладные расходы замера: минимум по пустой операции
+    overhead = 0;
+    uint32_t best = 0xFFFFFFFFUL;
+    for (uint8_t i = 0; i < 50; i++)
+    {
+        uint32_t c = measure(benchNothing);
+        if (c < best) best = c;
+    }
+    overhead = best;
+
+    for (uint8_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        runBenchmark(benchmarks[i]);
+    }
+
+    Serial.print(F("MEM "));
+    Serial.println(SystemMonitor::freeMemory());
+    Serial.println(F("BENCH_DONE"));
+    Serial.flush();
+
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sleep_cpu();
+}
+
+void loop()
+{
+}
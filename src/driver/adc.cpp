@@ -0,0 +1,210 @@
+#include "adc.h"
+#include "system/irqstats.h"
+
+Adc sysAdc;
+
+// Обработчик завершения преобразования
+ISR(ADC_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_ADC);
+    sysAdc.onConversion();
+    IRQ_EXIT(IrqStats::VEC_ADC);
+}
+
+/**
+ * @brief Конструктор
+ */
+Adc::Adc() : _count(0), _seq(0), _current(0), _settle(0), _vccChannel(-1), _mode(ADC_TIMER0)
+{
+}
+
+/**
+ * @brief Добавление канала в список опроса
+ * @param mux Номер входа (0-7 для A0-A7, CHANNEL_BANDGAP для 1.1 В;
+ *            до MAX_MUX)
+ * @param iirShift Постоянная IIR-фильтра (больше - сильнее сглаживание)
+ * @param settle Сколько преобразований отбросить после переключения на канал
+ * @return Индекс канала или -1 при ошибке
+ */
+int8_t Adc::addChannel(uint8_t mux, uint8_t iirShift, uint8_t settle)
+{
+    if (_count >= MAX_CHANNELS || mux > MAX_MUX || iirShift > IIR_FRACTION + 4) return -1;
+
+    uint8_t ch = _count;
+    Channel& c = _channels[ch];
+    c.mux = mux;
+    c.shift = iirShift;
+    c.settle = settle;
+    c.pos = 0;
+    c.filled = 0;
+    c.sum = 0;
+    c.iir = 0;
+    for (uint8_t i = 0; i < RING_SIZE; i++) c.ring[i] = 0;
+
+    if (mux == CHANNEL_BANDGAP && _vccChannel < 0) _vccChannel = ch;
+    _count = ch + 1;
+    return ch;
+}
+
+/**
+ * @brief Запуск фоновой выборки
+ * @param mode Режим запуска преобразований
+ */
+void Adc::begin(Mode mode)
+{
+    if (_count == 0) return;
+
+    IRQ_LOCK();
+    _mode = mode;
+    // Источник запуска: переполнение Timer0. ADCSRB записывается до
+    // select(), который на Mega меняет в нём бит MUX5
+    ADCSRB = (mode == ADC_TIMER0) ? (1 << ADTS2) : 0;
+    select(0);
+    // Опора AVcc, предделитель 128 (125 кГц при 16 МГц)
+    ADCSRA = (1 << ADEN) | (1 << ADIE) | (1 << ADIF) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+    if (mode == ADC_TIMER0)
+    {
+        ADCSRA |= (1 << ADATE);
+    }
+    else
+    {
+        ADCSRA |= (1 << ADSC);
+    }
+    IRQ_UNLOCK();
+}
+
+/**
+ * @brief Остановка фоновой выборки
+ */
+void Adc::end()
+{
+    ADCSRA &= ~((1 << ADIE) | (1 << ADATE));
+}
+
+/**
+ * @brief Переключение мультиплексора на канал
+ */
+void Adc::select(uint8_t ch)
+{
+    _current = ch;
+    _settle = _channels[ch].settle;
+    uint8_t mux = _channels[ch].mux;
+#ifdef MUX5
+    if (mux & 0x20) ADCSRB |= (1 << MUX5);
+    else ADCSRB &= ~(1 << MUX5);
+    ADMUX = (1 << REFS0) | (mux & 0x1F);
+#else
+    ADMUX = (1 << REFS0) | (mux & 0x0F);
+#endif
+}
+
+/**
+ * @brief Обработка результата преобразования (из ISR)
+ */
+void Adc::onConversion()
+{
+    uint16_t value = ADC;
+
+    if (_settle > 0)
+    {
+        _settle--;
+    }
+    else
+    {
+        Channel& c = _channels[_current];
+        c.sum += value - c.ring[c.pos];
+        c.ring[c.pos] = value;
+        c.pos = (c.pos + 1) & (RING_SIZE - 1);
+
+        int32_t target = (int32_t)value << IIR_FRACTION;
+        if (c.filled == 0) c.iir = target;
+        else c.iir += (target - (int32_t)c.iir) >> c.shift;
+        if (c.filled < RING_SIZE) c.filled++;
+        _seq++;
+
+        uint8_t next = _current + 1;
+        if (next >= _count) next = 0;
+        if (next != _current) select(next);
+    }
+
+    if (_mode == ADC_CONTINUOUS) ADCSRA |= (1 << ADSC);
+}
+
+/**
+ * @brief Согласованное чтение поля, изменяемого в ISR
+ */
+template <typename T>
+T Adc::read(const T& field) const
+{
+    T value;
+    uint8_t seq;
+    do
+    {
+        seq = _seq;
+        value = field;
+    } while (seq != _seq);
+    return value;
+}
+
+/**
+ * @brief Последнее значение канала
+ * @param ch Индекс канала
+ * @return Код АЦП (0-1023)
+ */
+uint16_t Adc::latest(uint8_t ch) const
+{
+    if (ch >= _count) return 0;
+    const Channel& c = _channels[ch];
+    uint8_t seq;
+    uint16_t value;
+    do
+    {
+        seq = _seq;
+        value = c.ring[(c.pos - 1) & (RING_SIZE - 1)];
+    } while (seq != _seq);
+    return value;
+}
+
+/**
+ * @brief Среднее по кольцевому буферу
+ * @param ch Индекс канала
+ * @return Код АЦП (0-1023)
+ */
+uint16_t Adc::average(uint8_t ch) const
+{
+    if (ch >= _count) return 0;
+    return read(_channels[ch].sum) / RING_SIZE;
+}
+
+/**
+ * @brief Значение после IIR-фильтра
+ * @param ch Индекс канала
+ * @return Код АЦП в формате Q10.6 (код * 64)
+ */
+uint16_t Adc::filtered(uint8_t ch) const
+{
+    if (ch >= _count) return 0;
+    return read(_channels[ch].iir);
+}
+
+/**
+ * @brief Заполнен ли буфер канала
+ * @param ch Индекс канала
+ */
+bool Adc::isReady(uint8_t ch) const
+{
+    return ch < _count && _channels[ch].filled >= RING_SIZE;
+}
+
+/**
+ * @brief Напряжение питания по каналу 1.1 В
+ * @return Vcc в мВ или 0, если канал не настроен или ещё не измерен
+ */
+uint16_t Adc::vccMillivolts() const
+{
+    if (_vccChannel < 0 || _channels[_vccChannel].filled == 0) return 0;
+    uint16_t iir = filtered(_vccChannel);
+    if (iir == 0) return 0;
+    // Vcc = 1.1 В * 1024 / код, код в Q10.6
+    return ((uint32_t)BANDGAP_MV * 1024UL << IIR_FRACTION) / iir;
+}
@@ -0,0 +1,77 @@
+#ifndef ADC_H
+#define ADC_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Фоновая выборка АЦП по прерыванию
+ *
+ * Каналы из списка опрашиваются по кругу из обработчика ADC_vect, каждый
+ * результат попадает в кольцевой буфер канала с бегущей суммой и в
+ * IIR-фильтр в формате Q10.6. Чтение значения - это копирование нескольких
+ * байт без ожидания преобразования. Не использовать вместе с analogRead().
+ */
+class Adc
+{
+public:
+    enum Mode
+    {
+        ADC_CONTINUOUS,   // Следующее преобразование запускается сразу из ISR
+        ADC_TIMER0        // Автозапуск по переполнению Timer0 (~1 кГц)
+    };
+
+    static const uint8_t MAX_CHANNELS = 4;
+    static const uint8_t RING_SIZE = 8;        // Степень двойки
+    static const uint8_t IIR_FRACTION = 6;     // Дробных бит фильтра
+#ifdef MUX5
+    // ATmega2560: MUX5 в ADCSRB, входы A8-A15 - 0x20-0x27
+    static const uint8_t CHANNEL_BANDGAP = 0x1E; // Внутренний источник 1.1 В
+    static const uint8_t MAX_MUX = 0x3F;
+#else
+    static const uint8_t CHANNEL_BANDGAP = 14; // Внутренний источник 1.1 В
+    static const uint8_t MAX_MUX = 15;
+#endif
+    static const uint16_t BANDGAP_MV = 1100;
+
+    Adc();
+
+    int8_t addChannel(uint8_t mux, uint8_t iirShift = 3, uint8_t settle = 1);
+    void begin(Mode mode = ADC_TIMER0);
+    void end();
+
+    uint16_t latest(uint8_t ch) const;
+    uint16_t average(uint8_t ch) const;
+    uint16_t filtered(uint8_t ch) const;
+    bool isReady(uint8_t ch) const;
+    uint16_t vccMillivolts() const;
+
+    void onConversion();
+
+private:
+    struct Channel
+    {
+        uint8_t mux;
+        uint8_t shift;              // Постоянная IIR-фильтра: y += (x - y) >> shift
+        uint8_t settle;             // Отбрасываемых преобразований после переключения
+        uint8_t pos;
+        uint8_t filled;
+        uint16_t ring[RING_SIZE];
+        uint16_t sum;               // Сумма кольцевого буфера
+        uint16_t iir;               // Q10.6
+    };
+
+    Channel _channels[MAX_CHANNELS];
+    volatile uint8_t _count;
+    volatile uint8_t _seq;          // Номер выборки для согласованного чтения
+    uint8_t _current;
+    uint8_t _settle;
+    int8_t _vccChannel;
+    Mode _mode;
+
+    void select(uint8_t ch);
+    template <typename T> T read(const T& field) const;
+};
+
+extern Adc sysAdc;
+
+#endif
@@ -1,4 +1,31 @@
 #include "gpio.h"
+#include "driver/hwtimer.h"
+#include "system/irqstats.h"
+#ifdef __AVR__
+#include "driver/softpwm.h"
+#endif
+
+#if defined(OS_IRQ_STATS) && defined(__AVR__)
+namespace
+{
+    // Пользовательские обработчики INT0/INT1, вызываемые через замеряющие обёртки
+    void (*userHandlers[2])() = {nullptr, nullptr};
+
+    void int0Handler()
+    {
+        IRQ_ENTER(IrqStats::VEC_INT0);
+        userHandlers[0]();
+        IRQ_EXIT(IrqStats::VEC_INT0);
+    }
+
+    void int1Handler()
+    {
+        IRQ_ENTER(IrqStats::VEC_INT1);
+        userHandlers[1]();
+        IRQ_EXIT(IrqStats::VEC_INT1);
+    }
+}
+#endif
 
 /**
  * @brief Конструктор
@@ -17,20 +44,26 @@ void GPIO::setMode(PinMode mode)
 {
     if(_pin > 13) return;
     
+#ifdef __AVR__
+    if(_current_mode == GPIO_PWM && mode != GPIO_PWM) 
+    {
+        softPwm.detach(_pin);
+    }
+#endif
     _current_mode = mode;
     switch(mode) 
     {
         case GPIO_INPUT:
-            pinMode(_pin, INPUT);
+            hal::pinMode(_pin, INPUT);
             break;
         case GPIO_OUTPUT:
-            pinMode(_pin, OUTPUT);
+            hal::pinMode(_pin, OUTPUT);
             break;
         case GPIO_INPUT_PULLUP:
-            pinMode(_pin, INPUT_PULLUP);
+            hal::pinMode(_pin, INPUT_PULLUP);
             break;
         case GPIO_PWM:
-            pinMode(_pin, OUTPUT);
+            hal::pinMode(_pin, OUTPUT);
             break;
     }
 }
@@ -42,16 +75,7 @@ void GPIO::setMode(PinMode mode)
 void GPIO::write(bool state) 
 {
     if(_current_mode != GPIO_OUTPUT) return;
-    if(_pin < 8) 
-    {
-        if(state) PORTD |= (1 << _pin);
-        else PORTD &= ~(1 << _pin);
-    } 
-    else 
-    {
-        if(state) PORTB |= (1 << (_pin - 8));
-        else PORTB &= ~(1 << (_pin - 8));
-    }
+    hal::pinWrite(_pin, state);
 }
 
 /**
@@ -60,7 +84,7 @@ void GPIO::write(bool state)
  */
 bool GPIO::read() 
 {
-    return digitalRead(_pin);
+    return hal::pinRead(_pin);
 }
 
 /**
@@ -75,11 +99,31 @@ void GPIO::toggle()
 /**
  * @brief Устанавливает PWM сигнал
  * @param duty Коэффициент заполнения (0-255)
+ * @return true если сигнал установлен
+ *
+ * Если таймер пина свободен, используется аппаратный ШИМ (analogWrite),
+ * иначе - программный ШИМ (softPwm).
  */
-void GPIO::setPWM(uint8_t duty) 
+bool GPIO::setPWM(uint8_t duty) 
 {
-    if(_current_mode != GPIO_PWM) return; 
-    analogWrite(_pin, duty);
+    if(_current_mode != GPIO_PWM) return false; 
+#ifdef __AVR__
+    if(HwTimers::hardwarePwmAvailable(_pin)) 
+    {
+        int8_t timer = HwTimers::timerForPin(_pin);
+        if(timer == HwTimers::TIMER_1 || timer == HwTimers::TIMER_2) 
+        {
+            HwTimers::acquire((HwTimers::Id)timer, HwTimers::OWNER_PWM);
+        }
+        analogWrite(_pin, duty);
+        return true;
+    }
+    return softPwm.set(_pin, duty);
+#else
+    // В модели ШИМ не формируется: пин включён при заполнении от 50%
+    hal::pinWrite(_pin, duty >= 128);
+    return true;
+#endif
 }
 
 /**
@@ -90,5 +134,18 @@ void GPIO::setPWM(uint8_t duty)
 void GPIO::attachInterrupt(void (*handler)(), int mode) 
 {
     if(_pin < 2 || _pin > 13) return;
+#ifdef __AVR__
+#ifdef OS_IRQ_STATS
+    int irq = digitalPinToInterrupt(_pin);
+    if(irq == 0 || irq == 1) 
+    {
+        userHandlers[irq] = handler;
+        handler = (irq == 0) ? int0Handler : int1Handler;
+    }
+#endif
     ::attachInterrupt(digitalPinToInterrupt(_pin), handler, mode);
+#else
+    (void)handler;
+    (void)mode;
+#endif
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 #pragma once
-#include <Arduino.h>
+#include "hal/hal.h"
 
 class GPIO 
 {
@@ -18,7 +18,7 @@ public:
     void write(bool state);
     bool read();
     void toggle();
-    void setPWM(uint8_t duty);
+    bool setPWM(uint8_t duty);
     void attachInterrupt(void (*handler)(), int mode);
     uint8_t getPin() const { return _pin; }
 private:
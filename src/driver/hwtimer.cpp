@@ -0,0 +1,141 @@
+#include "hwtimer.h"
+#include "driver/timer.h"
+#include "system/irqstats.h"
+
+namespace
+{
+    volatile HwTimers::Owner owners[HwTimers::TIMER_COUNT] =
+    {
+        HwTimers::OWNER_ARDUINO, HwTimers::OWNER_ARDUINO, HwTimers::OWNER_ARDUINO
+    };
+
+    const char* const ownerNames[] =
+    {
+        "free", "arduino", "systick", "pwm", "capture", "softpwm", "bench"
+    };
+}
+
+#ifdef __AVR__
+#include "driver/softpwm.h"
+
+ISR(TIMER1_COMPA_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_TIMER1_COMPA);
+    if (owners[HwTimers::TIMER_1] == HwTimers::OWNER_SYSTICK) sysTimer.update();
+    else if (owners[HwTimers::TIMER_1] == HwTimers::OWNER_SOFTPWM) softPwm.onPeriod();
+    IRQ_EXIT(IrqStats::VEC_TIMER1_COMPA);
+}
+
+ISR(TIMER1_COMPB_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_TIMER1_COMPB);
+    if (owners[HwTimers::TIMER_1] == HwTimers::OWNER_SOFTPWM) softPwm.onEdge();
+    IRQ_EXIT(IrqStats::VEC_TIMER1_COMPB);
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_TIMER2_COMPA);
+    if (owners[HwTimers::TIMER_2] == HwTimers::OWNER_SYSTICK) sysTimer.update();
+    else if (owners[HwTimers::TIMER_2] == HwTimers::OWNER_SOFTPWM) softPwm.onPeriod();
+    IRQ_EXIT(IrqStats::VEC_TIMER2_COMPA);
+}
+
+ISR(TIMER2_COMPB_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_TIMER2_COMPB);
+    if (owners[HwTimers::TIMER_2] == HwTimers::OWNER_SOFTPWM) softPwm.onEdge();
+    IRQ_EXIT(IrqStats::VEC_TIMER2_COMPB);
+}
+#endif
+
+namespace HwTimers
+{
+    /**
+     * @brief Захват таймера
+     * @param timer Таймер
+     * @param owner Новый владелец
+     * @return true если таймер свободен или уже принадлежит владельцу
+     */
+    bool acquire(Id timer, Owner owner)
+    {
+        if (timer >= TIMER_COUNT) return false;
+        if (owners[timer] == owner) return true;
+        // millis()/delay() ядра Arduino работают на Timer0
+        if (timer == TIMER_0) return false;
+        if (owners[timer] != OWNER_FREE && owners[timer] != OWNER_ARDUINO) return false;
+
+        owners[timer] = owner;
+        return true;
+    }
+
+    /**
+     * @brief Освобождение таймера
+     * @param timer Таймер
+     * @param owner Текущий владелец
+     */
+    void release(Id timer, Owner owner)
+    {
+        if (timer >= TIMER_COUNT || timer == TIMER_0) return;
+        if (owners[timer] == owner) owners[timer] = OWNER_FREE;
+    }
+
+    /**
+     * @brief Текущий владелец таймера
+     */
+    Owner getOwner(Id timer)
+    {
+        return (timer < TIMER_COUNT) ? owners[timer] : OWNER_FREE;
+    }
+
+    /**
+     * @brief Таймер, формирующий аппаратный ШИМ на пине
+     * @param pin Номер пина
+     * @return Номер таймера или -1, если ШИМ пина формирует не Timer0/1/2
+     *         или пин не поддерживает ШИМ
+     */
+    int8_t timerForPin(uint8_t pin)
+    {
+        switch (pin)
+        {
+#ifdef OS_TARGET_MEGA
+            case 4: case 13:  return TIMER_0;
+            case 11: case 12: return TIMER_1;
+            case 9: case 10:  return TIMER_2;
+#else
+            case 5: case 6:  return TIMER_0;
+            case 9: case 10: return TIMER_1;
+            case 3: case 11: return TIMER_2;
+#endif
+            default:         return -1;
+        }
+    }
+
+    /**
+     * @brief Можно ли использовать analogWrite на пине
+     * @param pin Номер пина
+     * @return true если таймер пина не занят системой
+     */
+    bool hardwarePwmAvailable(uint8_t pin)
+    {
+        int8_t timer = timerForPin(pin);
+        // Timer3/4/5 на Mega системой не занимаются
+        if (timer < 0) return digitalPinHasPWM(pin);
+        return owners[timer] == OWNER_ARDUINO || owners[timer] == OWNER_PWM;
+    }
+
+    /**
+     * @brief Вывод владельцев таймеров
+     * @param out Поток вывода
+     */
+    void report(Print& out)
+    {
+        for (uint8_t i = 0; i < TIMER_COUNT; i++)
+        {
+            out.print(F("Timer"));
+            out.print(i);
+            out.print(F(": "));
+            out.println(ownerNames[owners[i]]);
+        }
+    }
+}
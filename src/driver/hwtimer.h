@@ -0,0 +1,46 @@
+#ifndef HWTIMER_H
+#define HWTIMER_H
+
+#include "hal/hal.h"
+#include "kernel/config.h"
+
+/**
+ * @brief Распределение аппаратных таймеров Timer0/1/2
+ *
+ * Каждый таймер принадлежит одному владельцу. Timer0 закреплён за ядром
+ * Arduino (millis/delay). Timer1 и Timer2 изначально настроены Arduino под
+ * analogWrite и могут быть захвачены системным тиком, аппаратным или
+ * программным ШИМ либо захватом входа. Векторы сравнения Timer1/Timer2
+ * объявлены здесь и передают управление текущему владельцу.
+ */
+namespace HwTimers
+{
+    enum Id : uint8_t
+    {
+        TIMER_0,
+        TIMER_1,
+        TIMER_2,
+        TIMER_COUNT
+    };
+
+    enum Owner : uint8_t
+    {
+        OWNER_FREE,
+        OWNER_ARDUINO,   // Настройки ядра Arduino (analogWrite, millis)
+        OWNER_SYSTICK,   // Системный таймер ОС
+        OWNER_PWM,       // Аппаратный ШИМ через analogWrite
+        OWNER_CAPTURE,   // Захват входа ICP1
+        OWNER_SOFTPWM,   // Программный ШИМ
+        OWNER_BENCH      // Счётчик тактов бенчмарков (bench/)
+    };
+
+    bool acquire(Id timer, Owner owner);
+    void release(Id timer, Owner owner);
+    Owner getOwner(Id timer);
+
+    int8_t timerForPin(uint8_t pin);
+    bool hardwarePwmAvailable(uint8_t pin);
+    void report(Print& out);
+}
+
+#endif
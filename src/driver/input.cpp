@@ -0,0 +1,355 @@
+#include "input.h"
+#include "driver/timer.h"
+#include "system/irqstats.h"
+
+Input sysInput;
+
+// Пины 8-13 (PB0-PB5)
+ISR(PCINT0_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_PCINT0);
+    sysInput.onPinChange(true);
+    IRQ_EXIT(IrqStats::VEC_PCINT0);
+}
+
+// Пины 0-7 (PD0-PD7)
+ISR(PCINT2_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_PCINT2);
+    sysInput.onPinChange(false);
+    IRQ_EXIT(IrqStats::VEC_PCINT2);
+}
+
+// Захват Timer1 на пине 8 (ICP1)
+ISR(TIMER1_CAPT_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_TIMER1_CAPT);
+    sysInput.onCapture();
+    IRQ_EXIT(IrqStats::VEC_TIMER1_CAPT);
+}
+
+namespace
+{
+    bool readPin(uint8_t pin)
+    {
+        return (pin < 8) ? (PIND & (1 << pin)) : (PINB & (1 << (pin - 8)));
+    }
+
+    void tickHook()
+    {
+        sysInput.onTick();
+    }
+}
+
+/**
+ * @brief Конструктор
+ */
+Input::Input()
+    : _head(0), _tail(0), _dropped(0), _masked(0), _state(0),
+      _enabled(0), _portB(0), _portD(0), _capture(false)
+{
+    for (uint8_t i = 0; i < PIN_COUNT; i++)
+    {
+        _lastEdge[i] = 0;
+        _debounce[i] = 0;
+    }
+}
+
+/**
+ * @brief Подключение пина к подсистеме ввода (PCINT)
+ * @param gpio Пин в режиме ввода
+ * @param debounceMs Время подавления дребезга (мс), 0 - без подавления
+ * @return true если пин подключён
+ */
+bool Input::attach(GPIO& gpio, uint8_t debounceMs)
+{
+#ifdef OS_UNO_PINOUT
+    uint8_t pin = gpio.getPin();
+    if (pin < FIRST_PIN || pin > LAST_PIN) return false;
+    if (gpio.getMode() != GPIO::GPIO_INPUT && gpio.getMode() != GPIO::GPIO_INPUT_PULLUP) return false;
+
+    detach(gpio);
+
+    uint8_t idx = pin - FIRST_PIN;
+    uint16_t bit = 1 << idx;
+
+    IRQ_LOCK();
+    bool level = readPin(pin);
+    _debounce[idx] = debounceMs;
+    _lastEdge[idx] = sysTimer.micros();
+    _state = level ? (_state | bit) : (_state & ~bit);
+    _enabled |= bit;
+    unmask(pin, level);
+    if (pin < 8) PCICR |= (1 << PCIE2);
+    else PCICR |= (1 << PCIE0);
+    IRQ_UNLOCK();
+    if (debounceMs > 0) sysTimer.setTickHook(tickHook);
+    return true;
+#else
+    (void)gpio;
+    (void)debounceMs;
+    return false;
+#endif
+}
+
+/**
+ * @brief Подключение пина 8 через захват Timer1 (ICP1)
+ * @param gpio Пин 8 в режиме ввода
+ * @param debounceMs Время подавления дребезга (мс), 0 - без подавления
+ * @return true если захват включён
+ *
+ * Если системный тик работает на Timer1, захват использует его счётчик
+ * (вызывать после sysTimer.begin()). Иначе Timer1 захватывается целиком
+ * и запускается в нормальном режиме с предделителем 8.
+ */
+bool Input::attachCapture(GPIO& gpio, uint8_t debounceMs)
+{
+#ifdef OS_UNO_PINOUT
+    if (gpio.getPin() != CAPTURE_PIN) return false;
+    if (gpio.getMode() != GPIO::GPIO_INPUT && gpio.getMode() != GPIO::GPIO_INPUT_PULLUP) return false;
+
+    detach(gpio);
+
+    bool shared = sysTimer.getSource() == HwTimers::TIMER_1;
+    if (!shared && !HwTimers::acquire(HwTimers::TIMER_1, HwTimers::OWNER_CAPTURE)) return false;
+
+    uint8_t idx = CAPTURE_PIN - FIRST_PIN;
+    uint16_t bit = 1 << idx;
+
+    IRQ_LOCK();
+    if (!shared)
+    {
+        TIMSK1 = 0;
+        TCCR1A = 0;
+        TCCR1B = (1 << CS11);   // Нормальный режим, предделитель 8
+    }
+    bool level = readPin(CAPTURE_PIN);
+    _capture = true;
+    _debounce[idx] = debounceMs;
+    _lastEdge[idx] = sysTimer.micros();
+    _state = level ? (_state | bit) : (_state & ~bit);
+    _enabled |= bit;
+    TCCR1B |= (1 << ICNC1);  // Подавитель шума на 4 такта
+    unmask(CAPTURE_PIN, level);
+    IRQ_UNLOCK();
+    if (debounceMs > 0) sysTimer.setTickHook(tickHook);
+    return true;
+#else
+    (void)gpio;
+    (void)debounceMs;
+    return false;
+#endif
+}
+
+/**
+ * @brief Отключение пина от подсистемы ввода
+ * @param gpio Пин
+ */
+void Input::detach(GPIO& gpio)
+{
+    uint8_t pin = gpio.getPin();
+    if (pin < FIRST_PIN || pin > LAST_PIN) return;
+
+    uint16_t bit = 1 << (pin - FIRST_PIN);
+
+    IRQ_LOCK();
+    mask(pin);
+    _masked &= ~bit;
+    _enabled &= ~bit;
+    if (pin == CAPTURE_PIN) _capture = false;
+    IRQ_UNLOCK();
+    if (pin == CAPTURE_PIN) HwTimers::release(HwTimers::TIMER_1, HwTimers::OWNER_CAPTURE);
+}
+
+/**
+ * @brief Получение следующего события
+ * @param event Событие
+ * @return true если событие получено
+ */
+bool Input::read(InputEvent& event)
+{
+    if (_head == _tail) return false;
+
+    event = _queue[_tail];
+    _tail = (_tail + 1) & (QUEUE_SIZE - 1);
+    return true;
+}
+
+/**
+ * @brief Количество событий в очереди
+ */
+uint8_t Input::available() const
+{
+    return (_head - _tail) & (QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief Уровень пина после подавления дребезга
+ * @param pin Номер пина
+ */
+bool Input::getLevel(uint8_t pin) const
+{
+    if (pin < FIRST_PIN || pin > LAST_PIN) return false;
+    return _state & (1 << (pin - FIRST_PIN));
+}
+
+/**
+ * @brief Обработка изменения уровня на порту (из ISR)
+ * @param portB true для PCINT0 (пины 8-13), false для PCINT2 (пины 0-7)
+ */
+void Input::onPinChange(bool portB)
+{
+    uint8_t levels = portB ? PINB : PIND;
+    uint8_t& last = portB ? _portB : _portD;
+    uint8_t changed = (levels ^ last) & (portB ? PCMSK0 : PCMSK2);
+    last = levels;
+    if (!changed) return;
+
+    uint32_t now = sysTimer.micros();
+    uint8_t firstPin = portB ? 8 : 0;
+    for (uint8_t b = 0; b < 8; b++)
+    {
+        if (changed & (1 << b))
+        {
+            accept(firstPin + b, levels & (1 << b), now);
+        }
+    }
+}
+
+/**
+ * @brief Обработка захвата фронта на ICP1 (из ISR)
+ */
+void Input::onCapture()
+{
+    uint16_t captured = ICR1;
+    uint32_t now = sysTimer.micros();
+    uint16_t ticks = TCNT1;
+    uint16_t elapsed;
+    if (sysTimer.getSource() == HwTimers::TIMER_1)
+    {
+        // Timer1 в режиме CTC системного тика
+        elapsed = (ticks >= captured) ? ticks - captured : ticks + sysTimer.ticksPerMs() - captured;
+    }
+    else
+    {
+        elapsed = ticks - captured;
+    }
+
+    bool level = TCCR1B & (1 << ICES1);
+    TCCR1B ^= (1 << ICES1);
+    TIFR1 = (1 << ICF1);  // Смена фронта может выставить ложный флаг
+
+    accept(CAPTURE_PIN, level, now - elapsed / Timer::TIMER1_TICKS_PER_US);
+}
+
+/**
+ * @brief Приём фронта: событие в очередь и маскирование на время дребезга
+ * @param pin Номер пина
+ * @param level Новый уровень
+ * @param now Время фронта (мкс)
+ */
+void Input::accept(uint8_t pin, bool level, uint32_t now)
+{
+    uint8_t idx = pin - FIRST_PIN;
+    uint16_t bit = 1 << idx;
+    if (!!(_state & bit) == level) return;
+
+    _state = level ? (_state | bit) : (_state & ~bit);
+    _lastEdge[idx] = now;
+    push(now, pin, level);
+
+    if (_debounce[idx] > 0)
+    {
+        mask(pin);
+        _masked |= bit;
+    }
+}
+
+/**
+ * @brief Запись события в кольцевой буфер
+ */
+void Input::push(uint32_t time, uint8_t pin, bool level)
+{
+    uint8_t next = (_head + 1) & (QUEUE_SIZE - 1);
+    if (next == _tail)
+    {
+        _dropped++;
+        return;
+    }
+    _queue[_head].time = time;
+    _queue[_head].pin = pin;
+    _queue[_head].level = level;
+    _head = next;
+}
+
+/**
+ * @brief Запрет прерывания пина
+ */
+void Input::mask(uint8_t pin)
+{
+    if (pin == CAPTURE_PIN && _capture) TIMSK1 &= ~(1 << ICIE1);
+    else if (pin < 8) PCMSK2 &= ~(1 << pin);
+    else PCMSK0 &= ~(1 << (pin - 8));
+}
+
+/**
+ * @brief Разрешение прерывания пина с текущим уровнем в качестве исходного
+ */
+void Input::unmask(uint8_t pin, bool level)
+{
+    if (pin == CAPTURE_PIN && _capture)
+    {
+        // Ждём фронт, противоположный текущему уровню
+        if (level) TCCR1B &= ~(1 << ICES1);
+        else TCCR1B |= (1 << ICES1);
+        TIFR1 = (1 << ICF1);
+        TIMSK1 |= (1 << ICIE1);
+    }
+    else if (pin < 8)
+    {
+        uint8_t b = 1 << pin;
+        _portD = level ? (_portD | b) : (_portD & ~b);
+        PCMSK2 |= b;
+    }
+    else
+    {
+        uint8_t b = 1 << (pin - 8);
+        _portB = level ? (_portB | b) : (_portB & ~b);
+        PCMSK0 |= b;
+    }
+}
+
+/**
+ * @brief Снятие маски с пинов, у которых истекло время дребезга (из ISR тика)
+ *
+ * Выполняется каждую миллисекунду независимо от чтения очереди. Если за
+ * время маскирования уровень изменился, фиксируется новый фронт со
+ * временем окончания дребезга (с точностью до тика, сам фронт при
+ * маске не виден) и пин остаётся замаскированным ещё на один интервал.
+ */
+void Input::onTick()
+{
+    if (!_masked) return;
+
+    uint32_t now = sysTimer.micros();
+    for (uint8_t idx = 0; idx < PIN_COUNT; idx++)
+    {
+        uint16_t bit = 1 << idx;
+        if (!(_masked & bit)) continue;
+        if (now - _lastEdge[idx] < _debounce[idx] * 1000UL) continue;
+
+        uint8_t pin = FIRST_PIN + idx;
+        IRQ_LOCK();
+        bool level = readPin(pin);
+        _masked &= ~bit;
+        if (!!(_state & bit) != level)
+        {
+            accept(pin, level, now);
+        }
+        else
+        {
+            unmask(pin, level);
+        }
+        IRQ_UNLOCK();
+    }
+}
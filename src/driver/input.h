@@ -0,0 +1,80 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "hal/hal.h"
+#include "driver/gpio.h"
+#include "kernel/config.h"
+
+/**
+ * @brief Событие изменения уровня на входе
+ */
+struct InputEvent
+{
+    uint32_t time;   // Время фронта (мкс, sysTimer.micros())
+    uint8_t pin;     // Номер пина
+    bool level;      // Уровень после фронта
+};
+
+/**
+ * @brief Подсистема ввода с метками времени и подавлением дребезга
+ *
+ * Пины 2-13 обслуживаются прерываниями PCINT, пин 8 может работать через
+ * захват Timer1 (ICP1) с точностью до такта таймера. Принятый фронт
+ * попадает в кольцевой буфер, после чего прерывание пина маскируется на
+ * время подавления дребезга, так что дребезг не порождает шторма
+ * прерываний. Итоговый уровень после окончания дребезга сверяется в
+ * прерывании системного тика (Timer::setTickHook), так что маска
+ * снимается и без задачи, читающей события.
+ *
+ * Номера PCINT и ICP1 - по карте выводов Uno; на других целях attach()
+ * и attachCapture() возвращают false.
+ */
+class Input
+{
+public:
+    static const uint8_t QUEUE_SIZE = 16;   // Степень двойки
+    static const uint8_t FIRST_PIN = 2;
+    static const uint8_t LAST_PIN = 13;
+    static const uint8_t PIN_COUNT = LAST_PIN - FIRST_PIN + 1;
+    static const uint8_t CAPTURE_PIN = 8;   // ICP1
+
+    Input();
+
+    bool attach(GPIO& gpio, uint8_t debounceMs = 20);
+    bool attachCapture(GPIO& gpio, uint8_t debounceMs = 0);
+    void detach(GPIO& gpio);
+
+    bool read(InputEvent& event);
+    uint8_t available() const;
+    bool getLevel(uint8_t pin) const;
+    uint16_t getDropped() const { return _dropped; }
+
+    // Вызываются из обработчиков прерываний
+    void onPinChange(bool portB);
+    void onCapture();
+    void onTick();
+
+private:
+    InputEvent _queue[QUEUE_SIZE];
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    volatile uint16_t _dropped;
+
+    uint32_t _lastEdge[PIN_COUNT];     // Время последнего принятого фронта (мкс)
+    uint8_t _debounce[PIN_COUNT];      // Время подавления дребезга (мс)
+    volatile uint16_t _masked;         // Пины, замаскированные на время дребезга
+    volatile uint16_t _state;          // Уровни после подавления дребезга
+    uint16_t _enabled;
+    uint8_t _portB;                    // Последние считанные уровни PINB/PIND
+    uint8_t _portD;
+    bool _capture;
+
+    void push(uint32_t time, uint8_t pin, bool level);
+    void accept(uint8_t pin, bool level, uint32_t now);
+    void mask(uint8_t pin);
+    void unmask(uint8_t pin, bool level);
+};
+
+extern Input sysInput;
+
+#endif
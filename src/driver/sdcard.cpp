@@ -0,0 +1,328 @@
+#include "sdcard.h"
+#include "driver/timer.h"
+
+namespace
+{
+    const uint8_t CMD_GO_IDLE = 0;
+    const uint8_t CMD_SEND_IF_COND = 8;
+    const uint8_t CMD_SEND_CSD = 9;
+    const uint8_t CMD_SET_BLOCKLEN = 16;
+    const uint8_t CMD_READ_BLOCK = 17;
+    const uint8_t CMD_WRITE_BLOCK = 24;
+    const uint8_t CMD_APP = 55;
+    const uint8_t CMD_READ_OCR = 58;
+    const uint8_t ACMD_SEND_OP_COND = 41;
+
+    const uint8_t R1_IDLE = 0x01;
+    const uint8_t R1_ILLEGAL = 0x04;
+    const uint8_t TOKEN_DATA = 0xFE;
+    const uint8_t DATA_ACCEPTED = 0x05;
+
+    // Предельные времена карты по спецификации SD (SDXC - 500 мс записи)
+    const uint16_t INIT_TIMEOUT_MS = 1000;
+    const uint16_t READ_TIMEOUT_MS = 100;
+    const uint16_t WRITE_TIMEOUT_MS = 500;
+}
+
+/**
+ * @brief Конструктор
+ * @param csPin Пин выбора карты
+ */
+SdCard::SdCard(uint8_t csPin) : _cs(csPin)
+{
+}
+
+/**
+ * @brief Передача через sysSpi с ожиданием завершения
+ *
+ * Блок в 512 байт на 4 МГц передаётся около 2 мс с учётом прерывания
+ * на каждый байт; команды и ответы - единицы байт.
+ */
+void SdCard::transfer(const uint8_t* tx, uint8_t* rx, uint16_t length)
+{
+    SpiTransaction t = {Spi::NO_CS, _config, tx, rx, length, nullptr, -1, SpiTransaction::IDLE};
+    while (!sysSpi.submit(t)) {}
+    while (t.status != SpiTransaction::DONE) {}
+}
+
+/**
+ * @brief Обмен одним байтом
+ */
+uint8_t SdCard::exchange(uint8_t value)
+{
+    uint8_t received;
+    transfer(&value, &received, 1);
+    return received;
+}
+
+void SdCard::select()
+{
+    hal::pinWrite(_cs, LOW);
+}
+
+/**
+ * @brief Снятие CS и байт тактов, чтобы карта отпустила MISO
+ */
+void SdCard::deselect()
+{
+    hal::pinWrite(_cs, HIGH);
+    exchange(0xFF);
+}
+
+/**
+ * @brief Ожидание окончания внутренней операции карты (MISO = 0xFF)
+ *
+ * Обычно программирование блока длится единицы миллисекунд; до
+ * timeoutMs ожидание доходит только у медленной или изношенной карты.
+ */
+bool SdCard::waitReady(uint16_t timeoutMs)
+{
+    uint32_t start = sysTimer.millis();
+    while (exchange(0xFF) != 0xFF)
+    {
+        if (sysTimer.millis() - start > timeoutMs) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Команда карте
+ * @return Ответ R1 (0xFF - нет ответа)
+ */
+uint8_t SdCard::command(uint8_t index, uint32_t arg)
+{
+    if (index != CMD_GO_IDLE) waitReady(WRITE_TIMEOUT_MS);
+
+    // CRC проверяется только у CMD0 и CMD8
+    uint8_t crc = (index == CMD_GO_IDLE) ? 0x95 : (index == CMD_SEND_IF_COND) ? 0x87 : 0x01;
+    uint8_t frame[6] = {(uint8_t)(0x40 | index), (uint8_t)(arg >> 24), (uint8_t)(arg >> 16),
+                        (uint8_t)(arg >> 8), (uint8_t)arg, crc};
+    transfer(frame, nullptr, sizeof(frame));
+
+    uint8_t response = 0xFF;
+    for (uint8_t i = 0; i < 10 && (response & 0x80); i++)
+    {
+        response = exchange(0xFF);
+    }
+    return response;
+}
+
+uint8_t SdCard::appCommand(uint8_t index, uint32_t arg)
+{
+    command(CMD_APP, 0);
+    return command(index, arg);
+}
+
+/**
+ * @brief Приём блока данных после маркера 0xFE
+ */
+bool SdCard::readData(uint8_t* buffer, uint16_t size)
+{
+    uint32_t start = sysTimer.millis();
+    uint8_t token;
+    while ((token = exchange(0xFF)) == 0xFF)
+    {
+        if (sysTimer.millis() - start > READ_TIMEOUT_MS) return false;
+    }
+    if (token != TOKEN_DATA) return false;
+
+    transfer(nullptr, buffer, size);
+    transfer(nullptr, nullptr, 2);     // CRC не проверяется
+    return true;
+}
+
+/**
+ * @brief Ёмкость по регистру CSD
+ * @return Число блоков по 512 байт или 0
+ */
+uint32_t SdCard::readCapacity()
+{
+    uint8_t csd[16];
+    if (command(CMD_SEND_CSD, 0) != 0 || !readData(csd, sizeof(csd))) return 0;
+
+    if ((csd[0] >> 6) == 1)
+    {
+        // CSD 2.0: (C_SIZE + 1) * 512 КБ
+        uint32_t size = ((uint32_t)(csd[7] & 0x3F) << 16) | ((uint16_t)csd[8] << 8) | csd[9];
+        return (size + 1) << 10;
+    }
+    uint8_t readBlockLen = csd[5] & 0x0F;
+    uint16_t size = ((uint16_t)(csd[6] & 0x03) << 10) | ((uint16_t)csd[7] << 2) | (csd[8] >> 6);
+    uint8_t multiplier = ((csd[9] & 0x03) << 1) | (csd[10] >> 7);
+    return (uint32_t)(size + 1) << (multiplier + 2 + readBlockLen - 9);
+}
+
+/**
+ * @brief Инициализация карты с ожиданием готовности
+ * @param clockHz Частота SCK после инициализации
+ * @return true если карта готова к обмену блоками
+ *
+ * Ждёт до INIT_TIMEOUT_MS; в задачах вместо неё - start() и poll().
+ */
+bool SdCard::begin(uint32_t clockHz)
+{
+    start(clockHz);
+    InitState state;
+    while ((state = poll()) == INIT_BUSY) {}
+    return state == INIT_READY;
+}
+
+/**
+ * @brief Начало инициализации карты
+ * @param clockHz Частота SCK после инициализации
+ *
+ * sysSpi.begin() вызывается заранее. Инициализация идёт на 400 кГц.
+ */
+void SdCard::start(uint32_t clockHz)
+{
+    _type = TYPE_NONE;
+    _blocks = 0;
+    _clockHz = clockHz;
+    _config = Spi::config(400000);
+    hal::pinWrite(_cs, HIGH);
+    hal::pinMode(_cs, OUTPUT);
+
+    // Не меньше 74 тактов при снятом CS
+    transfer(nullptr, nullptr, 10);
+    _state = STATE_GO_IDLE;
+    _started = sysTimer.millis();
+}
+
+/**
+ * @brief Шаг инициализации: одна попытка CMD0 или ACMD41
+ * @return INIT_BUSY пока карта не вышла из состояния ожидания
+ *
+ * Шаг занимает несколько команд на 400 кГц (около 1 мс), поэтому
+ * вызывается из задачи при каждом запуске до INIT_READY или
+ * INIT_FAILED; вся инициализация ограничена INIT_TIMEOUT_MS.
+ */
+SdCard::InitState SdCard::poll()
+{
+    if (_state == STATE_READY) return INIT_READY;
+    if (_state == STATE_FAILED) return INIT_FAILED;
+
+    bool expired = sysTimer.millis() - _started > INIT_TIMEOUT_MS;
+    select();
+    if (_state == STATE_GO_IDLE)
+    {
+        if (command(CMD_GO_IDLE, 0) == R1_IDLE) _state = ifCondition();
+        else if (expired) _state = STATE_FAILED;
+    }
+    else if (appCommand(ACMD_SEND_OP_COND, (_type == TYPE_SD2) ? 0x40000000UL : 0) == 0)
+    {
+        _state = finish() ? STATE_READY : STATE_FAILED;
+    }
+    else if (expired)
+    {
+        _state = STATE_FAILED;
+    }
+    deselect();
+
+    if (_state == STATE_FAILED) _type = TYPE_NONE;
+    if (_state != STATE_READY && _state != STATE_FAILED) return INIT_BUSY;
+    _config = Spi::config(_clockHz);
+    return (_state == STATE_READY) ? INIT_READY : INIT_FAILED;
+}
+
+/**
+ * @brief Версия карты по CMD8
+ * @return Следующее состояние инициализации
+ */
+SdCard::State SdCard::ifCondition()
+{
+    // SD v1 не знает CMD8
+    uint8_t r7[4];
+    uint8_t response = command(CMD_SEND_IF_COND, 0x1AA);
+    if (response == R1_IDLE)
+    {
+        transfer(nullptr, r7, sizeof(r7));
+        if (r7[3] != 0xAA) return STATE_FAILED;
+        _type = TYPE_SD2;
+    }
+    else if (response & R1_ILLEGAL)
+    {
+        _type = TYPE_SD1;
+    }
+    else
+    {
+        return STATE_FAILED;
+    }
+    return STATE_OP_COND;
+}
+
+/**
+ * @brief Тип адресации, длина блока и ёмкость готовой карты
+ */
+bool SdCard::finish()
+{
+    uint8_t r7[4];
+    if (_type == TYPE_SD2 && command(CMD_READ_OCR, 0) == 0)
+    {
+        transfer(nullptr, r7, sizeof(r7));
+        if ((r7[0] & 0xC0) == 0xC0) _type = TYPE_SDHC;
+    }
+    if (_type != TYPE_SDHC && command(CMD_SET_BLOCKLEN, BLOCK_SIZE) != 0) return false;
+    _blocks = readCapacity();
+    return _blocks > 0;
+}
+
+/**
+ * @brief Чтение блока
+ */
+bool SdCard::readBlock(uint32_t block, uint8_t* buffer)
+{
+    if (block >= _blocks) return false;
+    uint32_t address = (_type == TYPE_SDHC) ? block : block * BLOCK_SIZE;
+
+    select();
+    bool ok = command(CMD_READ_BLOCK, address) == 0 && readData(buffer, BLOCK_SIZE);
+    deselect();
+    return ok;
+}
+
+/**
+ * @brief Запись блока
+ *
+ * Программирование блока картой не ожидается: следующая команда или
+ * sync() дождутся готовности.
+ */
+bool SdCard::writeBlock(uint32_t block, const uint8_t* data)
+{
+    if (block >= _blocks) return false;
+    uint32_t address = (_type == TYPE_SDHC) ? block : block * BLOCK_SIZE;
+
+    select();
+    bool ok = command(CMD_WRITE_BLOCK, address) == 0;
+    if (ok)
+    {
+        exchange(TOKEN_DATA);
+        transfer(data, nullptr, BLOCK_SIZE);
+        transfer(nullptr, nullptr, 2);
+        ok = (exchange(0xFF) & 0x1F) == DATA_ACCEPTED;
+    }
+    deselect();
+    return ok;
+}
+
+/**
+ * @brief Карта ещё программирует записанный блок
+ *
+ * Один байт обмена без ожидания.
+ */
+bool SdCard::isBusy()
+{
+    if (_type == TYPE_NONE) return false;
+    select();
+    bool busy = exchange(0xFF) != 0xFF;
+    deselect();
+    return busy;
+}
+
+/**
+ * @brief Проверка окончания записи последнего блока
+ * @return false пока карта занята; окончания записи не ждёт
+ */
+bool SdCard::sync()
+{
+    return !isBusy();
+}
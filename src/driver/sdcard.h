@@ -0,0 +1,83 @@
+#ifndef SDCARD_H
+#define SDCARD_H
+
+#include "fs/blockdev.h"
+#include "driver/spi.h"
+
+/**
+ * @brief SD/SDHC-карта в режиме SPI как блочное устройство
+ *
+ * Блок данных (512 байт) передаётся одной передачей sysSpi по
+ * прерыванию; команды и ожидание ответов карты - короткими передачами
+ * с ожиданием завершения. Вызывать только из задач: чтение и запись
+ * блока синхронны и занимают шину SPI с удержанием CS.
+ *
+ * Обычно блок читается или пишется за 2-5 мс. Худший случай - команда
+ * после записи, пока карта программирует блок: до 500 мс ожидания
+ * готовности и ещё до 100 мс маркера данных при чтении. sync() и
+ * isBusy() не ждут, а инициализация в задачах идёт по шагам poll()
+ * около 1 мс, поэтому ожидание карты не попадает в задачи без обмена
+ * с томом.
+ */
+class SdCard : public BlockDevice
+{
+public:
+    enum Type : uint8_t
+    {
+        TYPE_NONE,
+        TYPE_SD1,     // SD v1, байтовая адресация
+        TYPE_SD2,     // SD v2 до 2 ГБ, байтовая адресация
+        TYPE_SDHC     // SDHC/SDXC, адресация блоками
+    };
+
+    enum InitState : uint8_t
+    {
+        INIT_BUSY,      // Карта ещё выходит из состояния ожидания
+        INIT_READY,
+        INIT_FAILED
+    };
+
+    explicit SdCard(uint8_t csPin);
+
+    bool begin(uint32_t clockHz = 4000000);
+    void start(uint32_t clockHz = 4000000);
+    InitState poll();
+    Type getType() const { return _type; }
+
+    bool readBlock(uint32_t block, uint8_t* buffer) override;
+    bool writeBlock(uint32_t block, const uint8_t* data) override;
+    uint32_t blockCount() const override { return _blocks; }
+    bool sync() override;
+    bool isBusy() override;
+
+private:
+    enum State : uint8_t
+    {
+        STATE_GO_IDLE,      // CMD0 до ответа R1_IDLE
+        STATE_OP_COND,      // ACMD41 до выхода из ожидания
+        STATE_READY,
+        STATE_FAILED
+    };
+
+    uint8_t _cs;
+    Type _type = TYPE_NONE;
+    State _state = STATE_FAILED;
+    uint32_t _blocks = 0;
+    uint32_t _clockHz = 0;
+    uint32_t _started = 0;
+    uint8_t _config = 0;
+
+    void transfer(const uint8_t* tx, uint8_t* rx, uint16_t length);
+    uint8_t exchange(uint8_t value);
+    void select();
+    void deselect();
+    bool waitReady(uint16_t timeoutMs);
+    uint8_t command(uint8_t index, uint32_t arg);
+    uint8_t appCommand(uint8_t index, uint32_t arg);
+    bool readData(uint8_t* buffer, uint16_t size);
+    uint32_t readCapacity();
+    State ifCondition();
+    bool finish();
+};
+
+#endif
@@ -0,0 +1,319 @@
+#include "softpwm.h"
+#include "system/irqstats.h"
+
+SoftPwm softPwm;
+
+namespace
+{
+    const uint8_t PERIOD_TOP = 255;
+
+    enum Port : uint8_t { PORT_B, PORT_C, PORT_D };
+
+    /**
+     * @brief Порт и бит пина Arduino Uno
+     */
+    void pinToPort(uint8_t pin, uint8_t& port, uint8_t& bit)
+    {
+        if (pin < 8)
+        {
+            port = PORT_D;
+            bit = 1 << pin;
+        }
+        else if (pin < 14)
+        {
+            port = PORT_B;
+            bit = 1 << (pin - 8);
+        }
+        else
+        {
+            port = PORT_C;
+            bit = 1 << (pin - 14);
+        }
+    }
+}
+
+/**
+ * @brief Конструктор
+ */
+SoftPwm::SoftPwm() : _channels(0), _front(0), _pending(false), _edge(0), _timer(-1)
+{
+    memset(_schedules, 0, sizeof(_schedules));
+    for (uint8_t i = 0; i < 3; i++) _released[i] = 0;
+}
+
+/**
+ * @brief Запуск движка на свободном таймере
+ * @return true если таймер получен
+ */
+bool SoftPwm::begin()
+{
+    if (_timer >= 0) return true;
+
+    HwTimers::Id id;
+    if (HwTimers::acquire(HwTimers::TIMER_2, HwTimers::OWNER_SOFTPWM)) id = HwTimers::TIMER_2;
+    else if (HwTimers::acquire(HwTimers::TIMER_1, HwTimers::OWNER_SOFTPWM)) id = HwTimers::TIMER_1;
+    else return false;
+
+    IRQ_LOCK();
+    if (id == HwTimers::TIMER_2)
+    {
+        TIMSK2 = 0;
+        TCCR2A = (1 << WGM21);                // CTC, TOP = OCR2A
+        TCCR2B = (1 << CS22) | (1 << CS21);   // Предделитель 256
+        OCR2A = PERIOD_TOP;
+        OCR2B = PERIOD_TOP;
+        TCNT2 = 0;
+        TIFR2 = (1 << OCF2A) | (1 << OCF2B);
+        TIMSK2 = (1 << OCIE2A) | (1 << OCIE2B);
+    }
+    else
+    {
+        TIMSK1 = 0;
+        TCCR1A = 0;
+        TCCR1B = (1 << WGM12) | (1 << CS12);  // CTC, TOP = OCR1A, предделитель 256
+        OCR1A = PERIOD_TOP;
+        OCR1B = PERIOD_TOP;
+        TCNT1 = 0;
+        TIFR1 = (1 << OCF1A) | (1 << OCF1B);
+        TIMSK1 = (1 << OCIE1A) | (1 << OCIE1B);
+    }
+    _timer = id;
+    IRQ_UNLOCK();
+    return true;
+}
+
+/**
+ * @brief Остановка движка и освобождение таймера
+ */
+void SoftPwm::end()
+{
+    if (_timer < 0) return;
+
+    IRQ_LOCK();
+    if (_timer == HwTimers::TIMER_2) TIMSK2 = 0;
+    else TIMSK1 = 0;
+    for (uint8_t i = 0; i < _channels; i++)
+    {
+        uint8_t port, bit;
+        pinToPort(_pins[i], port, bit);
+        if (port == PORT_B) PORTB &= ~bit;
+        else if (port == PORT_C) PORTC &= ~bit;
+        else PORTD &= ~bit;
+    }
+    // Отключённые пины, которые не успело погасить расписание
+    PORTB &= ~_released[PORT_B];
+    PORTC &= ~_released[PORT_C];
+    PORTD &= ~_released[PORT_D];
+    for (uint8_t i = 0; i < 3; i++) _released[i] = 0;
+    IRQ_UNLOCK();
+
+    HwTimers::release((HwTimers::Id)_timer, HwTimers::OWNER_SOFTPWM);
+    _timer = -1;
+}
+
+/**
+ * @brief Поиск канала по пину
+ * @return Индекс канала или -1
+ */
+int8_t SoftPwm::findChannel(uint8_t pin) const
+{
+    for (uint8_t i = 0; i < _channels; i++)
+    {
+        if (_pins[i] == pin) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Установка заполнения
+ * @param pin Номер пина (0-19)
+ * @param duty Коэффициент заполнения (0 - выкл, 255 - постоянно вкл)
+ * @return true если значение принято
+ */
+bool SoftPwm::set(uint8_t pin, uint8_t duty)
+{
+#ifdef OS_UNO_PINOUT
+    if (pin > MAX_PIN) return false;
+
+    int8_t ch = findChannel(pin);
+    if (ch < 0)
+    {
+        if (_channels >= MAX_CHANNELS) return false;
+        if (!begin()) return false;
+        pinMode(pin, OUTPUT);
+        ch = _channels;
+        _pins[ch] = pin;
+        _channels++;
+
+        // Снова подключённый пин больше не гасится как отключённый
+        uint8_t port, bit;
+        pinToPort(pin, port, bit);
+        IRQ_LOCK();
+        _released[port] &= ~bit;
+        IRQ_UNLOCK();
+    }
+    else if (_duty[ch] == duty)
+    {
+        return true;
+    }
+
+    _duty[ch] = duty;
+    rebuild();
+    return true;
+#else
+    (void)pin;
+    (void)duty;
+    return false;
+#endif
+}
+
+/**
+ * @brief Текущее заполнение пина
+ */
+uint8_t SoftPwm::get(uint8_t pin) const
+{
+    int8_t ch = findChannel(pin);
+    return (ch < 0) ? 0 : _duty[ch];
+}
+
+/**
+ * @brief Отключение пина от программного ШИМ
+ * @param pin Номер пина
+ *
+ * Пин выключается в начале периода, с которого действует расписание
+ * без него, даже если до этого расписание перестраивалось снова.
+ */
+void SoftPwm::detach(uint8_t pin)
+{
+    int8_t ch = findChannel(pin);
+    if (ch < 0) return;
+
+    for (uint8_t i = ch; i < _channels - 1; i++)
+    {
+        _pins[i] = _pins[i + 1];
+        _duty[i] = _duty[i + 1];
+    }
+    _channels--;
+
+    uint8_t port, bit;
+    pinToPort(pin, port, bit);
+    IRQ_LOCK();
+    _released[port] |= bit;
+    IRQ_UNLOCK();
+    rebuild();
+}
+
+/**
+ * @brief Построение расписания в заднем буфере
+ *
+ * Пока _pending сброшен, ISR не трогает задний буфер, поэтому запись
+ * идёт без запрета прерываний.
+ */
+void SoftPwm::rebuild()
+{
+    _pending = false;
+    Schedule& s = _schedules[_front ^ 1];
+    memset(&s, 0, sizeof(s));
+
+    for (uint8_t i = 0; i < _channels; i++)
+    {
+        uint8_t port, bit;
+        pinToPort(_pins[i], port, bit);
+        uint8_t duty = _duty[i];
+
+        if (duty == 0)
+        {
+            s.off[port] |= bit;
+            continue;
+        }
+        s.on[port] |= bit;
+        if (duty == PERIOD_TOP) continue;
+
+        // Вставка с сортировкой по времени, одинаковые значения объединяются
+        uint8_t pos = 0;
+        while (pos < s.count && s.edges[pos].at < duty) pos++;
+        if (pos < s.count && s.edges[pos].at == duty)
+        {
+            s.edges[pos].clear[port] |= bit;
+            continue;
+        }
+        for (uint8_t j = s.count; j > pos; j--)
+        {
+            s.edges[j] = s.edges[j - 1];
+        }
+        memset(&s.edges[pos], 0, sizeof(Edge));
+        s.edges[pos].at = duty;
+        s.edges[pos].clear[port] = bit;
+        s.count++;
+    }
+
+    for (uint8_t port = 0; port < 3; port++)
+    {
+        s.off[port] |= _released[port];
+    }
+    _pending = true;
+}
+
+/**
+ * @brief Начало периода (прерывание сравнения A, из ISR)
+ */
+void SoftPwm::onPeriod()
+{
+    bool swapped = _pending;
+    if (swapped)
+    {
+        _front ^= 1;
+        _pending = false;
+    }
+
+    const Schedule& s = _schedules[_front];
+    if (swapped)
+    {
+        // Отключённые пины, погашенные новым расписанием, больше не нужны
+        _released[PORT_B] &= ~s.off[PORT_B];
+        _released[PORT_C] &= ~s.off[PORT_C];
+        _released[PORT_D] &= ~s.off[PORT_D];
+    }
+
+    PORTB = (PORTB & ~s.off[PORT_B]) | s.on[PORT_B];
+    PORTC = (PORTC & ~s.off[PORT_C]) | s.on[PORT_C];
+    PORTD = (PORTD & ~s.off[PORT_D]) | s.on[PORT_D];
+
+    _edge = 0;
+    runEdges();
+}
+
+/**
+ * @brief Окончание импульса группы пинов (прерывание сравнения B, из ISR)
+ */
+void SoftPwm::onEdge()
+{
+    runEdges();
+}
+
+/**
+ * @brief Выключение всех групп, время которых наступило, и установка
+ *        следующего сравнения
+ */
+void SoftPwm::runEdges()
+{
+    const Schedule& s = _schedules[_front];
+    while (_edge < s.count)
+    {
+        const Edge& e = s.edges[_edge];
+        uint8_t now = (_timer == HwTimers::TIMER_2) ? TCNT2 : (uint8_t)TCNT1;
+        // Прерывание периода может начаться ещё при значении TOP
+        if (now == PERIOD_TOP) now = 0;
+        if (e.at > now)
+        {
+            if (_timer == HwTimers::TIMER_2) OCR2B = e.at;
+            else OCR1B = e.at;
+            return;
+        }
+
+        PORTB &= ~e.clear[PORT_B];
+        PORTC &= ~e.clear[PORT_C];
+        PORTD &= ~e.clear[PORT_D];
+        _edge++;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef SOFTPWM_H
+#define SOFTPWM_H
+
+#include <Arduino.h>
+#include "driver/hwtimer.h"
+#include "kernel/config.h"
+
+/**
+ * @brief Программный ШИМ на любых пинах 0-19
+ *
+ * Один таймер (Timer2, если свободен, иначе Timer1) считает от 0 до 255 с
+ * шагом 16 мкс (период ~4 мс, ~244 Гц). В начале периода все активные
+ * пины включаются одной записью в PORTB/PORTC/PORTD, затем прерывание
+ * сравнения B срабатывает только на различных значениях заполнения и
+ * выключает сразу всю группу пинов. Число прерываний за период равно
+ * числу различных значений заполнения плюс одно.
+ *
+ * Расписание строится в задаче и подменяется в начале следующего периода.
+ * Порты и биты пинов - по карте выводов Uno; на других целях set()
+ * возвращает false.
+ */
+class SoftPwm
+{
+public:
+    static const uint8_t MAX_CHANNELS = 12;
+    static const uint8_t MAX_PIN = 19;
+
+    SoftPwm();
+
+    bool begin();
+    void end();
+
+    bool set(uint8_t pin, uint8_t duty);
+    uint8_t get(uint8_t pin) const;
+    void detach(uint8_t pin);
+
+    bool isRunning() const { return _timer >= 0; }
+
+    // Вызываются из обработчиков прерываний таймера
+    void onPeriod();
+    void onEdge();
+
+private:
+    struct Edge
+    {
+        uint8_t at;         // Значение счётчика, на котором пины выключаются
+        uint8_t clear[3];   // Маски PORTB, PORTC, PORTD
+    };
+
+    struct Schedule
+    {
+        uint8_t on[3];      // Пины, включаемые в начале периода
+        uint8_t off[3];     // Пины с нулевым заполнением
+        uint8_t count;
+        Edge edges[MAX_CHANNELS];
+    };
+
+    uint8_t _pins[MAX_CHANNELS];
+    uint8_t _duty[MAX_CHANNELS];
+    uint8_t _channels;
+
+    Schedule _schedules[2];
+    volatile uint8_t _front;
+    volatile bool _pending;
+    // Отключённые пины, ещё не погашенные началом периода: маски портов
+    // переживают перестроения до подмены расписания
+    volatile uint8_t _released[3];
+    uint8_t _edge;
+    int8_t _timer;
+
+    int8_t findChannel(uint8_t pin) const;
+    void rebuild();
+    void runEdges();
+};
+
+extern SoftPwm softPwm;
+
+#endif
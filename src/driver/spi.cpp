@@ -0,0 +1,163 @@
+#include "spi.h"
+#include "kernel/scheduler.h"
+#include "system/irqstats.h"
+
+Spi sysSpi;
+
+// Обработчик окончания передачи байта
+ISR(SPI_STC_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_SPI_STC);
+    sysSpi.onTransfer();
+    IRQ_EXIT(IrqStats::VEC_SPI_STC);
+}
+
+namespace
+{
+    // Биты SPCR, задаваемые передачей: DORD, CPOL, CPHA, SPR1, SPR0
+    const uint8_t CONFIG_SPCR = (1 << DORD) | (1 << CPOL) | (1 << CPHA) | (1 << SPR1) | (1 << SPR0);
+    // Бит config, означающий SPI2X
+    const uint8_t CONFIG_2X = 0x80;
+}
+
+/**
+ * @brief Конструктор
+ */
+Spi::Spi() : _head(0), _tail(0), _active(nullptr), _pos(0)
+{
+}
+
+/**
+ * @brief Включение модуля SPI в режиме ведущего
+ */
+void Spi::begin()
+{
+    uint8_t state = hal::irqSave();
+    // SS выходом до включения модуля: иначе низкий уровень на нём
+    // переводит SPI в режим ведомого
+    hal::pinWrite(SS, HIGH);
+    hal::pinMode(SS, OUTPUT);
+    hal::pinMode(SCK, OUTPUT);
+    hal::pinMode(MOSI, OUTPUT);
+    hal::pinMode(MISO, INPUT);
+    SPCR = (1 << SPIE) | (1 << SPE) | (1 << MSTR);
+    hal::irqRestore(state);
+}
+
+/**
+ * @brief Выключение модуля SPI
+ *
+ * Текущая передача прерывается, очередь сбрасывается без вызова
+ * callback; статус передач остаётся прежним.
+ */
+void Spi::end()
+{
+    uint8_t state = hal::irqSave();
+    SPCR = 0;
+    if (_active && _active->csPin != NO_CS) hal::pinWrite(_active->csPin, HIGH);
+    _active = nullptr;
+    _head = _tail = 0;
+    hal::irqRestore(state);
+}
+
+/**
+ * @brief Настройки передачи для поля SpiTransaction::config
+ * @param clockHz Наибольшая допустимая частота SCK
+ * @param mode Режим SPI 0-3 (CPOL, CPHA)
+ * @param lsbFirst Передача младшим битом вперёд
+ * @return Значение config
+ */
+uint8_t Spi::config(uint32_t clockHz, uint8_t mode, bool lsbFirst)
+{
+    // Делители F_CPU: 2, 4, 8, ..., 128
+    uint8_t shift = 0;
+    while (shift < 6 && (F_CPU >> (shift + 1)) > clockHz) shift++;
+
+    uint8_t value;
+    if (shift == 6) value = (1 << SPR1) | (1 << SPR0);   // /128
+    else value = ((shift >> 1) & 0x03) | ((shift & 1) ? 0 : CONFIG_2X);
+
+    value |= (mode & 0x03) << CPHA;
+    if (lsbFirst) value |= (1 << DORD);
+    return value;
+}
+
+/**
+ * @brief Постановка передачи в очередь
+ * @param transaction Передача; заполнены все поля, кроме status
+ * @return false при пустой передаче, переполнении очереди или если
+ *         передача уже в очереди
+ */
+bool Spi::submit(SpiTransaction& transaction)
+{
+    if (transaction.length == 0) return false;
+
+    uint8_t state = hal::irqSave();
+    uint8_t next = (_head + 1) & (QUEUE_SIZE - 1);
+    bool accepted = next != _tail &&
+        transaction.status != SpiTransaction::QUEUED &&
+        transaction.status != SpiTransaction::ACTIVE;
+    if (accepted)
+    {
+        transaction.status = SpiTransaction::QUEUED;
+        _queue[_head] = &transaction;
+        _head = next;
+        startNext();
+    }
+    hal::irqRestore(state);
+    return accepted;
+}
+
+/**
+ * @brief Число передач, ожидающих в очереди (без текущей)
+ */
+uint8_t Spi::pending() const
+{
+    return (_head - _tail) & (QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief Начало следующей передачи из очереди (прерывания запрещены)
+ */
+void Spi::startNext()
+{
+    if (_active || _head == _tail) return;
+
+    SpiTransaction* t = _queue[_tail];
+    _tail = (_tail + 1) & (QUEUE_SIZE - 1);
+    _active = t;
+    _pos = 0;
+    t->status = SpiTransaction::ACTIVE;
+
+    SPCR = (1 << SPIE) | (1 << SPE) | (1 << MSTR) | (t->config & CONFIG_SPCR);
+    SPSR = (t->config & CONFIG_2X) ? (1 << SPI2X) : 0;
+    if (t->csPin != NO_CS) hal::pinWrite(t->csPin, LOW);
+    SPDR = t->tx ? t->tx[0] : 0xFF;
+}
+
+/**
+ * @brief Обработка окончания передачи байта (из ISR)
+ */
+void Spi::onTransfer()
+{
+    SpiTransaction* t = _active;
+    if (!t) return;
+
+    uint8_t received = SPDR;
+    if (t->rx) t->rx[_pos] = received;
+    _pos++;
+
+    if (_pos < t->length)
+    {
+        SPDR = t->tx ? t->tx[_pos] : 0xFF;
+        return;
+    }
+
+    if (t->csPin != NO_CS) hal::pinWrite(t->csPin, HIGH);
+    _active = nullptr;
+    t->status = SpiTransaction::DONE;
+    // callback может сразу поставить передачу в очередь снова
+    if (t->callback) t->callback(*t);
+    if (t->sem >= 0) kernel.sem_signal_isr(t->sem);
+    startNext();
+}
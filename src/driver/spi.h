@@ -0,0 +1,81 @@
+#ifndef SPI_H
+#define SPI_H
+
+#include "hal/hal.h"
+
+struct SpiTransaction;
+
+typedef void (*SpiCallback)(SpiTransaction& transaction);
+
+/**
+ * @brief Передача по SPI, поставленная в очередь
+ *
+ * Структура и буферы принадлежат вызывающему и не должны меняться до
+ * завершения (status == DONE). tx == nullptr - передаются 0xFF,
+ * rx == nullptr - принятые байты отбрасываются; rx может совпадать с tx.
+ */
+struct SpiTransaction
+{
+    enum Status : uint8_t
+    {
+        IDLE,       // Не поставлена в очередь
+        QUEUED,
+        ACTIVE,
+        DONE
+    };
+
+    uint8_t csPin;           // Пин выбора устройства (активный низкий), Spi::NO_CS - без него
+    uint8_t config;          // Режим и частота из Spi::config()
+    const uint8_t* tx;
+    uint8_t* rx;
+    uint16_t length;
+    SpiCallback callback;    // Вызывается из ISR по завершении, может быть nullptr
+    int8_t sem;              // Семафор, освобождаемый по завершении, -1 - нет
+    volatile Status status;
+};
+
+/**
+ * @brief Ведущий SPI с очередью передач и обменом по прерыванию SPI_STC
+ *
+ * submit() ставит передачу в очередь и сразу возвращается: каждый
+ * следующий байт записывается в SPDR из обработчика прерывания, а по
+ * окончании передачи снимается CS, вызывается callback, освобождается
+ * семафор (через sem_signal_isr) и начинается следующая передача.
+ * Задача может ждать на семафоре или проверять status.
+ *
+ * Выводы SCK/MOSI/MISO/SS берутся из карты выводов ядра Arduino; SS
+ * настраивается на выход, чтобы модуль не перешёл в режим ведомого.
+ * Не использовать вместе с библиотекой SPI.
+ */
+class Spi
+{
+public:
+    static const uint8_t QUEUE_SIZE = 8;    // Степень двойки
+    static const uint8_t NO_CS = 0xFF;
+
+    Spi();
+
+    void begin();
+    void end();
+
+    static uint8_t config(uint32_t clockHz, uint8_t mode = 0, bool lsbFirst = false);
+
+    bool submit(SpiTransaction& transaction);
+    bool isBusy() const { return _active != nullptr; }
+    uint8_t pending() const;
+
+    void onTransfer();
+
+private:
+    SpiTransaction* _queue[QUEUE_SIZE];
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    SpiTransaction* volatile _active;
+    uint16_t _pos;
+
+    void startNext();
+};
+
+extern Spi sysSpi;
+
+#endif
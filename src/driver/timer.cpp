@@ -1,60 +1,167 @@
 #include "timer.h"
 #include "kernel/scheduler.h"
-#include <Arduino.h>
 
-// Обработчик прерывания таймера
-ISR(TIMER1_COMPA_vect, ISR_NOBLOCK) 
+Timer sysTimer;
+
+namespace
 {
-    sysTimer.update();
+    // Обработчик тика для модели времени; на AVR тик вызывает вектор сравнения в hwtimer.cpp
+    void onTick()
+    {
+        sysTimer.update();
+    }
 }
 
 /**
  * @brief Инициализация системного таймера
+ * @param source Аппаратный таймер для тика 1 мс (Timer1 или Timer2)
+ * @return true если таймер захвачен
+ *
+ * Перенос тика на Timer2 освобождает 16-битный Timer1 для ШИМ или захвата.
  */
-void Timer::begin() 
+bool Timer::begin(HwTimers::Id source)
 {
-    noInterrupts();
-    TCCR1A = 0;
-    TCCR1B = 0;
-    TCNT1 = 0;
-    OCR1A = 1999;  // 16MHz / (8 * 1000Hz) - 1 = 1999
-    TCCR1B |= (1 << WGM12);  // Режим CTC
-    TCCR1B |= (1 << CS11);   // Предделитель = 8 (вместо CS10)
-    TIMSK1 |= (1 << OCIE1A); // Разрешить прерывание
+    if (source != HwTimers::TIMER_1 && source != HwTimers::TIMER_2) return false;
+    if (!HwTimers::acquire(source, HwTimers::OWNER_SYSTICK)) return false;
+    if (_initialized && _source != source) HwTimers::release(_source, HwTimers::OWNER_SYSTICK);
+
+    hal::irqDisable();
+    if (source == HwTimers::TIMER_2)
+    {
+        _ticksPerMs = TIMER2_TICKS_PER_MS;
+        _usShl = 2;
+        _usShr = 0;
+    }
+    else
+    {
+        _ticksPerMs = TIMER1_TICKS_PER_MS;
+        _usShl = 0;
+        _usShr = (TIMER1_TICKS_PER_US > 1) ? 1 : 0;
+    }
+    hal::tickStart(source, _ticksPerMs, onTick);
+    // Остановка тика на прежнем таймере
+    if (_initialized && _source != source)
+    {
+        hal::tickStop(_source);
+    }
+    _source = source;
     _millis = 0;
-    _last_tick = 0;
-    interrupts();
+    _epoch = 0;
+    _seq = 0;
+    _initialized = true;
+    hal::irqEnable();
+    return true;
 }
 
 /**
  * @brief Обновление счетчика времени
  */
-void Timer::update() 
+void Timer::update()
+{
+    if (++_millis == 0)
+    {
+        _epoch++;
+    }
+    _seq++;
+    if (_tickHook) _tickHook();
+}
+
+/**
+ * @brief Установка обработчика тика
+ * @param hook Функция, вызываемая из прерывания тика раз в 1 мс после
+ *             обновления времени (nullptr - отключить)
+ *
+ * Обработчик один на систему и должен выполняться за единицы
+ * микросекунд: на это время задерживаются все прерывания.
+ */
+void Timer::setTickHook(TickHook hook)
 {
-    _millis++;
+    uint8_t state = hal::irqSave();
+    _tickHook = hook;
+    hal::irqRestore(state);
+}
+
+/**
+ * @brief Согласованное чтение счётчиков без запрета прерываний
+ * @param ms Миллисекунды (младшие 32 бита)
+ * @param epoch Количество переполнений миллисекунд
+ * @param ticks Значение счётчика таймера внутри текущей миллисекунды
+ *
+ * Если прерывание таймера произошло во время чтения, _seq изменится
+ * и чтение повторяется. Если прерывания запрещены (вызов из ISR или
+ * критической секции), а сравнение уже сработало, учитываем ещё
+ * не обработанный тик по флагу OCF1A/OCF2A. Прерывания запрещаются
+ * только на чтение 16-битного TCNT1 (hal::tickCounter).
+ */
+void Timer::snapshot(uint32_t& ms, uint16_t& epoch, uint16_t& ticks) const
+{
+    hal::tickPoll();
+    uint8_t seq;
+    do
+    {
+        seq = _seq;
+        ms = _millis;
+        epoch = _epoch;
+        ticks = hal::tickCounter(_source);
+        bool pending = hal::tickPending(_source);
+        if (pending && ticks < _ticksPerMs / 2)
+        {
+            if (++ms == 0) epoch++;
+        }
+    } while (seq != _seq);
 }
 
 /**
  * @brief Получить текущее время
  * @return Количество миллисекунд с начала работы
  */
-uint32_t Timer::millis() const 
+uint32_t Timer::millis() const
 {
+    hal::tickPoll();
     uint32_t m;
-    noInterrupts();
-    m = _millis;
-    interrupts();
+    uint8_t seq;
+    do
+    {
+        seq = _seq;
+        m = _millis;
+    } while (seq != _seq);
     return m;
 }
 
+/**
+ * @brief Получить текущее время с точностью до микросекунды
+ * @return Микросекунды с начала работы (переполнение через ~71 мин,
+ *         разность двух значений корректна при переполнении)
+ */
+uint32_t Timer::micros() const
+{
+    uint32_t ms;
+    uint16_t epoch, ticks;
+    snapshot(ms, epoch, ticks);
+    return ms * 1000UL + ticksToMicros(ticks);
+}
+
+/**
+ * @brief Полный аптайм без переполнения
+ * @return Микросекунды с начала работы (64 бита)
+ */
+uint64_t Timer::uptimeMicros() const
+{
+    uint32_t ms;
+    uint16_t epoch, ticks;
+    snapshot(ms, epoch, ticks);
+    uint64_t total_ms = ((uint64_t)epoch << 32) | ms;
+    return total_ms * 1000ULL + ticksToMicros(ticks);
+}
+
 /**
  * @brief Задержка
  * @param ms Время задержки в миллисекундах
  */
-void Timer::delay(uint32_t ms) 
+void Timer::delay(uint32_t ms)
 {
-    uint32_t start = _millis;
-    while (_millis - start < ms) 
+    uint32_t start = millis();
+    while (millis() - start < ms)
     {
         kernel.run();
     }
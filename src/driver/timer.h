@@ -1,29 +1,63 @@
 #ifndef TIMER_H
 #define TIMER_H
 
-#include <Arduino.h>
+#include "hal/hal.h"
+#include "driver/hwtimer.h"
 
-class Timer 
+class Timer
 {
+public:
+    typedef void (*TickHook)();
+
+    // Timer1 с предделителем 8: количество тактов счётчика на 1 мс и 1 мкс
+    static constexpr uint16_t TIMER1_TICKS_PER_MS = F_CPU / 8 / 1000;
+    static constexpr uint8_t TIMER1_TICKS_PER_US = F_CPU / 8 / 1000000;
+    // Timer2 с предделителем 64 (16 МГц) или 32 (8 МГц): 4 мкс на такт
+    static constexpr uint16_t TIMER2_TICKS_PER_MS = 250;
+
 private:
-    volatile uint32_t _millis;   
-    uint32_t _last_tick;        
-    bool _initialized;       
-    
+    volatile uint32_t _millis;
+    volatile uint16_t _epoch;    // Количество переполнений _millis (старшие биты аптайма)
+    volatile uint8_t _seq;       // Номер тика для согласованного чтения без cli/sei
+    bool _initialized;
+    HwTimers::Id _source;
+    uint16_t _ticksPerMs;
+    uint8_t _usShl;              // Перевод тактов в мкс: (ticks << _usShl) >> _usShr
+    uint8_t _usShr;
+    volatile TickHook _tickHook;
+
+    void snapshot(uint32_t& ms, uint16_t& epoch, uint16_t& ticks) const;
+
 public:
-    Timer() : _millis(0), _last_tick(0), _initialized(false) {}
-    
-    void begin();
-    
+    Timer()
+        : _millis(0), _epoch(0), _seq(0), _initialized(false),
+          _source(HwTimers::TIMER_1), _ticksPerMs(TIMER1_TICKS_PER_MS), _usShl(0), _usShr(TIMER1_TICKS_PER_US > 1 ? 1 : 0), _tickHook(nullptr) {}
+
+    bool begin(HwTimers::Id source = HwTimers::TIMER_1);
+
     uint32_t millis() const;
-    
+
+    uint32_t micros() const;
+
+    uint64_t uptimeMicros() const;
+
     void delay(uint32_t ms);
 
     bool isInitialized() const { return _initialized; }
-    
+
     void update();
+
+    void setTickHook(TickHook hook);
+
+    HwTimers::Id getSource() const { return _source; }
+
+    uint16_t ticks() const { return hal::tickCounter(_source); }
+
+    uint16_t ticksPerMs() const { return _ticksPerMs; }
+
+    uint32_t ticksToMicros(uint16_t ticks) const { return ((uint32_t)ticks << _usShl) >> _usShr; }
 };
 
 extern Timer sysTimer;
 
-#endif
\ No newline at end of file
+#endif
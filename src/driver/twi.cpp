@@ -0,0 +1,247 @@
+#include "twi.h"
+#include "kernel/scheduler.h"
+#include "system/irqstats.h"
+
+Twi sysTwi;
+
+// Обработчик смены состояния шины
+ISR(TWI_vect)
+{
+    IRQ_ENTER(IrqStats::VEC_TWI);
+    sysTwi.onInterrupt();
+    IRQ_EXIT(IrqStats::VEC_TWI);
+}
+
+namespace
+{
+    // Коды состояния TWSR (без битов предделителя)
+    enum : uint8_t
+    {
+        TW_BUS_ERROR = 0x00,
+        TW_START = 0x08,
+        TW_REP_START = 0x10,
+        TW_MT_SLA_ACK = 0x18,
+        TW_MT_SLA_NACK = 0x20,
+        TW_MT_DATA_ACK = 0x28,
+        TW_MT_DATA_NACK = 0x30,
+        TW_ARB_LOST = 0x38,
+        TW_MR_SLA_ACK = 0x40,
+        TW_MR_SLA_NACK = 0x48,
+        TW_MR_DATA_ACK = 0x50,
+        TW_MR_DATA_NACK = 0x58
+    };
+
+    // Команды TWCR
+    const uint8_t CMD_NEXT = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+    const uint8_t CMD_ACK = CMD_NEXT | (1 << TWEA);
+    const uint8_t CMD_START = CMD_NEXT | (1 << TWSTA);
+    const uint8_t CMD_STOP = CMD_NEXT | (1 << TWSTO);
+}
+
+/**
+ * @brief Конструктор
+ */
+Twi::Twi() : _head(0), _tail(0), _active(nullptr), _pos(0), _reading(false), _errors(0)
+{
+}
+
+/**
+ * @brief Включение модуля TWI в режиме ведущего
+ * @param clockHz Частота SCL (обычно 100000 или 400000)
+ * @param pullups Включить внутренние подтяжки SDA/SCL
+ */
+void Twi::begin(uint32_t clockHz, bool pullups)
+{
+    uint8_t state = hal::irqSave();
+    if (pullups)
+    {
+        hal::pinMode(SDA, INPUT_PULLUP);
+        hal::pinMode(SCL, INPUT_PULLUP);
+    }
+    // SCL = F_CPU / (16 + 2 * TWBR) при предделителе 1
+    uint32_t twbr = (F_CPU / clockHz > 16) ? (F_CPU / clockHz - 16) / 2 : 0;
+    TWSR = 0;
+    TWBR = (twbr > 0xFF) ? 0xFF : twbr;
+    TWCR = (1 << TWEN) | (1 << TWIE);
+    hal::irqRestore(state);
+}
+
+/**
+ * @brief Выключение модуля TWI
+ *
+ * Текущий обмен обрывается без STOP, очередь сбрасывается без вызова
+ * callback.
+ */
+void Twi::end()
+{
+    uint8_t state = hal::irqSave();
+    TWCR = 0;
+    _active = nullptr;
+    _head = _tail = 0;
+    hal::irqRestore(state);
+}
+
+/**
+ * @brief Постановка обмена в очередь
+ * @param transaction Обмен; заполнены все поля, кроме status
+ * @return false при переполнении очереди или если обмен уже в очереди
+ */
+bool Twi::submit(TwiTransaction& transaction)
+{
+    if (transaction.address > 0x7F) return false;
+
+    uint8_t state = hal::irqSave();
+    uint8_t next = (_head + 1) & (QUEUE_SIZE - 1);
+    bool accepted = next != _tail &&
+        transaction.status != TwiTransaction::QUEUED &&
+        transaction.status != TwiTransaction::ACTIVE;
+    if (accepted)
+    {
+        transaction.status = TwiTransaction::QUEUED;
+        _queue[_head] = &transaction;
+        _head = next;
+        if (!_active)
+        {
+            // Шина свободна: дождаться окончания предыдущего STOP (единицы мкс)
+            while (TWCR & (1 << TWSTO)) {}
+            startNext();
+            TWCR = CMD_START;
+        }
+    }
+    hal::irqRestore(state);
+    return accepted;
+}
+
+/**
+ * @brief Число обменов, ожидающих в очереди (без текущего)
+ */
+uint8_t Twi::pending() const
+{
+    return (_head - _tail) & (QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief Выбор следующего обмена из очереди (прерывания запрещены)
+ *
+ * Условие START формирует вызывающий.
+ */
+void Twi::startNext()
+{
+    TwiTransaction* t = _queue[_tail];
+    _tail = (_tail + 1) & (QUEUE_SIZE - 1);
+    _active = t;
+    _pos = 0;
+    _reading = t->txLength == 0 && t->rxLength > 0;
+    t->status = TwiTransaction::ACTIVE;
+}
+
+/**
+ * @brief Завершение текущего обмена (из ISR)
+ * @param status Итоговый статус
+ * @param command Команда TWCR, освобождающая шину
+ *
+ * Пока выполняется callback, _active не сброшен, поэтому submit() из
+ * callback только ставит обмен в очередь. Следующий обмен начинается
+ * той же командой: STOP и START подряд (TWSTO и TWSTA вместе). После
+ * ошибки шины TWSTO сбрасывает логику без STOP, START выдаётся отдельно.
+ */
+void Twi::finish(TwiTransaction::Status status, uint8_t command)
+{
+    TwiTransaction* t = _active;
+    if (status != TwiTransaction::DONE) _errors = _errors + 1;
+    t->status = status;
+    if (t->callback) t->callback(*t);
+    if (t->sem >= 0) kernel.sem_signal_isr(t->sem);
+
+    _active = nullptr;
+    if (_head == _tail)
+    {
+        TWCR = command;
+    }
+    else if (status == TwiTransaction::BUS_ERROR && command == CMD_STOP)
+    {
+        TWCR = command;
+        startNext();
+        TWCR = CMD_START;
+    }
+    else
+    {
+        startNext();
+        TWCR = command | (1 << TWSTA);
+    }
+}
+
+/**
+ * @brief Обработка смены состояния шины (из ISR)
+ */
+void Twi::onInterrupt()
+{
+    TwiTransaction* t = _active;
+    uint8_t code = TWSR & 0xF8;
+    if (!t)
+    {
+        TWCR = (code == TW_BUS_ERROR) ? CMD_STOP : CMD_NEXT;
+        return;
+    }
+
+    switch (code)
+    {
+    case TW_START:
+    case TW_REP_START:
+        _pos = 0;
+        TWDR = (t->address << 1) | (_reading ? 1 : 0);
+        TWCR = CMD_NEXT;
+        break;
+
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+        if (_pos < t->txLength)
+        {
+            TWDR = t->tx[_pos++];
+            TWCR = CMD_NEXT;
+        }
+        else if (t->rxLength > 0)
+        {
+            // Повторный START для чтения
+            _reading = true;
+            TWCR = CMD_START;
+        }
+        else
+        {
+            finish(TwiTransaction::DONE, CMD_STOP);
+        }
+        break;
+
+    case TW_MR_SLA_ACK:
+        TWCR = (t->rxLength > 1) ? CMD_ACK : CMD_NEXT;
+        break;
+
+    case TW_MR_DATA_ACK:
+        t->rx[_pos++] = TWDR;
+        // Последний байт подтверждается NACK
+        TWCR = (_pos + 1 < t->rxLength) ? CMD_ACK : CMD_NEXT;
+        break;
+
+    case TW_MR_DATA_NACK:
+        t->rx[_pos++] = TWDR;
+        finish(TwiTransaction::DONE, CMD_STOP);
+        break;
+
+    case TW_MT_SLA_NACK:
+    case TW_MT_DATA_NACK:
+    case TW_MR_SLA_NACK:
+        finish(TwiTransaction::NACK, CMD_STOP);
+        break;
+
+    case TW_ARB_LOST:
+        // Шина отпускается, следующий обмен начнётся, когда она освободится
+        finish(TwiTransaction::BUS_ERROR, CMD_NEXT);
+        break;
+
+    default:
+        // Ошибка шины: TWSTO сбрасывает логику TWI без формирования STOP,
+        // START вместе с ним не допускается
+        finish(TwiTransaction::BUS_ERROR, CMD_STOP);
+        break;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef TWI_H
+#define TWI_H
+
+#include "hal/hal.h"
+
+struct TwiTransaction;
+
+typedef void (*TwiCallback)(TwiTransaction& transaction);
+
+/**
+ * @brief Обмен с ведомым I2C, поставленный в очередь
+ *
+ * Сначала передаются txLength байт, затем, если rxLength > 0, после
+ * повторного START принимаются rxLength байт (чтение регистра: tx - номер
+ * регистра). Только приём - txLength = 0, только передача - rxLength = 0.
+ * Структура и буферы принадлежат вызывающему до завершения.
+ */
+struct TwiTransaction
+{
+    enum Status : uint8_t
+    {
+        IDLE,       // Не поставлен в очередь
+        QUEUED,
+        ACTIVE,
+        DONE,
+        NACK,       // Ведомый не ответил на адрес или байт данных
+        BUS_ERROR   // Потеря арбитража или ошибка шины
+    };
+
+    uint8_t address;         // 7-битный адрес
+    const uint8_t* tx;
+    uint8_t txLength;
+    uint8_t* rx;
+    uint8_t rxLength;
+    TwiCallback callback;    // Вызывается из ISR по завершении, может быть nullptr
+    int8_t sem;              // Семафор, освобождаемый по завершении, -1 - нет
+    volatile Status status;
+};
+
+/**
+ * @brief Ведущий I2C (TWI) с очередью обменов по прерыванию TWI_vect
+ *
+ * Каждое состояние шины (START, адрес, байт данных, STOP) продвигается
+ * обработчиком прерывания, задача только ставит обмен в очередь. Между
+ * обменами из очереди STOP и следующий START формируются одной командой.
+ * Завершение - как у Spi: статус, callback из ISR, семафор через
+ * sem_signal_isr(). Не использовать вместе с библиотекой Wire.
+ */
+class Twi
+{
+public:
+    static const uint8_t QUEUE_SIZE = 8;    // Степень двойки
+
+    Twi();
+
+    void begin(uint32_t clockHz = 100000, bool pullups = true);
+    void end();
+
+    bool submit(TwiTransaction& transaction);
+    bool isBusy() const { return _active != nullptr; }
+    uint8_t pending() const;
+    uint16_t getErrors() const { return _errors; }
+
+    void onInterrupt();
+
+private:
+    TwiTransaction* _queue[QUEUE_SIZE];
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    TwiTransaction* volatile _active;
+    uint8_t _pos;
+    bool _reading;
+    volatile uint16_t _errors;
+
+    void startNext();
+    void finish(TwiTransaction::Status status, uint8_t command);
+};
+
+extern Twi sysTwi;
+
+#endif
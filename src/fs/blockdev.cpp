@@ -0,0 +1,143 @@
+#include "blockdev.h"
+
+/**
+ * @brief Конструктор
+ * @param device Устройство, блоки которого кэшируются
+ */
+BlockCache::BlockCache(BlockDevice& device) : _device(device)
+{
+    invalidate();
+}
+
+/**
+ * @brief Поиск блока в кэше с загрузкой при промахе
+ * @param block Номер блока
+ * @param load Читать блок с устройства при промахе
+ * @return Слот или nullptr при ошибке устройства
+ *
+ * При промахе занимается свободный слот или слот с самым давним
+ * обращением; изменённый блок в нём сначала записывается.
+ */
+BlockCache::Slot* BlockCache::lookup(uint32_t block, bool load)
+{
+    Slot* victim = &_slots[0];
+    for (uint8_t i = 0; i < SLOTS; i++)
+    {
+        Slot& slot = _slots[i];
+        if (slot.block == block)
+        {
+            _hits++;
+            slot.used = ++_clock;
+            return &slot;
+        }
+        if (victim->block != NO_BLOCK && (slot.block == NO_BLOCK || slot.used < victim->used))
+        {
+            victim = &slot;
+        }
+    }
+
+    _misses++;
+    if (victim->dirty && !writeBack(*victim)) return nullptr;
+    victim->block = NO_BLOCK;
+    if (load && !_device.readBlock(block, victim->data)) return nullptr;
+    victim->block = block;
+    victim->used = ++_clock;
+    return victim;
+}
+
+/**
+ * @brief Запись изменённого блока на устройство
+ */
+bool BlockCache::writeBack(Slot& slot)
+{
+    if (!_device.writeBlock(slot.block, slot.data)) return false;
+    _writes++;
+    slot.dirty = false;
+    return true;
+}
+
+/**
+ * @brief Блок для чтения
+ * @param block Номер блока
+ * @return Данные блока или nullptr при ошибке устройства
+ */
+const uint8_t* BlockCache::get(uint32_t block)
+{
+    if (block >= _device.blockCount()) return nullptr;
+    Slot* slot = lookup(block, true);
+    return slot ? slot->data : nullptr;
+}
+
+/**
+ * @brief Блок для изменения
+ * @param block Номер блока
+ * @param overwrite Блок будет записан целиком: при промахе не читать
+ *        его с устройства (содержимое буфера не определено)
+ * @return Данные блока или nullptr при ошибке устройства
+ */
+uint8_t* BlockCache::modify(uint32_t block, bool overwrite)
+{
+    if (block >= _device.blockCount()) return nullptr;
+    Slot* slot = lookup(block, !overwrite);
+    if (!slot) return nullptr;
+    slot->dirty = true;
+    return slot->data;
+}
+
+/**
+ * @brief Копирование блока через кэш
+ * @param from Исходный блок
+ * @param to Блок назначения
+ * @return true если копия запланирована
+ *
+ * Исходный блок загружается в слот, и слот переименовывается в блок
+ * назначения: копия не требует второго буфера.
+ */
+bool BlockCache::copy(uint32_t from, uint32_t to)
+{
+    if (from >= _device.blockCount() || to >= _device.blockCount()) return false;
+    if (from == to) return true;
+
+    Slot* slot = lookup(from, true);
+    if (!slot || (slot->dirty && !writeBack(*slot))) return false;
+
+    // Устаревшая копия блока назначения в другом слоте отбрасывается
+    for (uint8_t i = 0; i < SLOTS; i++)
+    {
+        if (_slots[i].block == to)
+        {
+            _slots[i].block = NO_BLOCK;
+            _slots[i].dirty = false;
+        }
+    }
+    slot->block = to;
+    slot->dirty = true;
+    return true;
+}
+
+/**
+ * @brief Запись всех изменённых блоков
+ * @return false при ошибке устройства или если оно ещё занято записью
+ */
+bool BlockCache::flush()
+{
+    bool ok = true;
+    for (uint8_t i = 0; i < SLOTS; i++)
+    {
+        if (_slots[i].dirty && !writeBack(_slots[i])) ok = false;
+    }
+    return _device.sync() && ok;
+}
+
+/**
+ * @brief Сброс кэша без записи изменений
+ */
+void BlockCache::invalidate()
+{
+    for (uint8_t i = 0; i < SLOTS; i++)
+    {
+        _slots[i].block = NO_BLOCK;
+        _slots[i].used = 0;
+        _slots[i].dirty = false;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef BLOCKDEV_H
+#define BLOCKDEV_H
+
+#include "hal/hal.h"
+#include "kernel/config.h"
+
+/**
+ * @brief Устройство хранения из блоков по BLOCK_SIZE байт
+ *
+ * Реализации: SdCard (driver/sdcard.h) на AVR и FileBlockDevice
+ * (hal/native/filedev.h) поверх файла на Linux.
+ */
+class BlockDevice
+{
+public:
+    static const uint16_t BLOCK_SIZE = OsConfig::BLOCK_SIZE;
+
+    virtual bool readBlock(uint32_t block, uint8_t* buffer) = 0;
+    virtual bool writeBlock(uint32_t block, const uint8_t* data) = 0;
+    virtual uint32_t blockCount() const = 0;
+    // Завершение отложенных записей устройства
+    virtual bool sync() { return true; }
+    // Устройство ещё завершает запись; sync() в это время возвращает false
+    virtual bool isBusy() { return false; }
+};
+
+/**
+ * @brief Кэш блоков с отложенной записью и вытеснением давно не использованных
+ *
+ * Блок читается с устройства при первом обращении и остаётся в SRAM;
+ * изменённый блок записывается при вытеснении или flush(). Указатель,
+ * возвращённый get(), действителен до следующего обращения к кэшу.
+ */
+class BlockCache
+{
+public:
+    static const uint8_t SLOTS = OsConfig::BLOCK_CACHE;
+    static const uint16_t BLOCK_SIZE = BlockDevice::BLOCK_SIZE;
+
+    explicit BlockCache(BlockDevice& device);
+
+    BlockDevice& device() const { return _device; }
+
+    const uint8_t* get(uint32_t block);
+    uint8_t* modify(uint32_t block, bool overwrite = false);
+    bool copy(uint32_t from, uint32_t to);
+    bool flush();
+    void invalidate();
+
+    uint32_t getHits() const { return _hits; }
+    uint32_t getMisses() const { return _misses; }
+    uint32_t getWrites() const { return _writes; }
+
+private:
+    static const uint32_t NO_BLOCK = 0xFFFFFFFFUL;
+
+    struct Slot
+    {
+        uint32_t block;
+        uint32_t used;      // Момент последнего обращения (счётчик _clock)
+        bool dirty;
+        uint8_t data[BLOCK_SIZE];
+    };
+
+    BlockDevice& _device;
+    Slot _slots[SLOTS];
+    uint32_t _clock = 0;
+    uint32_t _hits = 0;
+    uint32_t _misses = 0;
+    uint32_t _writes = 0;
+
+    Slot* lookup(uint32_t block, bool load);
+    bool writeBack(Slot& slot);
+};
+
+#endif
@@ -1,7 +1,9 @@
 #include "fs.h"
-#include <Arduino.h>
 #include "fs/logger.h"
 #include "kernel/scheduler.h"
+#include "system/trace.h"
+#include "system/heap.h"
+#include "system/crc.h"
 
 extern Logger logger;
 extern Scheduler kernel;
@@ -17,6 +19,7 @@ FileSystem::FileSystem()
         files[i].data = nullptr;
         files[i].size = 0;
     }
+    updateSuperblock();
 }
 
 /**
@@ -37,7 +40,7 @@ FileSystem::~FileSystem()
 bool FileSystem::beginOperation() {
     if(_busy) 
     {
-        logger.log("FS: Operation rejected (busy)");
+        LOG_MSG(MSG_FS_BUSY);
         return false;
     }
     _busy = true;
@@ -74,28 +77,130 @@ bool FileSystem::validateSize(size_t size)
     return size <= MAX_FILE_SIZE;
 }
 
+/**
+ * @brief Проверка имени файла тома
+ * @param name Имя с '/' в начале
+ * @return true если том подключён и имя корректно
+ */
+bool FileSystem::validateVolumeName(const String& name) 
+{
+    if (!volume.isMounted() || !isVolumePath(name)) return false;
+    String file = name.substring(1);
+    return validateFilename(file) && file.length() <= Volume::NAME_LEN;
+}
+
+/**
+ * @brief Размер содержимого файла
+ *
+ * Текстовый файл хранится с завершающим нулём, который не входит
+ * в ограничение размера и в CRC.
+ */
+size_t FileSystem::contentSize(const File& file) 
+{
+    return file.isBinary ? file.size : file.size - 1;
+}
+
+/**
+ * @brief Контрольная сумма таблицы файлов
+ *
+ * Охватывает число файлов, имена, размеры, типы и CRC содержимого.
+ */
+uint16_t FileSystem::tableChecksum() const 
+{
+    uint16_t crc = Crc::crc16Update(Crc::CRC16_INIT, fileCount);
+    for(int i = 0; i < fileCount; i++) 
+    {
+        const File& file = files[i];
+        uint16_t size = file.size;
+        crc = Crc::crc16(file.name.c_str(), file.name.length(), crc);
+        crc = Crc::crc16(&size, sizeof(size), crc);
+        crc = Crc::crc16Update(crc, file.isBinary);
+        crc = Crc::crc16(&file.crc, sizeof(file.crc), crc);
+    }
+    return crc;
+}
+
+/**
+ * @brief Обновление суперблока после изменения таблицы
+ *
+ * Фоновая проверка текущего файла начинается заново.
+ */
+void FileSystem::updateSuperblock() 
+{
+    tableCrc = tableChecksum();
+    scrubOffset = 0;
+    scrubCrc = Crc::CRC16_INIT;
+}
+
 /**
  * @brief Проверка целостности файловой системы
  * @return true если ФС в корректном состоянии
+ *
+ * Проверяется только таблица файлов по контрольной сумме суперблока,
+ * время не зависит от размера данных. Данные проверяет scrubStep().
  */
 bool FileSystem::verifyFilesystem() 
 {
+    TRACE_FS(Trace::FS_VERIFY);
     if(!beginOperation()) return false;
     
-    bool valid = true;
-    for(int i = 0; i < fileCount; i++) 
+    bool valid = fileCount <= MAX_FILES && tableChecksum() == tableCrc;
+    for(int i = 0; valid && i < fileCount; i++) 
     {
-        if(!validateFilename(files[i].name) || !validateSize(files[i].size)) 
+        if(files[i].data == nullptr || !validateFilename(files[i].name) ||
+           !validateSize(contentSize(files[i]))) 
         {
             valid = false;
-            break;
         }
     }
+    if(valid && volume.isMounted()) 
+    {
+        valid = volume.verify();
+    }
     
     endOperation();
     return valid;
 }
 
+/**
+ * @brief Шаг фоновой проверки данных
+ * @return false если у проверенного до конца файла не совпал CRC
+ *
+ * За вызов читается не больше SCRUB_CHUNK байт одного файла; по
+ * окончании файла CRC сравнивается с сохранённым и проверка переходит
+ * к следующему. Вызывается в простое планировщика.
+ */
+bool FileSystem::scrubStep() 
+{
+    if(fileCount == 0) return true;
+    if(scrubIndex >= fileCount) 
+    {
+        scrubIndex = 0;
+        scrubOffset = 0;
+        scrubCrc = Crc::CRC16_INIT;
+    }
+
+    const File& file = files[scrubIndex];
+    size_t size = contentSize(file);
+    size_t count = size - scrubOffset;
+    if(count > SCRUB_CHUNK) count = SCRUB_CHUNK;
+    scrubCrc = Crc::crc16(file.data + scrubOffset, count, scrubCrc);
+    scrubOffset += count;
+    if(scrubOffset < size) return true;
+
+    bool valid = scrubCrc == file.crc;
+    OsConfig::FileIndex index = scrubIndex++;
+    scrubOffset = 0;
+    scrubCrc = Crc::CRC16_INIT;
+    // О порче файла сообщается один раз, до восстановления или перезаписи
+    if(!valid && !files[index].corrupt) 
+    {
+        LOG_MSG(MSG_FILE_CORRUPT, files[index].name);
+    }
+    files[index].corrupt = !valid;
+    return valid;
+}
+
 /**
  * @brief Поиск индекса файла по имени
  * @param name Имя файла для поиска
@@ -134,44 +239,70 @@ void FileSystem::freeFileData(int index)
  */
 bool FileSystem::createFile(const String& name, const String& content) 
 {
+    TRACE_FS(Trace::FS_CREATE);
+    HEAP_TAG(Heap::TAG_FS);
+    if(isVolumePath(name)) 
+    {
+        if(!validateVolumeName(name)) 
+        {
+            LOG_MSG(MSG_FILE_NAME);
+            return false;
+        }
+        String file = name.substring(1);
+        if(volume.find(file) != -1) 
+        {
+            LOG_MSG(MSG_FILE_EXISTS);
+            return false;
+        }
+        if(!volume.write(file, (const uint8_t*)content.c_str(), content.length(), false)) 
+        {
+            LOG_MSG(MSG_VOLUME_WRITE);
+            return false;
+        }
+        return true;
+    }
+
     if(!validateFilename(name)) 
     {
-        logger.log("ERR: Invalid filename");
+        LOG_MSG(MSG_FILE_NAME);
         return false;
     }
     
     if(!validateSize(content.length()))
     {
-        logger.log("ERR: File too big");
+        LOG_MSG(MSG_FILE_TOO_BIG);
         return false;
     }
     
     if(fileCount >= MAX_FILES) 
     {
-        logger.log("ERR: Max files reached");
+        LOG_MSG(MSG_FILE_LIMIT);
         return false;
     }
     
     int index = findFileIndex(name);
     if(index != -1) 
     {
-        logger.log("ERR: File exists");
+        LOG_MSG(MSG_FILE_EXISTS);
         return false;
     }
 
     files[fileCount].name = name;
     files[fileCount].isBinary = false;
+    files[fileCount].corrupt = false;
     files[fileCount].data = new uint8_t[content.length() + 1];
         if (files[fileCount].data == nullptr) 
         {
-        logger.log("ERR: Memory allocation failed");
-        kernel.emergencyDump("Memory allocation failed"); 
+        LOG_MSG(MSG_FILE_ALLOC);
+        kernel.emergencyDump(CrashLog::CAUSE_MEMORY); 
         return false;
         }
     memcpy(files[fileCount].data, content.c_str(), content.length() + 1);
     files[fileCount].size = content.length() + 1;
+    files[fileCount].crc = Crc::crc16(content.c_str(), content.length());
     
     fileCount++;
+    updateSuperblock();
     return true;
 }
 
@@ -184,6 +315,13 @@ bool FileSystem::createFile(const String& name, const String& content)
  */
 bool FileSystem::createBinaryFile(const String& name, const uint8_t* data, size_t size)
  {
+    TRACE_FS(Trace::FS_CREATE);
+    HEAP_TAG(Heap::TAG_FS);
+    if (isVolumePath(name)) 
+    {
+        return validateVolumeName(name) && volume.find(name.substring(1)) == -1 &&
+               volume.write(name.substring(1), data, size, true);
+    }
     if (fileCount >= MAX_FILES || size > MAX_FILE_SIZE) return false;
     
     int index = findFileIndex(name);
@@ -191,11 +329,14 @@ bool FileSystem::createBinaryFile(const String& name, const uint8_t* data, size_
 
     files[fileCount].name = name;
     files[fileCount].isBinary = true;
+    files[fileCount].corrupt = false;
     files[fileCount].data = new uint8_t[size];
     memcpy(files[fileCount].data, data, size);
     files[fileCount].size = size;
+    files[fileCount].crc = Crc::crc16(data, size);
     
     fileCount++;
+    updateSuperblock();
     return true;
 }
 
@@ -206,8 +347,43 @@ bool FileSystem::createBinaryFile(const String& name, const uint8_t* data, size_
  */
 String FileSystem::readFile(const String& name) 
 {
+    TRACE_FS(Trace::FS_READ);
+    if (isVolumePath(name)) 
+    {
+        // Целиком читаются только файлы до MAX_FILE_SIZE, большие - через readAt()
+        Volume::Entry entry;
+        int volumeIndex = volume.find(name.substring(1));
+        if (volumeIndex == -1 || !volume.getEntry(volumeIndex, entry) || entry.isBinary ||
+            !validateSize(entry.size)) return "";
+
+        String result;
+        result.reserve(entry.size);
+        uint8_t chunk[SCRUB_CHUNK];
+        int32_t count;
+        for (uint32_t offset = 0; (count = volume.read(volumeIndex, offset, chunk, sizeof(chunk))) > 0; offset += count) 
+        {
+            for (int32_t i = 0; i < count; i++) result += (char)chunk[i];
+        }
+        return result;
+    }
+
     int index = findFileIndex(name);
-    if (index == -1 || files[index].isBinary) return "";
+    if (index == -1) 
+    {
+        // Файл во flash, если нет переопределяющего файла в RAM
+        RomFile rom;
+        int romIndex = findRomIndex(name);
+        if (romIndex == -1 || !getRomFile(romIndex, rom) || rom.isBinary) return "";
+
+        String result;
+        result.reserve(rom.size);
+        for (uint16_t i = 0; i < rom.size; i++) 
+        {
+            result += (char)pgm_read_byte(rom.data + i);
+        }
+        return result;
+    }
+    if (files[index].isBinary) return "";
 
     return String((char*)files[index].data);
 }
@@ -221,8 +397,29 @@ String FileSystem::readFile(const String& name)
  */
 bool FileSystem::readBinaryFile(const String& name, uint8_t* buffer, size_t bufferSize) 
 {
+    TRACE_FS(Trace::FS_READ);
+    if (isVolumePath(name)) 
+    {
+        Volume::Entry entry;
+        int volumeIndex = volume.find(name.substring(1));
+        if (volumeIndex == -1 || !volume.getEntry(volumeIndex, entry) || !entry.isBinary ||
+            bufferSize < entry.size) return false;
+        return volume.read(volumeIndex, 0, buffer, entry.size) == (int32_t)entry.size;
+    }
+
     int index = findFileIndex(name);
-    if (index == -1 || !files[index].isBinary || bufferSize < files[index].size) 
+    if (index == -1) 
+    {
+        RomFile rom;
+        int romIndex = findRomIndex(name);
+        if (romIndex == -1 || !getRomFile(romIndex, rom) || !rom.isBinary || bufferSize < rom.size) 
+        {
+            return false;
+        }
+        memcpy_P(buffer, rom.data, rom.size);
+        return true;
+    }
+    if (!files[index].isBinary || bufferSize < files[index].size) 
     {
         return false;
     }
@@ -239,16 +436,92 @@ bool FileSystem::readBinaryFile(const String& name, uint8_t* buffer, size_t buff
  */
 bool FileSystem::writeFile(const String& name, const String& content) 
 {
+    TRACE_FS(Trace::FS_WRITE);
+    HEAP_TAG(Heap::TAG_FS);
+    if (isVolumePath(name)) 
+    {
+        if (!validateVolumeName(name) ||
+            !volume.write(name.substring(1), (const uint8_t*)content.c_str(), content.length(), false)) 
+        {
+            LOG_MSG(MSG_VOLUME_WRITE);
+            return false;
+        }
+        return true;
+    }
+
     int index = findFileIndex(name);
     if (index == -1) {
         return createFile(name, content);
     }
 
+    if(!validateSize(content.length()))
+    {
+        LOG_MSG(MSG_FILE_TOO_BIG);
+        return false;
+    }
+
     freeFileData(index);
     files[index].isBinary = false;
     files[index].data = new uint8_t[content.length() + 1];
     memcpy(files[index].data, content.c_str(), content.length() + 1);
     files[index].size = content.length() + 1;
+    files[index].crc = Crc::crc16(content.c_str(), content.length());
+    updateSuperblock();
+    return true;
+}
+
+/**
+ * @brief Дописывание в конец текстового файла
+ * @param name Имя файла
+ * @param content Добавляемый текст
+ * @return true если запись успешна; false без записи в лог, если
+ *         результат превысит MAX_FILE_SIZE или файл бинарный
+ *
+ * CRC продолжается по добавленным байтам, прежнее содержимое не
+ * пересчитывается.
+ */
+bool FileSystem::appendFile(const String& name, const char* content) 
+{
+    TRACE_FS(Trace::FS_WRITE);
+    HEAP_TAG(Heap::TAG_FS);
+    size_t length = strlen(content);
+    if (isVolumePath(name)) 
+    {
+        // На томе файл растёт без ограничения MAX_FILE_SIZE
+        if (!validateVolumeName(name)) return false;
+        String file = name.substring(1);
+        const uint8_t* data = (const uint8_t*)content;
+        Volume::Entry entry;
+        int volumeIndex = volume.find(file);
+        if (volumeIndex == -1) return volume.write(file, data, length, false);
+        if (!volume.getEntry(volumeIndex, entry) || entry.isBinary) return false;
+        return volume.append(file, data, length);
+    }
+
+    int index = findFileIndex(name);
+    if (index == -1) {
+        // Новый файл или переопределение файла во flash
+        return writeFile(name, readFile(name) + content);
+    }
+
+    File& file = files[index];
+    size_t oldSize = contentSize(file);
+    if (file.isBinary || !validateSize(oldSize + length)) return false;
+
+    uint8_t* data = new uint8_t[oldSize + length + 1];
+    if (data == nullptr) 
+    {
+        LOG_MSG(MSG_FILE_ALLOC);
+        kernel.emergencyDump(CrashLog::CAUSE_MEMORY); 
+        return false;
+    }
+    memcpy(data, file.data, oldSize);
+    memcpy(data + oldSize, content, length + 1);
+    freeFileData(index);
+    file.data = data;
+    file.size = oldSize + length + 1;
+    file.crc = Crc::crc16(content, length, file.crc);
+    updateSuperblock();
     return true;
 }
 
@@ -261,16 +534,27 @@ bool FileSystem::writeFile(const String& name, const String& content)
  */
 bool FileSystem::writeBinaryFile(const String& name, const uint8_t* data, size_t size) 
 {
+    TRACE_FS(Trace::FS_WRITE);
+    HEAP_TAG(Heap::TAG_FS);
+    if (isVolumePath(name)) 
+    {
+        return validateVolumeName(name) && volume.write(name.substring(1), data, size, true);
+    }
+
     int index = findFileIndex(name);
     if (index == -1) {
         return createBinaryFile(name, data, size);
     }
 
+    if(!validateSize(size)) return false;
+
     freeFileData(index);
     files[index].isBinary = true;
     files[index].data = new uint8_t[size];
     memcpy(files[index].data, data, size);
     files[index].size = size;
+    files[index].crc = Crc::crc16(data, size);
+    updateSuperblock();
     return true;
 }
 
@@ -281,9 +565,21 @@ bool FileSystem::writeBinaryFile(const String& name, const uint8_t* data, size_t
  */
 bool FileSystem::deleteFile(const String& name) 
 {
+    TRACE_FS(Trace::FS_DELETE);
+    if (isVolumePath(name)) 
+    {
+        if (!validateVolumeName(name) || !volume.remove(name.substring(1))) 
+        {
+            LOG_MSG(MSG_FILE_NOT_FOUND);
+            return false;
+        }
+        return true;
+    }
+
     int index = findFileIndex(name);
     if(index == -1) {
-        logger.log("ERR: File not found");
+        if (findRomIndex(name) != -1) LOG_MSG(MSG_FILE_READ_ONLY);
+        else LOG_MSG(MSG_FILE_NOT_FOUND);
         return false;
     }
 
@@ -294,6 +590,10 @@ bool FileSystem::deleteFile(const String& name)
         files[i] = files[i + 1];
     }
     fileCount--;
+    // Освободившийся слот не должен ссылаться на данные сдвинутого файла
+    files[fileCount].data = nullptr;
+    files[fileCount].size = 0;
+    updateSuperblock();
     return true;
 }
 
@@ -304,7 +604,64 @@ bool FileSystem::deleteFile(const String& name)
  */
 bool FileSystem::fileExists(const String& name) 
 {
-    return findFileIndex(name) != -1;
+    if (isVolumePath(name)) return volume.isMounted() && volume.find(name.substring(1)) != -1;
+    return findFileIndex(name) != -1 || findRomIndex(name) != -1;
+}
+
+/**
+ * @brief Доступ к файлу по индексу без копирования (только чтение)
+ * @param index Индекс файла (0..getFileCount()-1)
+ * @return Указатель на файл или nullptr при ошибке
+ *
+ * Указатель действителен до следующей операции записи или удаления.
+ */
+const FileSystem::File* FileSystem::getFile(int index) const
+{
+    return (index >= 0 && index < fileCount) ? &files[index] : nullptr;
+}
+
+/**
+ * @brief Подключение таблицы файлов во flash
+ * @param table Таблица RomFile в PROGMEM
+ * @param count Число записей
+ *
+ * Файлы таблицы доступны для чтения под своими именами, пока в RAM нет
+ * файла с тем же именем. Запись по такому имени создаёт файл в RAM,
+ * который переопределяет файл во flash; после его удаления снова
+ * читается исходное содержимое.
+ */
+void FileSystem::mountRom(const RomFile* table, uint8_t count)
+{
+    romTable = table;
+    romCount = count;
+}
+
+/**
+ * @brief Копия записи таблицы flash
+ * @param index Индекс записи (0..getRomCount()-1)
+ * @param file Запись; name и data остаются адресами во flash
+ * @return true если индекс корректен
+ */
+bool FileSystem::getRomFile(uint8_t index, RomFile& file) const
+{
+    if (index >= romCount) return false;
+    memcpy_P(&file, &romTable[index], sizeof(RomFile));
+    return true;
+}
+
+/**
+ * @brief Поиск файла во flash по имени
+ * @param name Имя файла
+ * @return Индекс записи или -1 если не найдена
+ */
+int FileSystem::findRomIndex(const String& name) const
+{
+    for (uint8_t i = 0; i < romCount; i++)
+    {
+        const char* romName = (const char*)pgm_read_ptr(&romTable[i].name);
+        if (strcmp_P(name.c_str(), romName) == 0) return i;
+    }
+    return -1;
 }
 
 /**
@@ -325,5 +682,112 @@ String FileSystem::listFiles()
         result += files[i].size;
         result += " bytes)\n";
     }
+
+    RomFile rom;
+    for(uint8_t i = 0; getRomFile(i, rom); i++) 
+    {
+        String name = reinterpret_cast<const __FlashStringHelper*>(rom.name);
+        if(findFileIndex(name) != -1) continue;
+        result += "  ";
+        result += name;
+        result += rom.isBinary ? " (rom binary, " : " (rom text, ";
+        result += rom.size;
+        result += " bytes)\n";
+    }
+
+    Volume::Entry entry;
+    for(uint8_t i = 0; i < Volume::MAX_ENTRIES; i++) 
+    {
+        if(!volume.getEntry(i, entry)) continue;
+        result += "  /";
+        result += volume.entryName(entry);
+        result += entry.isBinary ? " (vol binary, " : " (vol text, ";
+        result += entry.size;
+        result += " bytes)\n";
+    }
     return result;
+}
+
+/**
+ * @brief Подключение тома на блочном устройстве
+ * @param cache Кэш устройства
+ * @param formatIfBlank Форматировать устройство, если его блок 0 прочитан
+ *                      и пуст (Volume::isBlank); иначе устройство не
+ *                      меняется, даже если тома на нём нет
+ * @return true если том подключён
+ *
+ * Файлы тома доступны по именам с '/' в начале. Изменения остаются в
+ * кэше до sync() или вытеснения блока.
+ */
+bool FileSystem::mountVolume(BlockCache& cache, bool formatIfBlank)
+{
+    if (volume.mount(cache)) return true;
+    // Чужая ФС, ошибка чтения или повреждённый каталог не стираются
+    if (!formatIfBlank || !Volume::isBlank(cache) || !volume.format(cache)) 
+    {
+        LOG_MSG(MSG_VOLUME_MOUNT);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Отключение тома с записью изменений
+ */
+void FileSystem::unmountVolume()
+{
+    volume.unmount();
+}
+
+/**
+ * @brief Запись изменённых блоков тома на устройство
+ * @return false при ошибке устройства или пока оно ещё пишет последний
+ *         блок (isVolumeBusy(), повторить позже); true без тома
+ */
+bool FileSystem::sync()
+{
+    return !volume.isMounted() || volume.sync();
+}
+
+/**
+ * @brief Чтение части файла без копии всего содержимого
+ * @param name Имя файла (RAM, flash или том)
+ * @param offset Смещение от начала
+ * @param buffer Буфер
+ * @param size Размер буфера
+ * @return Прочитано байт (0 за концом файла) или -1, если файла нет
+ */
+int32_t FileSystem::readAt(const String& name, uint32_t offset, uint8_t* buffer, size_t size)
+{
+    TRACE_FS(Trace::FS_READ);
+    if (isVolumePath(name)) 
+    {
+        int volumeIndex = volume.find(name.substring(1));
+        return (volumeIndex == -1) ? -1 : volume.read(volumeIndex, offset, buffer, size);
+    }
+
+    const uint8_t* data;
+    size_t total;
+    bool flash = false;
+    int index = findFileIndex(name);
+    if (index != -1) 
+    {
+        data = files[index].data;
+        total = contentSize(files[index]);
+    }
+    else 
+    {
+        RomFile rom;
+        int romIndex = findRomIndex(name);
+        if (romIndex == -1 || !getRomFile(romIndex, rom)) return -1;
+        data = rom.data;
+        total = rom.size;
+        flash = true;
+    }
+
+    if (offset >= total) return 0;
+    if (size > total - offset) size = total - offset;
+    if (flash) memcpy_P(buffer, data + offset, size);
+    else memcpy(buffer, data + offset, size);
+    return size;
 }
\ No newline at end of file
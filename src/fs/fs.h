@@ -1,7 +1,9 @@
 #ifndef FS_H
 #define FS_H
 
-#include <Arduino.h>
+#include "hal/hal.h"
+#include "kernel/config.h"
+#include "fs/volume.h"
 
 class FileSystem 
 {
@@ -12,16 +14,36 @@ public:
         uint8_t* data;     
         size_t size;       
         bool isBinary;     
+        uint16_t crc;      // CRC-16 содержимого (без завершающего нуля у текста)
+        bool corrupt;      // Порча уже записана в лог scrubStep()
     };
 
-    static const int MAX_FILES = 5;         
-    static const int MAX_FILE_SIZE = 512;    
-    static const int MAX_FILENAME_LEN = 16;  
+    /**
+     * @brief Файл только для чтения во flash
+     *
+     * Таблица, имена и данные размещаются в PROGMEM и не занимают SRAM.
+     * size - число байт данных (без завершающего нуля у текста).
+     */
+    struct RomFile
+    {
+        const char* name;
+        const uint8_t* data;
+        uint16_t size;
+        bool isBinary;
+    };
+
+    // Ёмкость задаётся в kernel/config.h (OS_MAX_FILES, OS_MAX_FILE_SIZE)
+    static const int MAX_FILES = OsConfig::MAX_FILES;
+    static const int MAX_FILE_SIZE = OsConfig::MAX_FILE_SIZE;
+    static const int MAX_FILENAME_LEN = OsConfig::MAX_FILENAME_LEN;
+    // Байт данных, проверяемых за один вызов scrubStep()
+    static const int SCRUB_CHUNK = 32;
 
     FileSystem();
     ~FileSystem();
     
     bool verifyFilesystem();
+    bool scrubStep();
     
     bool createFile(const String& name, const String& content = "");
     bool createBinaryFile(const String& name, const uint8_t* data, size_t size);
@@ -29,23 +51,55 @@ public:
     bool readBinaryFile(const String& name, uint8_t* buffer, size_t bufferSize);
     bool writeFile(const String& name, const String& content);
     bool writeBinaryFile(const String& name, const uint8_t* data, size_t size);
+    bool appendFile(const String& name, const char* content);
+    bool appendFile(const String& name, const String& content) { return appendFile(name, content.c_str()); }
     bool deleteFile(const String& name);
     bool fileExists(const String& name);
     String listFiles();
     
     int getFileCount() const { return fileCount; }
+    const File* getFile(int index) const;
+
+    void mountRom(const RomFile* table, uint8_t count);
+    uint8_t getRomCount() const { return romCount; }
+    bool getRomFile(uint8_t index, RomFile& file) const;
+    int findRomIndex(const String& name) const;
+
+    // Файлы тома на блочном устройстве: имена с '/' в начале ("/log.txt")
+    static bool isVolumePath(const String& name) { return name.length() > 1 && name.charAt(0) == '/'; }
+    bool mountVolume(BlockCache& cache, bool formatIfBlank = false);
+    void unmountVolume();
+    bool isVolumeMounted() const { return volume.isMounted(); }
+    bool isVolumeBusy() const { return volume.isBusy(); }
+    Volume& getVolume() { return volume; }
+    bool sync();
+    int32_t readAt(const String& name, uint32_t offset, uint8_t* buffer, size_t size);
 
 private:
     File files[MAX_FILES]; 
-    int fileCount = 0;      
+    OsConfig::FileIndex fileCount = 0;
     volatile bool _busy = false;
+    const RomFile* romTable = nullptr;
+    uint8_t romCount = 0;
+    Volume volume;
+
+    // Суперблок: контрольная сумма таблицы файлов
+    uint16_t tableCrc = 0;
+    // Положение фоновой проверки данных
+    OsConfig::FileIndex scrubIndex = 0;
+    uint16_t scrubOffset = 0;
+    uint16_t scrubCrc = 0;
 
     int findFileIndex(const String& name);
     void freeFileData(int index);
+    static size_t contentSize(const File& file);
+    uint16_t tableChecksum() const;
+    void updateSuperblock();
     bool beginOperation();
     void endOperation();
     bool validateFilename(const String& name);
     bool validateSize(size_t size);
+    bool validateVolumeName(const String& name);
 };
 
 extern FileSystem fs; 
@@ -1,32 +1,333 @@
 #include "logger.h"
 #include "driver/timer.h"
 #include "fs/fs.h"
+#include "system/trace.h"
+#include "system/heap.h"
+#include "system/telemetry.h"
+
+Logger logger;
+
+static_assert((uint8_t)Log::ERR == (uint8_t)Trace::LOG_ERR && (uint8_t)Log::WARN == (uint8_t)Trace::LOG_WARN,
+              "Log::Level must match Trace::LogLevel");
+
+namespace
+{
+    Log::Level levelOf(const String& message)
+    {
+        return message.startsWith("ERR") ? Log::ERR :
+               message.startsWith("WARN") ? Log::WARN : Log::INFO;
+    }
+
+    // Форматы сообщений во flash; форматы отключённых уровней не
+    // используются и не попадают в прошивку
+    const char EMPTY[] PROGMEM = "";
+#define OS_LOG_FORMAT(name, level, format) const char FORMAT_##name[] PROGMEM = format;
+    OS_LOG_MESSAGES(OS_LOG_FORMAT)
+#undef OS_LOG_FORMAT
+
+#define OS_LOG_FORMAT_PTR(name, level, format) (Log::isEnabled(Log::name) ? FORMAT_##name : EMPTY),
+    const char* const FORMATS[] PROGMEM = {OS_LOG_MESSAGES(OS_LOG_FORMAT_PTR)};
+#undef OS_LOG_FORMAT_PTR
+
+#define OS_LOG_LEVEL_BYTE(name, level, format) Log::level,
+    const uint8_t LEVELS[] PROGMEM = {OS_LOG_MESSAGES(OS_LOG_LEVEL_BYTE)};
+#undef OS_LOG_LEVEL_BYTE
+
+    const char LEVEL_NAMES[][5] PROGMEM = {"INFO", "WARN", "ERR"};
+
+    /**
+     * @brief Запись числа по 7 бит, старший бит - признак продолжения
+     * @return Записано байт (до 5)
+     */
+    uint8_t putVarint(uint8_t* out, uint32_t value)
+    {
+        uint8_t n = 0;
+        while (value >= 0x80)
+        {
+            out[n++] = (uint8_t)value | 0x80;
+            value >>= 7;
+        }
+        out[n++] = (uint8_t)value;
+        return n;
+    }
+
+    bool getVarint(const uint8_t* entry, uint8_t length, uint8_t& pos, uint32_t& value)
+    {
+        value = 0;
+        for (uint8_t shift = 0; pos < length && shift < 35; shift += 7)
+        {
+            uint8_t b = entry[pos++];
+            value |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Строка из записи лога для файла лога в буфере на стеке
+     *
+     * Самая длинная строка списка сообщений с временем и строковым
+     * аргументом - около 55 символов; не поместившийся конец отбрасывается.
+     */
+    class LineWriter : public Print
+    {
+    public:
+        static const uint8_t SIZE = 64;
+
+        size_t write(uint8_t c) override
+        {
+            // Место под '\n' и '\0'
+            if (length + 2 >= SIZE) return 0;
+            text[length++] = (char)c;
+            text[length] = '\0';
+            return 1;
+        }
+        using Print::write;
+
+        void endLine()
+        {
+            text[length++] = '\n';
+            text[length] = '\0';
+        }
+
+        char text[SIZE] = "";
+        uint8_t length = 0;
+    };
+}
 
 /**
  * @brief Инициализация логгера
  */
 void Logger::begin() 
 {
-    fs.createFile("log.txt", "");
+    if (!fs.fileExists(file)) fs.createFile(file, "");
 }
 
 /**
  * @brief Запись сообщения в лог
  * @param message Сообщение для записи
+ *
+ * Уровень определяется по началу текста ("ERR", "WARN"), сообщения
+ * уровня ниже OS_LOG_LEVEL отбрасываются.
  */
 void Logger::log(const String& message) 
 {
+    Log::Level level = levelOf(message);
+#if OS_LOG_LEVEL > 0
+    if (level < OS_LOG_LEVEL) return;
+#else
+    (void)level;
+#endif
+
+    TRACE_LOG(level);
+    HEAP_TAG(Heap::TAG_LOGGER);
     String timestamp = "[" + String(sysTimer.millis()) + " ms] ";
     String entry = timestamp + message + "\n";
 
+#ifdef OS_TELEMETRY
+    Telemetry::sendLog(level, message.c_str());
+#else
     Serial.print(entry);
+#endif
     
-    String oldLog = fs.readFile("log.txt");
+    if (entry.length() > MAX_LOG_SIZE) 
+    {
+        entry = entry.substring(0, MAX_LOG_SIZE - 1) + "\n";
+    }
+    append(entry.c_str());
+}
+
+/**
+ * @brief Дописывание строки в файл лога
+ * @param line Строка с '\n' в конце, не длиннее MAX_LOG_SIZE
+ */
+void Logger::append(const char* line)
+{
+    // Ошибка ФС при записи лога (нет места под log.txt) снова попала бы
+    // в лог: такая запись только выводится
+    if (writing) return;
+    writing = true;
+
+    // Пока лог не заполнен, запись дописывается без чтения всего файла.
+    // На томе запись при нехватке места теряется
+    if (fs.appendFile(file, line) || FileSystem::isVolumePath(file)) 
+    {
+        writing = false;
+        return;
+    }
+
+    String oldLog = fs.readFile(file);
+
+    // Старые записи удаляются целыми строками
+    size_t total = oldLog.length() + strlen(line);
+    if (total > MAX_LOG_SIZE) 
+    {
+        int cut = oldLog.indexOf('\n', total - MAX_LOG_SIZE - 1);
+        oldLog = (cut < 0) ? String() : oldLog.substring(cut + 1);
+    }
+
+    fs.writeFile(file, oldLog + line);
+    writing = false;
+}
+
+/**
+ * @brief Начало записи: номер сообщения и время
+ * @return Длина записи
+ */
+uint8_t Logger::start(uint8_t* entry, Log::Message id)
+{
+    entry[0] = id;
+    return 1 + putVarint(entry + 1, sysTimer.millis());
+}
+
+/**
+ * @brief Целый аргумент в формате zigzag: малые по модулю числа - 1 байт
+ */
+void Logger::put(uint8_t* entry, uint8_t& length, int32_t value)
+{
+    if (length + 5 > Log::MAX_RECORD) return;
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    length += putVarint(entry + length, zigzag);
+}
+
+/**
+ * @brief Строковый аргумент: длина и до MAX_STRING символов
+ */
+void Logger::put(uint8_t* entry, uint8_t& length, const char* text)
+{
+    if (length + 1 > Log::MAX_RECORD) return;
+    uint8_t size = strnlen(text, Log::MAX_STRING);
+    if (size > Log::MAX_RECORD - length - 1) size = Log::MAX_RECORD - length - 1;
+    entry[length++] = size;
+    memcpy(entry + length, text, size);
+    length += size;
+}
 
-    if (oldLog.length() + entry.length() > 1024) 
+/**
+ * @brief Отправка записи и сохранение в буфере последних записей
+ *
+ * Самые старые записи вытесняются целиком. В файл лога (в RAM или на
+ * томе) запись дописывается текстом, как и строки log().
+ */
+void Logger::commit(const uint8_t* entry, uint8_t length)
+{
+    TRACE_LOG(pgm_read_byte(&LEVELS[entry[0]]));
+
+#ifdef OS_TELEMETRY
+    Telemetry::sendLogRecord(entry, length);
+#else
+    print(entry, length, Serial);
+    Serial.println();
+#endif
+
+    while (used + length + 1 > Log::BUFFER_SIZE)
     {
-        oldLog = oldLog.substring(entry.length());  
+        uint16_t tail = (head + Log::BUFFER_SIZE - used) % Log::BUFFER_SIZE;
+        used -= buffer[tail] + 1;
+        count--;
     }
+    buffer[head] = length;
+    for (uint8_t i = 0; i <= length; i++)
+    {
+        if (i) buffer[head] = entry[i - 1];
+        head = (head + 1) % Log::BUFFER_SIZE;
+    }
+    used += length + 1;
+    count++;
+
+    if (writing) return;
+    LineWriter line;
+    print(entry, length, line);
+    line.endLine();
+    append(line.text);
+}
 
-    fs.writeFile("log.txt", oldLog + entry);
-}
\ No newline at end of file
+/**
+ * @brief Запись из буфера текстом
+ * @param index Номер записи, 0 - самая старая
+ * @param out Куда выводить
+ * @return false если записи с таким номером нет
+ */
+bool Logger::printRecord(uint8_t index, Print& out) const
+{
+    if (index >= count) return false;
+
+    uint16_t pos = (head + Log::BUFFER_SIZE - used) % Log::BUFFER_SIZE;
+    for (uint8_t i = 0; i < index; i++)
+    {
+        pos = (pos + buffer[pos] + 1) % Log::BUFFER_SIZE;
+    }
+
+    uint8_t entry[Log::MAX_RECORD];
+    uint8_t length = buffer[pos];
+    for (uint8_t i = 0; i < length; i++)
+    {
+        pos = (pos + 1) % Log::BUFFER_SIZE;
+        entry[i] = buffer[pos];
+    }
+    print(entry, length, out);
+    out.println();
+    return true;
+}
+
+void Logger::clearRecords()
+{
+    head = 0;
+    used = 0;
+    count = 0;
+}
+
+/**
+ * @brief Раскрытие записи по формату из flash: "[t ms] LEVEL: текст"
+ *
+ * Недостающий аргумент выводится как '?'.
+ */
+void Logger::print(const uint8_t* entry, uint8_t length, Print& out)
+{
+    uint8_t id = entry[0];
+    uint8_t pos = 1;
+    uint32_t value;
+    getVarint(entry, length, pos, value);
+    out.print('[');
+    out.print(value);
+    out.print(F(" ms] "));
+    if (id >= Log::MSG_COUNT)
+    {
+        out.print(F("? message "));
+        out.print(id);
+        return;
+    }
+    out.print(reinterpret_cast<const __FlashStringHelper*>(LEVEL_NAMES[pgm_read_byte(&LEVELS[id])]));
+    out.print(F(": "));
+
+    const char* format = (const char*)pgm_read_ptr(&FORMATS[id]);
+    for (char c = pgm_read_byte(format); c; c = pgm_read_byte(++format))
+    {
+        if (c != '%')
+        {
+            out.print(c);
+            continue;
+        }
+        c = pgm_read_byte(++format);
+        if (c == 'd')
+        {
+            if (getVarint(entry, length, pos, value)) out.print((long)(int32_t)((value >> 1) ^ (0UL - (value & 1))));
+            else out.print('?');
+        }
+        else if (c == 's')
+        {
+            uint8_t size = (pos < length) ? entry[pos++] : 0;
+            if (pos + size > length) size = length - pos;
+            out.write(entry + pos, size);
+            pos += size;
+        }
+        else if (c == '%')
+        {
+            out.print('%');
+        }
+        else if (!c)
+        {
+            break;
+        }
+    }
+}
@@ -1,16 +1,73 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include <Arduino.h>
+#include "hal/hal.h"
+#include "fs/fs.h"
+#include "fs/logmsg.h"
 
 class Logger 
 {
 public:
+    // Наибольший размер log.txt: ограничение файла ФС
+    static const int MAX_LOG_SIZE = FileSystem::MAX_FILE_SIZE;
+
     void begin();
     
     void log(const String& message);
+
+    /**
+     * @brief Запись сообщения из списка OS_LOG_MESSAGES (см. LOG_MSG)
+     * @param id Номер сообщения
+     * @param args Аргументы по порядку %d и %s формата: целые или строки
+     *
+     * В буфер последних записей и телеметрию попадают номер и двоичные
+     * аргументы (единицы байт), текст раскрывается только при выводе.
+     */
+    template <typename... Args>
+    void record(Log::Message id, Args... args)
+    {
+        uint8_t entry[Log::MAX_RECORD];
+        uint8_t length = start(entry, id);
+        pack(entry, length, args...);
+        commit(entry, length);
+    }
+
+    // Число записей в буфере и вывод записи текстом (0 - самая старая)
+    uint8_t getRecordCount() const { return count; }
+    bool printRecord(uint8_t index, Print& out) const;
+    void clearRecords();
+
+    // Файл лога; на томе ("/log.txt") лог растёт без ограничения MAX_LOG_SIZE
+    void setFile(const char* name) { file = name; }
+    const char* getFile() const { return file; }
+
+private:
+    bool writing = false;
+    const char* file = "log.txt";
+
+    // Кольцевой буфер записей: длина записи, затем запись
+    uint8_t buffer[Log::BUFFER_SIZE];
+    uint16_t head = 0;
+    uint16_t used = 0;
+    uint8_t count = 0;
+
+    void append(const char* line);
+    static uint8_t start(uint8_t* entry, Log::Message id);
+    static void put(uint8_t* entry, uint8_t& length, int32_t value);
+    static void put(uint8_t* entry, uint8_t& length, const char* text);
+    static void put(uint8_t* entry, uint8_t& length, const String& text) { put(entry, length, text.c_str()); }
+    static void pack(uint8_t*, uint8_t&) {}
+    template <typename T, typename... Rest>
+    static void pack(uint8_t* entry, uint8_t& length, T first, Rest... rest)
+    {
+        put(entry, length, first);
+        pack(entry, length, rest...);
+    }
+
+    void commit(const uint8_t* entry, uint8_t length);
+    static void print(const uint8_t* entry, uint8_t length, Print& out);
 };
 
 extern Logger logger;
 
-#endif
\ No newline at end of file
+#endif
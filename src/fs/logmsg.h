@@ -0,0 +1,105 @@
+#ifndef LOGMSG_H
+#define LOGMSG_H
+
+#include "hal/hal.h"
+#include "kernel/config.h"
+
+/*
+ * Сообщения лога с номерами вместо текста.
+ *
+ * Каждое сообщение - строка X(имя, уровень, формат) списка ниже. Номер
+ * сообщения - позиция в списке: новые сообщения добавляются в конец,
+ * иначе старые записи и захваты телеметрии декодируются неверно.
+ * Формат хранится во flash и раскрывается только при выводе; в буфер
+ * лога и кадр телеметрии попадают номер и двоичные аргументы.
+ * tools/telemetry_decode.py читает этот список как словарь.
+ *
+ * В формате: %d - целое (до 32 бит со знаком), %s - строка (до
+ * Log::MAX_STRING символов), %% - знак процента.
+ */
+#define OS_LOG_MESSAGES(X)                                              \
+    X(MSG_TASK_ADD,        ERR,  "Can't add task")                      \
+    X(MSG_TASK_EXISTS,     ERR,  "Task exists")                         \
+    X(MSG_TASK_OVERRUN,    WARN, "Task %d overrun")                     \
+    X(MSG_FS_BUSY,         WARN, "FS operation rejected (busy)")        \
+    X(MSG_FILE_CORRUPT,    ERR,  "Corrupt file %s")                     \
+    X(MSG_FILE_NAME,       ERR,  "Invalid filename")                    \
+    X(MSG_FILE_EXISTS,     ERR,  "File exists")                         \
+    X(MSG_FILE_TOO_BIG,    ERR,  "File too big")                        \
+    X(MSG_FILE_LIMIT,      ERR,  "Max files reached")                   \
+    X(MSG_FILE_ALLOC,      ERR,  "Memory allocation failed")            \
+    X(MSG_FILE_NOT_FOUND,  ERR,  "File not found")                      \
+    X(MSG_FILE_READ_ONLY,  ERR,  "Read-only file")                      \
+    X(MSG_FILE_CREATE,     ERR,  "Failed to create %s")                 \
+    X(MSG_FS_CORRUPT,      ERR,  "FS table corrupt")                    \
+    X(MSG_VOLUME_WRITE,    ERR,  "Volume write failed")                 \
+    X(MSG_VOLUME_MOUNT,    ERR,  "Volume mount failed")                 \
+    X(MSG_VOLUME_SYNC,     ERR,  "Volume sync failed")                  \
+    X(MSG_COUNTER_WRITE,   ERR,  "Failed to write counter")             \
+    X(MSG_COUNTER_MISSING, WARN, "counter.txt missing, recreating")
+
+// Наименьший уровень, для которого генерируется код: 0 - все,
+// 1 - WARN и ERR, 2 - только ERR, 3 - ничего
+#ifndef OS_LOG_LEVEL
+#define OS_LOG_LEVEL 0
+#endif
+
+// Размер буфера последних записей, байт
+#ifndef OS_LOG_BUFFER
+#if defined(OS_TARGET_MEGA) || !defined(__AVR__)
+#define OS_LOG_BUFFER 128
+#else
+#define OS_LOG_BUFFER 48
+#endif
+#endif
+
+namespace Log
+{
+    // Совпадает с Trace::LogLevel
+    enum Level : uint8_t
+    {
+        INFO,
+        WARN,
+        ERR
+    };
+
+#define OS_LOG_ENUM(name, level, format) name,
+    enum Message : uint8_t
+    {
+        OS_LOG_MESSAGES(OS_LOG_ENUM)
+        MSG_COUNT
+    };
+#undef OS_LOG_ENUM
+
+#define OS_LOG_LEVEL_OF(name, level, format) level,
+    constexpr Level LEVELS[] = {OS_LOG_MESSAGES(OS_LOG_LEVEL_OF)};
+#undef OS_LOG_LEVEL_OF
+
+    constexpr Level levelOf(Message id) { return LEVELS[id]; }
+#if OS_LOG_LEVEL > 0
+    constexpr bool isEnabled(Message id) { return levelOf(id) >= OS_LOG_LEVEL; }
+#else
+    // Уровень 0 включает всё; сравнение беззнакового уровня с 0 дало бы -Wtype-limits
+    constexpr bool isEnabled(Message) { return true; }
+#endif
+
+    // Запись: номер | время, мс | аргументы; целые - zigzag varint,
+    // строки - длина и символы
+    const uint8_t MAX_RECORD = 24;
+    const uint8_t MAX_STRING = 16;
+    const uint16_t BUFFER_SIZE = OS_LOG_BUFFER;
+    static_assert(BUFFER_SIZE > MAX_RECORD, "OS_LOG_BUFFER must hold a record");
+}
+
+/**
+ * Запись сообщения из списка: LOG_MSG(MSG_TASK_OVERRUN, index).
+ * Сообщения уровня ниже OS_LOG_LEVEL не генерируют кода, аргументы не
+ * вычисляются.
+ */
+#define LOG_MSG(id, ...)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (Log::isEnabled(Log::id)) logger.record(Log::id, ##__VA_ARGS__); \
+    } while (0)
+
+#endif
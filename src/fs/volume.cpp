@@ -0,0 +1,418 @@
+#include "volume.h"
+#include "system/crc.h"
+
+/**
+ * @brief Число блоков под size байт
+ */
+uint32_t Volume::blocksFor(uint32_t size)
+{
+    return (size + BlockDevice::BLOCK_SIZE - 1) / BlockDevice::BLOCK_SIZE;
+}
+
+/**
+ * @brief Контрольная сумма записей каталога
+ * @param directory Содержимое блока 0
+ */
+uint16_t Volume::directoryCrc(const uint8_t* directory)
+{
+    return Crc::crc16(directory + HEADER_SIZE, MAX_ENTRIES * sizeof(Entry));
+}
+
+/**
+ * @brief Устройство без данных: блок 0 прочитан и весь из 0x00 или 0xFF
+ * @param cache Кэш устройства
+ * @return false при ошибке чтения или любых других данных (чужая ФС,
+ *         повреждённый каталог тома)
+ */
+bool Volume::isBlank(BlockCache& cache)
+{
+    const uint8_t* directory = cache.get(0);
+    if (!directory) return false;
+    uint8_t fill = directory[0];
+    if (fill != 0x00 && fill != 0xFF) return false;
+    for (uint16_t i = 1; i < BlockDevice::BLOCK_SIZE; i++)
+    {
+        if (directory[i] != fill) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Создание пустого тома на всём устройстве
+ * @param cache Кэш устройства
+ * @return true если том создан и подключён
+ */
+bool Volume::format(BlockCache& cache)
+{
+    uint8_t* directory = cache.modify(0, true);
+    if (!directory) return false;
+
+    memset(directory, 0, BlockDevice::BLOCK_SIZE);
+    Header header = {MAGIC, VERSION, directoryCrc(directory), cache.device().blockCount(), 0};
+    memcpy(directory, &header, sizeof(header));
+    return cache.flush() && mount(cache);
+}
+
+/**
+ * @brief Подключение тома
+ * @param cache Кэш устройства
+ * @return false если заголовок или CRC каталога не совпадают
+ */
+bool Volume::mount(BlockCache& cache)
+{
+    _cache = nullptr;
+    const uint8_t* directory = cache.get(0);
+    if (!directory) return false;
+
+    Header header;
+    memcpy(&header, directory, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION ||
+        header.blocks > cache.device().blockCount() || header.crc != directoryCrc(directory))
+    {
+        return false;
+    }
+    _cache = &cache;
+    _blocks = header.blocks;
+    return true;
+}
+
+/**
+ * @brief Отключение тома с записью кэша
+ */
+void Volume::unmount()
+{
+    sync();
+    _cache = nullptr;
+}
+
+/**
+ * @brief Запись изменённых блоков на устройство
+ */
+bool Volume::sync()
+{
+    return _cache && _cache->flush();
+}
+
+/**
+ * @brief Проверка каталога: CRC, границы и пересечение экстентов
+ */
+bool Volume::verify()
+{
+    if (!_cache) return false;
+    const uint8_t* directory = _cache->get(0);
+    if (!directory) return false;
+
+    Header header;
+    memcpy(&header, directory, sizeof(header));
+    if (header.magic != MAGIC || header.crc != directoryCrc(directory)) return false;
+
+    for (uint8_t i = 0; i < MAX_ENTRIES; i++)
+    {
+        Entry entry;
+        if (!getEntry(i, entry)) continue;
+        if (entry.start == 0 || entry.start + entry.capacity > _blocks ||
+            blocksFor(entry.size) > entry.capacity || !isFree(entry.start, entry.capacity, i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Копия записи каталога
+ * @param index Номер записи (0..MAX_ENTRIES-1)
+ * @return false если запись свободна или ошибка чтения
+ */
+bool Volume::getEntry(uint8_t index, Entry& entry)
+{
+    if (!_cache || index >= MAX_ENTRIES) return false;
+    const uint8_t* directory = _cache->get(0);
+    if (!directory) return false;
+    memcpy(&entry, directory + HEADER_SIZE + index * sizeof(Entry), sizeof(Entry));
+    return entry.name[0] != 0;
+}
+
+/**
+ * @brief Имя файла из записи каталога
+ */
+String Volume::entryName(const Entry& entry) const
+{
+    char name[NAME_LEN + 1];
+    memcpy(name, entry.name, NAME_LEN);
+    name[NAME_LEN] = 0;
+    return String(name);
+}
+
+/**
+ * @brief Запись в каталог с обновлением CRC
+ */
+bool Volume::storeEntry(uint8_t index, const Entry& entry)
+{
+    uint8_t* directory = _cache->modify(0);
+    if (!directory) return false;
+
+    memcpy(directory + HEADER_SIZE + index * sizeof(Entry), &entry, sizeof(Entry));
+    uint16_t crc = directoryCrc(directory);
+    memcpy(directory + offsetof(Header, crc), &crc, sizeof(crc));
+    return true;
+}
+
+/**
+ * @brief Поиск файла
+ * @param name Имя без '/'
+ * @return Номер записи или -1
+ */
+int Volume::find(const String& name)
+{
+    if (name.length() == 0 || name.length() > NAME_LEN) return -1;
+    for (uint8_t i = 0; i < MAX_ENTRIES; i++)
+    {
+        Entry entry;
+        if (getEntry(i, entry) && strncmp(entry.name, name.c_str(), NAME_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Свободен ли участок блоков
+ * @param except Запись, экстент которой не учитывается (-1 - нет)
+ */
+bool Volume::isFree(uint32_t start, uint32_t count, int except)
+{
+    if (start == 0 || start + count > _blocks) return false;
+    for (uint8_t i = 0; i < MAX_ENTRIES; i++)
+    {
+        Entry entry;
+        if (i == except || !getEntry(i, entry)) continue;
+        if (start < entry.start + entry.capacity && entry.start < start + count) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Поиск первого свободного участка
+ * @param count Блоков
+ * @param except Запись, экстент которой считается свободным (-1 - нет)
+ * @return Первый блок или 0, если места нет
+ */
+uint32_t Volume::allocate(uint32_t count, int except)
+{
+    uint32_t start = 1;
+    bool moved = true;
+    while (moved)
+    {
+        moved = false;
+        for (uint8_t i = 0; i < MAX_ENTRIES; i++)
+        {
+            Entry entry;
+            if (i == except || !getEntry(i, entry)) continue;
+            if (start < entry.start + entry.capacity && entry.start < start + count)
+            {
+                start = entry.start + entry.capacity;
+                moved = true;
+            }
+        }
+    }
+    return (start + count <= _blocks) ? start : 0;
+}
+
+/**
+ * @brief Обеспечение места под size байт файла
+ * @param index Номер записи
+ * @param entry Запись; start и capacity обновляются
+ * @param size Требуемый размер
+ * @param keep Сохранить текущее содержимое при переносе
+ * @return false если места нет
+ *
+ * Экстент удваивается на месте, если за ним свободно; иначе переносится
+ * в первый подходящий участок, содержимое копируется через кэш.
+ */
+bool Volume::reserve(uint8_t index, Entry& entry, uint32_t size, bool keep)
+{
+    uint32_t needed = blocksFor(size);
+    if (needed <= entry.capacity) return true;
+    if (needed > 0xFFFF) return false;
+
+    uint32_t doubled = (uint32_t)entry.capacity * 2;
+    uint32_t grown = (doubled > needed && doubled <= 0xFFFF) ? doubled : needed;
+    if (isFree(entry.start + entry.capacity, grown - entry.capacity, index))
+    {
+        entry.capacity = grown;
+        return true;
+    }
+    if (isFree(entry.start + entry.capacity, needed - entry.capacity, index))
+    {
+        entry.capacity = needed;
+        return true;
+    }
+
+    // Без копирования новый участок может занять место прежнего
+    int except = keep ? -1 : index;
+    uint32_t capacity = grown;
+    uint32_t start = allocate(capacity, except);
+    if (start == 0)
+    {
+        capacity = needed;
+        start = allocate(capacity, except);
+        if (start == 0) return false;
+    }
+    uint32_t used = keep ? blocksFor(entry.size) : 0;
+    for (uint32_t i = 0; i < used; i++)
+    {
+        if (!_cache->copy(entry.start + i, start + i)) return false;
+    }
+    entry.start = start;
+    entry.capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Запись данных в экстент файла
+ *
+ * Блок, который начинается с записываемых данных за концом файла,
+ * не читается с устройства.
+ */
+bool Volume::writeData(const Entry& entry, uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    while (size > 0)
+    {
+        uint32_t block = entry.start + offset / BlockDevice::BLOCK_SIZE;
+        uint16_t inBlock = offset % BlockDevice::BLOCK_SIZE;
+        uint16_t chunk = BlockDevice::BLOCK_SIZE - inBlock;
+        if (chunk > size) chunk = size;
+
+        bool fresh = inBlock == 0 && (chunk == BlockDevice::BLOCK_SIZE || offset >= entry.size);
+        uint8_t* buffer = _cache->modify(block, fresh);
+        if (!buffer) return false;
+        if (fresh) memset(buffer + chunk, 0, BlockDevice::BLOCK_SIZE - chunk);
+        memcpy(buffer + inBlock, data, chunk);
+
+        offset += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+/**
+ * @brief Создание или перезапись файла
+ * @param name Имя без '/'
+ * @return false при неверном имени, заполненном каталоге или нехватке места
+ */
+bool Volume::write(const String& name, const uint8_t* data, uint32_t size, bool isBinary)
+{
+    if (!_cache || name.length() == 0 || name.length() > NAME_LEN) return false;
+
+    int index = find(name);
+    Entry entry;
+    if (index == -1)
+    {
+        for (uint8_t i = 0; i < MAX_ENTRIES && index == -1; i++)
+        {
+            if (!getEntry(i, entry)) index = i;
+        }
+        if (index == -1) return false;
+
+        uint32_t capacity = blocksFor(size);
+        if (capacity < MIN_BLOCKS) capacity = MIN_BLOCKS;
+        if (capacity > 0xFFFF) return false;
+        uint32_t start = allocate(capacity, -1);
+        if (start == 0)
+        {
+            capacity = blocksFor(size);
+            start = allocate(capacity, -1);
+            if (start == 0) return false;
+        }
+        memset(&entry, 0, sizeof(entry));
+        strncpy(entry.name, name.c_str(), NAME_LEN);
+        entry.start = start;
+        entry.capacity = capacity;
+    }
+    else
+    {
+        getEntry(index, entry);
+        if (!reserve(index, entry, size, false)) return false;
+    }
+
+    entry.size = 0;
+    entry.isBinary = isBinary;
+    if (!writeData(entry, 0, data, size)) return false;
+    entry.size = size;
+    return storeEntry(index, entry);
+}
+
+/**
+ * @brief Дописывание в конец файла
+ * @param name Имя без '/'
+ * @return false если файла нет или не хватает места
+ */
+bool Volume::append(const String& name, const uint8_t* data, uint32_t size)
+{
+    int index = find(name);
+    if (index == -1) return false;
+
+    Entry entry;
+    getEntry(index, entry);
+    if (!reserve(index, entry, entry.size + size, true)) return false;
+    if (!writeData(entry, entry.size, data, size)) return false;
+    entry.size += size;
+    return storeEntry(index, entry);
+}
+
+/**
+ * @brief Чтение части файла
+ * @param index Номер записи
+ * @param offset Смещение от начала файла
+ * @return Прочитано байт (0 за концом файла) или -1 при ошибке
+ */
+int32_t Volume::read(uint8_t index, uint32_t offset, uint8_t* buffer, uint32_t size)
+{
+    Entry entry;
+    if (!getEntry(index, entry)) return -1;
+    if (offset >= entry.size) return 0;
+    if (size > entry.size - offset) size = entry.size - offset;
+
+    uint32_t done = 0;
+    while (done < size)
+    {
+        uint32_t position = offset + done;
+        uint16_t inBlock = position % BlockDevice::BLOCK_SIZE;
+        uint16_t chunk = BlockDevice::BLOCK_SIZE - inBlock;
+        if (chunk > size - done) chunk = size - done;
+
+        const uint8_t* block = _cache->get(entry.start + position / BlockDevice::BLOCK_SIZE);
+        if (!block) return -1;
+        memcpy(buffer + done, block + inBlock, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+/**
+ * @brief Удаление файла; экстент становится свободным
+ */
+bool Volume::remove(const String& name)
+{
+    int index = find(name);
+    if (index == -1) return false;
+
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    return storeEntry(index, entry);
+}
+
+/**
+ * @brief Число блоков вне экстентов файлов
+ */
+uint32_t Volume::freeBlocks()
+{
+    if (!_cache) return 0;
+    uint32_t used = 1;
+    for (uint8_t i = 0; i < MAX_ENTRIES; i++)
+    {
+        Entry entry;
+        if (getEntry(i, entry)) used += entry.capacity;
+    }
+    return _blocks - used;
+}
@@ -0,0 +1,81 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include "fs/blockdev.h"
+
+/**
+ * @brief Том файлов на блочном устройстве
+ *
+ * Блок 0 - заголовок и каталог на MAX_ENTRIES файлов, данные файла -
+ * непрерывный участок блоков (экстент). Файл создаётся с запасом
+ * MIN_BLOCKS блоков; при дописывании сверх запаса экстент удваивается на
+ * месте, если следующие блоки свободны, иначе переносится в свободный
+ * участок. Все обращения идут через BlockCache, каталог защищён CRC-16.
+ * Имена - до NAME_LEN символов, без '/'.
+ */
+class Volume
+{
+public:
+    static const uint8_t NAME_LEN = 16;
+    static const uint16_t MIN_BLOCKS = 8;
+    static const uint32_t MAGIC = 0x5346534FUL;    // "OSFS"
+    static const uint16_t VERSION = 1;
+
+    struct Entry
+    {
+        char name[NAME_LEN];     // Без завершающего нуля при длине NAME_LEN
+        uint32_t start;          // Первый блок экстента
+        uint32_t size;           // Байт данных
+        uint16_t capacity;       // Блоков в экстенте
+        uint8_t isBinary;
+        uint8_t reserved;
+    };
+
+    static const uint8_t HEADER_SIZE = 16;
+    static const uint8_t MAX_ENTRIES = (BlockDevice::BLOCK_SIZE - HEADER_SIZE) / sizeof(Entry);
+
+    static bool isBlank(BlockCache& cache);
+    bool format(BlockCache& cache);
+    bool mount(BlockCache& cache);
+    void unmount();
+    bool isMounted() const { return _cache != nullptr; }
+    bool sync();
+    bool isBusy() const { return _cache && _cache->device().isBusy(); }
+    bool verify();
+
+    int find(const String& name);
+    bool getEntry(uint8_t index, Entry& entry);
+    String entryName(const Entry& entry) const;
+
+    bool write(const String& name, const uint8_t* data, uint32_t size, bool isBinary);
+    bool append(const String& name, const uint8_t* data, uint32_t size);
+    int32_t read(uint8_t index, uint32_t offset, uint8_t* buffer, uint32_t size);
+    bool remove(const String& name);
+    uint32_t freeBlocks();
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t crc;            // CRC-16 записей каталога
+        uint32_t blocks;         // Блоков тома
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == HEADER_SIZE, "volume header layout");
+    static_assert(sizeof(Entry) == 28, "volume entry layout");
+
+    BlockCache* _cache = nullptr;
+    uint32_t _blocks = 0;
+
+    static uint16_t directoryCrc(const uint8_t* directory);
+    static uint32_t blocksFor(uint32_t size);
+    bool storeEntry(uint8_t index, const Entry& entry);
+    bool isFree(uint32_t start, uint32_t count, int except);
+    uint32_t allocate(uint32_t count, int except);
+    bool reserve(uint8_t index, Entry& entry, uint32_t size, bool keep);
+    bool writeData(const Entry& entry, uint32_t offset, const uint8_t* data, uint32_t size);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef HAL_H
+#define HAL_H
+
+/*
+ * Граница аппаратной абстракции. Ядро, ФС, логгер и системные вызовы
+ * обращаются к железу только через эти функции и объект Serial.
+ *
+ * На AVR заголовок подключает Arduino и реализует часто вызываемые
+ * функции встроенными; остальное - в hal_avr.cpp. В сборке env:native
+ * вместо Arduino подключается hal/native/compat.h, а время, пины и
+ * сторожевой таймер моделируются в hal/native/hal_native.cpp.
+ */
+
+#ifdef __AVR__
+#include <Arduino.h>
+#include <avr/wdt.h>
+// Переменные, не обнуляемые при сбросе (сохраняются до отключения питания)
+#define HAL_NOINIT __attribute__((section(".noinit")))
+#else
+#include "hal/native/compat.h"
+#define HAL_NOINIT
+#endif
+
+#ifdef OS_IRQ_STATS
+// Замер окон с запрещёнными прерываниями (system/irqstats.cpp)
+namespace IrqStats
+{
+    void lockStart();
+    void lockEnd();
+}
+#endif
+
+namespace hal
+{
+    // Номера аппаратных таймеров для системного тика (совпадают с HwTimers::Id)
+    const uint8_t TICK_TIMER1 = 1;
+    const uint8_t TICK_TIMER2 = 2;
+
+    // Флаги причины сброса (биты MCUSR)
+    const uint8_t RESET_POWER_ON = 0x01;
+    const uint8_t RESET_EXTERNAL = 0x02;
+    const uint8_t RESET_BROWN_OUT = 0x04;
+    const uint8_t RESET_WATCHDOG = 0x08;
+
+    // Системный тик 1 кГц
+    void tickStart(uint8_t source, uint16_t ticksPerMs, void (*onTick)());
+    void tickStop(uint8_t source);
+
+    // GPIO
+    void pinMode(uint8_t pin, uint8_t mode);
+    void pinWrite(uint8_t pin, bool level);
+    bool pinRead(uint8_t pin);
+
+    // Сторожевой таймер
+    void wdtEnable(uint8_t timeout, void (*onTimeout)());
+    void wdtDisable();
+    bool wdtEnabled();
+    // Адрес прерванной инструкции (байтовый) внутри onTimeout, иначе 0
+    uint32_t faultAddress();
+
+    // Флаги RESET_* последнего сброса
+    uint8_t resetFlags();
+    [[noreturn]] void reboot();
+
+    // EEPROM (запись только изменившихся байт)
+    void eepromRead(uint16_t addr, void* data, uint16_t size);
+    void eepromWrite(uint16_t addr, const void* data, uint16_t size);
+
+#ifdef __AVR__
+    // Прерывания
+    inline void irqDisable() { cli(); }
+    inline void irqEnable() { sei(); }
+    // С -DOS_IRQ_STATS внешняя пара irqSave/irqRestore (прерывания были
+    // разрешены) измеряет окно запрета; вложенные пары не измеряются
+    inline uint8_t irqSave()
+    {
+        uint8_t state = SREG;
+        cli();
+#ifdef OS_IRQ_STATS
+        if (state & (1 << SREG_I)) IrqStats::lockStart();
+#endif
+        return state;
+    }
+    inline void irqRestore(uint8_t state)
+    {
+#ifdef OS_IRQ_STATS
+        if (state & (1 << SREG_I)) IrqStats::lockEnd();
+#endif
+        SREG = state;
+    }
+
+    // Счётчик тика внутри текущей миллисекунды и флаг необработанного тика.
+    // 16-битный TCNT1 читается через общий регистр TEMP: ISR, читающий
+    // регистры Timer1 (захват Input, IRQ_ENTER), между чтением младшего и
+    // старшего байта подменил бы старший байт, поэтому чтение без прерываний.
+    // Окно в несколько тактов не измеряется: его читает сам замер окон
+    inline uint16_t tickCounter(uint8_t source)
+    {
+        if (source == TICK_TIMER2) return TCNT2;
+        uint8_t state = SREG;
+        cli();
+        uint16_t ticks = TCNT1;
+        SREG = state;
+        return ticks;
+    }
+    inline bool tickPending(uint8_t source)
+    {
+        return (source == TICK_TIMER2) ? (TIFR2 & (1 << OCF2A)) : (TIFR1 & (1 << OCF1A));
+    }
+    // Симулятор продвигает время при чтении часов; на железе ничего не делает
+    inline void tickPoll() {}
+
+    inline void wdtReset() { wdt_reset(); }
+#else
+    void irqDisable();
+    void irqEnable();
+    uint8_t irqSave();
+    void irqRestore(uint8_t state);
+
+    uint16_t tickCounter(uint8_t source);
+    bool tickPending(uint8_t source);
+    void tickPoll();
+
+    void wdtReset();
+#endif
+}
+
+#endif
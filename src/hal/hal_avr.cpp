@@ -0,0 +1,234 @@
+#include "hal/hal.h"
+#include "kernel/config.h"
+
+#ifdef __AVR__
+
+#include <avr/eeprom.h>
+#include "system/irqstats.h"
+
+namespace
+{
+    void (*wdtHandler)() = nullptr;
+    uint32_t faultPc = 0;
+    // Флаги сброса: заполняются в .init3 до обнуления .bss
+    uint8_t resetFlagsMirror HAL_NOINIT;
+}
+
+/**
+ * @brief Сохранение и сброс MCUSR, отключение сторожевого таймера
+ *
+ * После сброса по сторожевому таймеру WDE остаётся включённым с таймаутом
+ * 15 мс, поэтому отключать его нужно до инициализации. Optiboot сам
+ * очищает MCUSR и передаёт исходное значение в r2.
+ */
+extern "C" void halCaptureReset() __attribute__((naked, used, section(".init3")));
+extern "C" void halCaptureReset()
+{
+    uint8_t flags = MCUSR;
+    if (flags == 0)
+    {
+        asm volatile ("mov %0, r2" : "=r" (flags));
+    }
+    resetFlagsMirror = flags;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+/**
+ * @brief Обработка таймаута сторожевого таймера
+ * @param pc Адрес возврата прерывания (в словах, до 22 бит)
+ */
+extern "C" void halWdtFault(uint32_t pc) __attribute__((noreturn, used));
+extern "C" void halWdtFault(uint32_t pc)
+{
+    faultPc = pc << 1;
+    TRACE_IRQ_ENTER(IrqStats::VEC_WDT);
+    if (wdtHandler) wdtHandler();
+    hal::reboot();
+}
+
+/*
+ * Прерывание сторожевого таймера. Из обработчика возврата нет, поэтому
+ * регистры не сохраняются: адрес возврата снимается с вершины стека
+ * (старший байт по SP+1) и передаётся в halWdtFault в r22..r25. На
+ * ATmega2560 счётчик команд 3-байтный: в стеке три байта адреса.
+ */
+ISR(WDT_vect, ISR_NAKED)
+{
+    asm volatile (
+        "clr r1            \n\t"
+        "in  r30, __SP_L__ \n\t"
+        "in  r31, __SP_H__ \n\t"
+#if defined(__AVR_3_BYTE_PC__)
+        "ldd r24, Z+1      \n\t"
+        "ldd r23, Z+2      \n\t"
+        "ldd r22, Z+3      \n\t"
+#else
+        "clr r24           \n\t"
+        "ldd r23, Z+1      \n\t"
+        "ldd r22, Z+2      \n\t"
+#endif
+        "clr r25           \n\t"
+        "jmp halWdtFault   \n\t"
+    );
+}
+
+namespace hal
+{
+    /**
+     * @brief Запуск тика 1 кГц в режиме CTC
+     * @param source TICK_TIMER1 или TICK_TIMER2
+     * @param ticksPerMs Тактов счётчика на 1 мс
+     * @param onTick Не используется: вектор сравнения в hwtimer.cpp
+     *               вызывает владельца таймера напрямую
+     */
+    void tickStart(uint8_t source, uint16_t ticksPerMs, void (*onTick)())
+    {
+        (void)onTick;
+        uint8_t sreg = irqSave();
+        if (source == TICK_TIMER2)
+        {
+            TCCR2A = (1 << WGM21);   // Режим CTC
+#if F_CPU >= 16000000UL
+            TCCR2B = (1 << CS22);    // Предделитель = 64
+#else
+            TCCR2B = (1 << CS21) | (1 << CS20);  // Предделитель = 32
+#endif
+            TCNT2 = 0;
+            OCR2A = ticksPerMs - 1;
+            TIFR2 = (1 << OCF2A);
+            TIMSK2 = (1 << OCIE2A);
+        }
+        else
+        {
+            TCCR1A = 0;
+            TCCR1B = 0;
+            TCNT1 = 0;
+            OCR1A = ticksPerMs - 1;  // 16MHz / (8 * 1000Hz) - 1 = 1999
+            TCCR1B |= (1 << WGM12);  // Режим CTC
+            TCCR1B |= (1 << CS11);   // Предделитель = 8 (вместо CS10)
+            TIFR1 = (1 << OCF1A);
+            TIMSK1 |= (1 << OCIE1A); // Разрешить прерывание
+        }
+        irqRestore(sreg);
+    }
+
+    /**
+     * @brief Остановка тика на таймере
+     */
+    void tickStop(uint8_t source)
+    {
+        if (source == TICK_TIMER2) TIMSK2 &= ~(1 << OCIE2A);
+        else TIMSK1 &= ~(1 << OCIE1A);
+    }
+
+    /**
+     * @brief Режим пина
+     * @param pin Номер пина
+     * @param mode INPUT, OUTPUT или INPUT_PULLUP
+     */
+    void pinMode(uint8_t pin, uint8_t mode)
+    {
+        ::pinMode(pin, mode);
+    }
+
+    /**
+     * @brief Запись уровня, атомарная относительно ISR (программный ШИМ)
+     * @param pin Номер пина (0-13)
+     * @param level Уровень
+     */
+    void pinWrite(uint8_t pin, bool level)
+    {
+#ifdef OS_UNO_PINOUT
+        uint8_t sreg = irqSave();
+        if (pin < 8)
+        {
+            if (level) PORTD |= (1 << pin);
+            else PORTD &= ~(1 << pin);
+        }
+        else
+        {
+            if (level) PORTB |= (1 << (pin - 8));
+            else PORTB &= ~(1 << (pin - 8));
+        }
+        irqRestore(sreg);
+#else
+        // Порт и бит по таблицам ядра Arduino для платы
+        volatile uint8_t* out = portOutputRegister(digitalPinToPort(pin));
+        uint8_t bit = digitalPinToBitMask(pin);
+        uint8_t sreg = irqSave();
+        if (level) *out |= bit;
+        else *out &= ~bit;
+        irqRestore(sreg);
+#endif
+    }
+
+    /**
+     * @brief Чтение уровня
+     */
+    bool pinRead(uint8_t pin)
+    {
+        return digitalRead(pin);
+    }
+
+    /**
+     * @brief Включение сторожевого таймера в режиме прерывания
+     * @param timeout Таймаут (WDTO_*)
+     * @param onTimeout Обработчик, вызываемый из WDT_vect
+     */
+    void wdtEnable(uint8_t timeout, void (*onTimeout)())
+    {
+        wdtHandler = onTimeout;
+        cli();
+        wdt_reset();
+        MCUSR &= ~(1 << WDRF);
+        WDTCSR |= (1 << WDCE) | (1 << WDE);
+        // Биты таймаута: WDP3 в 5-м разряде, WDP2..0 в младших
+        WDTCSR = (1 << WDIE) | ((timeout & 0x08) ? (1 << WDP3) : 0) | (timeout & 0x07);
+        sei();
+    }
+
+    void wdtDisable()
+    {
+        wdt_disable();
+    }
+
+    bool wdtEnabled()
+    {
+        return (WDTCSR & _BV(WDIE)) != 0;
+    }
+
+    uint32_t faultAddress()
+    {
+        return faultPc;
+    }
+
+    uint8_t resetFlags()
+    {
+        return resetFlagsMirror;
+    }
+
+    /**
+     * @brief Перезапуск через аппаратный сброс сторожевым таймером
+     *
+     * В отличие от перехода на адрес 0 сбрасывает и периферию.
+     */
+    void reboot()
+    {
+        cli();
+        wdt_enable(WDTO_15MS);
+        while(1);
+    }
+
+    void eepromRead(uint16_t addr, void* data, uint16_t size)
+    {
+        eeprom_read_block(data, (const void*)addr, size);
+    }
+
+    void eepromWrite(uint16_t addr, const void* data, uint16_t size)
+    {
+        eeprom_update_block(data, (void*)addr, size);
+    }
+}
+
+#endif
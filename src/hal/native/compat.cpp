@@ -0,0 +1,76 @@
+#ifndef __AVR__
+
+#include "hal/native/compat.h"
+#include <stdio.h>
+#include <poll.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+
+std::string String::format(unsigned long long v, unsigned char base)
+{
+    if (base < 2 || base > 16) base = DEC;
+    char buf[66];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do
+    {
+        uint8_t digit = v % base;
+        *--p = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+        v /= base;
+    } while (v);
+    return p;
+}
+
+std::string String::formatSigned(long long v, unsigned char base)
+{
+    if (v < 0 && base == DEC) return "-" + format(0ULL - (unsigned long long)v, base);
+    return format((unsigned long long)v, base);
+}
+
+std::string String::formatFloat(double v, unsigned char decimals)
+{
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    return buf;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+/**
+ * @brief Количество байт, ожидающих чтения в stdin
+ */
+int HardwareSerial::available()
+{
+    struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+    return (poll(&p, 1, 0) > 0 && (p.revents & POLLIN)) ? 1 : 0;
+}
+
+int HardwareSerial::read()
+{
+    if (!available()) return -1;
+    unsigned char c;
+    return (::read(STDIN_FILENO, &c, 1) == 1) ? c : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+
+#endif
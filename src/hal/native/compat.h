@@ -0,0 +1,195 @@
+#ifndef HAL_NATIVE_COMPAT_H
+#define HAL_NATIVE_COMPAT_H
+
+/*
+ * Минимальная замена Arduino.h для сборки env:native (Linux).
+ *
+ * Содержит только то, что используют ядро, ФС, логгер и системные
+ * вызовы: String, Print/Serial с выводом в stdout, F()/PROGMEM и
+ * константы пинов и сторожевого таймера. Функций прерываний и
+ * регистров здесь нет намеренно: всё аппаратное идёт через hal::.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+// Пины аппаратного ШИМ Arduino Uno
+#define digitalPinHasPWM(p) ((p) == 3 || (p) == 5 || (p) == 6 || (p) == 9 || (p) == 10 || (p) == 11)
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// Строки во flash: на хосте обычная память
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+
+// Таймауты сторожевого таймера (коды как в avr/wdt.h)
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+class String
+{
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const __FlashStringHelper* s) : _s(reinterpret_cast<const char*>(s)) {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(unsigned char v, unsigned char base = DEC) : _s(format(v, base)) {}
+    explicit String(int v, unsigned char base = DEC) : _s(formatSigned(v, base)) {}
+    explicit String(unsigned int v, unsigned char base = DEC) : _s(format(v, base)) {}
+    explicit String(long v, unsigned char base = DEC) : _s(formatSigned(v, base)) {}
+    explicit String(unsigned long v, unsigned char base = DEC) : _s(format(v, base)) {}
+    explicit String(float v, unsigned char decimals = 2) : _s(formatFloat(v, decimals)) {}
+    explicit String(double v, unsigned char decimals = 2) : _s(formatFloat(v, decimals)) {}
+
+    unsigned int length() const { return _s.length(); }
+    const char* c_str() const { return _s.c_str(); }
+    char charAt(unsigned int i) const { return i < _s.length() ? _s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+
+    int indexOf(char c, unsigned int from = 0) const
+    {
+        size_t pos = _s.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    int indexOf(const String& s, unsigned int from = 0) const
+    {
+        size_t pos = _s.find(s._s, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int from) const
+    {
+        return from >= _s.length() ? String() : String(_s.substr(from));
+    }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to) { unsigned int t = from; from = to; to = t; }
+        if (from >= _s.length()) return String();
+        return String(_s.substr(from, to - from));
+    }
+    bool startsWith(const String& s) const { return _s.compare(0, s._s.length(), s._s) == 0; }
+    bool endsWith(const String& s) const
+    {
+        return _s.length() >= s._s.length() &&
+               _s.compare(_s.length() - s._s.length(), s._s.length(), s._s) == 0;
+    }
+    bool equals(const String& s) const { return _s == s._s; }
+    long toInt() const { return atol(_s.c_str()); }
+    void trim()
+    {
+        size_t b = _s.find_first_not_of(" \t\r\n");
+        size_t e = _s.find_last_not_of(" \t\r\n");
+        _s = (b == std::string::npos) ? std::string() : _s.substr(b, e - b + 1);
+    }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+    bool operator==(const String& s) const { return _s == s._s; }
+    bool operator==(const char* s) const { return _s == s; }
+    bool operator!=(const String& s) const { return _s != s._s; }
+    bool operator!=(const char* s) const { return _s != s; }
+
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    String& operator+=(const char* s) { _s += s; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    String& operator+=(unsigned char v) { _s += format(v, DEC); return *this; }
+    String& operator+=(int v) { _s += formatSigned(v, DEC); return *this; }
+    String& operator+=(unsigned int v) { _s += format(v, DEC); return *this; }
+    String& operator+=(long v) { _s += formatSigned(v, DEC); return *this; }
+    String& operator+=(unsigned long v) { _s += format(v, DEC); return *this; }
+    String& operator+=(long long v) { _s += formatSigned(v, DEC); return *this; }
+    String& operator+=(unsigned long long v) { _s += format(v, DEC); return *this; }
+
+    template <typename T>
+    friend String operator+(const String& a, const T& b) { String r(a); r += b; return r; }
+    friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+
+private:
+    std::string _s;
+
+    static std::string format(unsigned long long v, unsigned char base);
+    static std::string formatSigned(long long v, unsigned char base);
+    static std::string formatFloat(double v, unsigned char decimals);
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v, int base = DEC) { return print(String(v, base)); }
+    size_t print(int v, int base = DEC) { return print(String(v, base)); }
+    size_t print(unsigned int v, int base = DEC) { return print(String(v, base)); }
+    size_t print(long v, int base = DEC) { return print(String(v, base)); }
+    size_t print(unsigned long v, int base = DEC) { return print(String(v, base)); }
+    size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    template <typename T>
+    size_t println(const T& v, int format) { size_t n = print(v, format); return n + println(); }
+};
+
+/**
+ * @brief Последовательный порт хоста: вывод в stdout, ввод из stdin
+ */
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    int available();
+    int read();
+    // stdout не ограничивает запись, как и пустой буфер передачи AVR
+    int availableForWrite() const { return 63; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,65 @@
+#include "hal/native/filedev.h"
+
+#ifndef __AVR__
+
+FileBlockDevice::~FileBlockDevice()
+{
+    close();
+}
+
+/**
+ * @brief Открытие образа, создание или дополнение нулями до blocks блоков
+ * @param path Путь к файлу образа
+ * @param blocks Размер устройства в блоках
+ * @return false если файл не открылся
+ */
+bool FileBlockDevice::open(const char* path, uint32_t blocks)
+{
+    close();
+    _file = fopen(path, "r+b");
+    if (!_file) _file = fopen(path, "w+b");
+    if (!_file) return false;
+
+    fseek(_file, 0, SEEK_END);
+    long size = ftell(_file);
+    long needed = (long)blocks * BLOCK_SIZE;
+    for (; size < needed; size++) fputc(0, _file);
+    fflush(_file);
+
+    _blocks = blocks;
+    _reads = _writes = 0;
+    return true;
+}
+
+/**
+ * @brief Закрытие образа
+ */
+void FileBlockDevice::close()
+{
+    if (_file) fclose(_file);
+    _file = nullptr;
+    _blocks = 0;
+}
+
+bool FileBlockDevice::readBlock(uint32_t block, uint8_t* buffer)
+{
+    if (!_file || block >= _blocks) return false;
+    _reads++;
+    return fseek(_file, (long)block * BLOCK_SIZE, SEEK_SET) == 0 &&
+           fread(buffer, 1, BLOCK_SIZE, _file) == BLOCK_SIZE;
+}
+
+bool FileBlockDevice::writeBlock(uint32_t block, const uint8_t* data)
+{
+    if (!_file || block >= _blocks) return false;
+    _writes++;
+    return fseek(_file, (long)block * BLOCK_SIZE, SEEK_SET) == 0 &&
+           fwrite(data, 1, BLOCK_SIZE, _file) == BLOCK_SIZE;
+}
+
+bool FileBlockDevice::sync()
+{
+    return _file && fflush(_file) == 0;
+}
+
+#endif
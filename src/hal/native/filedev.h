@@ -0,0 +1,37 @@
+#ifndef HAL_NATIVE_FILEDEV_H
+#define HAL_NATIVE_FILEDEV_H
+
+#include "fs/blockdev.h"
+
+#include <stdio.h>
+
+/**
+ * @brief Блочное устройство поверх файла (сборка env:native)
+ *
+ * Заменяет SD-карту в тестах и на Linux: образ тома сохраняется между
+ * запусками. Считает обращения, чтобы тесты проверяли работу кэша.
+ */
+class FileBlockDevice : public BlockDevice
+{
+public:
+    ~FileBlockDevice();
+
+    bool open(const char* path, uint32_t blocks);
+    void close();
+
+    bool readBlock(uint32_t block, uint8_t* buffer) override;
+    bool writeBlock(uint32_t block, const uint8_t* data) override;
+    uint32_t blockCount() const override { return _blocks; }
+    bool sync() override;
+
+    uint32_t getReads() const { return _reads; }
+    uint32_t getWrites() const { return _writes; }
+
+private:
+    FILE* _file = nullptr;
+    uint32_t _blocks = 0;
+    uint32_t _reads = 0;
+    uint32_t _writes = 0;
+};
+
+#endif
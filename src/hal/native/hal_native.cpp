@@ -0,0 +1,271 @@
+#include "hal/native/sim.h"
+
+#ifndef __AVR__
+
+#include <stdio.h>
+
+namespace
+{
+    const uint8_t PIN_COUNT = 20;
+
+    uint64_t simMicros = 0;
+    uint32_t autoAdvance = 1;
+    bool irqOn = true;
+
+    uint8_t tickSource = 0;
+    uint16_t tickTicksPerMs = 1000;
+    void (*tickHandler)() = nullptr;
+
+    bool pinLevels[PIN_COUNT];
+    uint8_t pinModes[PIN_COUNT];
+
+    bool wdtOn = false;
+    uint32_t wdtTimeoutUs = 0;
+    uint64_t wdtDeadline = 0;
+    void (*wdtHandler)() = nullptr;
+
+    void (*rebootHook)() = nullptr;
+    uint8_t lastReset = hal::RESET_POWER_ON;
+
+    const uint16_t EEPROM_SIZE = 1024;
+    uint8_t eeprom[EEPROM_SIZE];
+    bool eepromErased = false;
+
+    void eraseEeprom()
+    {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        eepromErased = true;
+    }
+}
+
+namespace hal
+{
+    void irqDisable() { irqOn = false; }
+    void irqEnable() { irqOn = true; }
+    uint8_t irqSave()
+    {
+        uint8_t state = irqOn;
+        irqOn = false;
+#ifdef OS_IRQ_STATS
+        if (state) IrqStats::lockStart();
+#endif
+        return state;
+    }
+
+    void irqRestore(uint8_t state)
+    {
+#ifdef OS_IRQ_STATS
+        if (state) IrqStats::lockEnd();
+#endif
+        irqOn = state;
+    }
+
+    /**
+     * @brief Запуск модели тика
+     * @param source Номер таймера (влияет только на масштаб tickCounter)
+     * @param ticksPerMs Тактов счётчика на 1 мс
+     * @param onTick Обработчик тика, вызываемый из sim::advance()
+     */
+    void tickStart(uint8_t source, uint16_t ticksPerMs, void (*onTick)())
+    {
+        tickSource = source;
+        tickTicksPerMs = ticksPerMs;
+        tickHandler = onTick;
+    }
+
+    void tickStop(uint8_t source)
+    {
+        if (source == tickSource) tickHandler = nullptr;
+    }
+
+    uint16_t tickCounter(uint8_t source)
+    {
+        (void)source;
+        return (uint32_t)(simMicros % 1000) * tickTicksPerMs / 1000;
+    }
+
+    // Тик вызывается синхронно в advance(), необработанных тиков не бывает
+    bool tickPending(uint8_t source)
+    {
+        (void)source;
+        return false;
+    }
+
+    void tickPoll()
+    {
+        if (autoAdvance) sim::advance(autoAdvance);
+    }
+
+    void pinMode(uint8_t pin, uint8_t mode)
+    {
+        if (pin >= PIN_COUNT) return;
+        pinModes[pin] = mode;
+        if (mode == INPUT_PULLUP) pinLevels[pin] = true;
+    }
+
+    void pinWrite(uint8_t pin, bool level)
+    {
+        if (pin < PIN_COUNT) pinLevels[pin] = level;
+    }
+
+    bool pinRead(uint8_t pin)
+    {
+        return pin < PIN_COUNT && pinLevels[pin];
+    }
+
+    /**
+     * @brief Включение модели сторожевого таймера
+     * @param timeout Код таймаута WDTO_* (16 мс << код)
+     * @param onTimeout Обработчик истечения таймаута
+     */
+    void wdtEnable(uint8_t timeout, void (*onTimeout)())
+    {
+        wdtHandler = onTimeout;
+        wdtTimeoutUs = 16000UL << timeout;
+        wdtDeadline = simMicros + wdtTimeoutUs;
+        wdtOn = true;
+    }
+
+    void wdtDisable()
+    {
+        wdtOn = false;
+    }
+
+    bool wdtEnabled()
+    {
+        return wdtOn;
+    }
+
+    void wdtReset()
+    {
+        wdtDeadline = simMicros + wdtTimeoutUs;
+    }
+
+    uint32_t faultAddress()
+    {
+        return 0;
+    }
+
+    uint8_t resetFlags()
+    {
+        return lastReset;
+    }
+
+    // Как и на AVR, перезапуск выполняется сбросом по сторожевому таймеру
+    void reboot()
+    {
+        fflush(stdout);
+        lastReset = RESET_WATCHDOG;
+        if (rebootHook) rebootHook();
+        exit(0);
+    }
+
+    void eepromRead(uint16_t addr, void* data, uint16_t size)
+    {
+        if (!eepromErased) eraseEeprom();
+        for (uint16_t i = 0; i < size; i++)
+        {
+            ((uint8_t*)data)[i] = (addr + i < EEPROM_SIZE) ? eeprom[addr + i] : 0xFF;
+        }
+    }
+
+    void eepromWrite(uint16_t addr, const void* data, uint16_t size)
+    {
+        if (!eepromErased) eraseEeprom();
+        for (uint16_t i = 0; i < size && addr + i < EEPROM_SIZE; i++)
+        {
+            eeprom[addr + i] = ((const uint8_t*)data)[i];
+        }
+    }
+
+    namespace sim
+    {
+        /**
+         * @brief Продвижение модельного времени
+         * @param us Микросекунды
+         *
+         * Тики вызываются по одному на каждую пройденную миллисекунду,
+         * пока прерывания разрешены; при запрещённых прерываниях тик
+         * откладывается до irqEnable() и следующего advance().
+         */
+        void advance(uint32_t us)
+        {
+            static bool inTick = false;
+            uint64_t target = simMicros + us;
+            while (simMicros < target)
+            {
+                uint64_t boundary = (simMicros / 1000 + 1) * 1000;
+                if (boundary > target)
+                {
+                    simMicros = target;
+                    break;
+                }
+                simMicros = boundary;
+                if (tickHandler && irqOn && !inTick)
+                {
+                    inTick = true;
+                    tickHandler();
+                    inTick = false;
+                }
+            }
+
+            if (wdtOn && simMicros >= wdtDeadline)
+            {
+                wdtOn = false;
+                if (wdtHandler) wdtHandler();
+                reboot();
+            }
+        }
+
+        uint64_t now()
+        {
+            return simMicros;
+        }
+
+        void setAutoAdvance(uint32_t us)
+        {
+            autoAdvance = us;
+        }
+
+        void setPin(uint8_t pin, bool level)
+        {
+            if (pin < PIN_COUNT) pinLevels[pin] = level;
+        }
+
+        uint8_t getPinMode(uint8_t pin)
+        {
+            return pin < PIN_COUNT ? pinModes[pin] : INPUT;
+        }
+
+        bool irqEnabled()
+        {
+            return irqOn;
+        }
+
+        void setRebootHook(void (*hook)())
+        {
+            rebootHook = hook;
+        }
+
+        void setResetFlags(uint8_t flags)
+        {
+            lastReset = flags;
+        }
+
+        /**
+         * @brief Сброс модели в исходное состояние (между тестами)
+         */
+        void reset()
+        {
+            simMicros = 0;
+            autoAdvance = 1;
+            irqOn = true;
+            tickHandler = nullptr;
+            wdtOn = false;
+            memset(pinLevels, 0, sizeof(pinLevels));
+            memset(pinModes, 0, sizeof(pinModes));
+        }
+    }
+}
+
+#endif
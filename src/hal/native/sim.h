@@ -0,0 +1,35 @@
+#ifndef HAL_NATIVE_SIM_H
+#define HAL_NATIVE_SIM_H
+
+#include "hal/hal.h"
+
+/**
+ * @brief Управление моделью периферии в сборке env:native
+ *
+ * Время моделируется счётчиком микросекунд. Тик 1 мс вызывается при
+ * каждом пересечении границы миллисекунды, сторожевой таймер - по
+ * истечении таймаута без hal::wdtReset(). По умолчанию каждое чтение
+ * часов (hal::tickPoll) продвигает время на 1 мкс, поэтому циклы
+ * ожидания вида sysTimer.delay() завершаются и без явного advance().
+ */
+namespace hal
+{
+    namespace sim
+    {
+        void advance(uint32_t us);
+        uint64_t now();
+        void setAutoAdvance(uint32_t us);
+
+        void setPin(uint8_t pin, bool level);
+        uint8_t getPinMode(uint8_t pin);
+        bool irqEnabled();
+
+        // Вызывается из hal::reboot() вместо выхода из процесса
+        void setRebootHook(void (*hook)());
+        // Флаги RESET_*, возвращаемые hal::resetFlags()
+        void setResetFlags(uint8_t flags);
+        void reset();
+    }
+}
+
+#endif
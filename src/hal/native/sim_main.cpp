@@ -0,0 +1,124 @@
+#if !defined(__AVR__) && !defined(PIO_UNIT_TESTING)
+
+/*
+ * Точка входа env:native: ядро, ФС, логгер и системные вызовы на модели
+ * времени. Использование: program [секунды модельного времени, по умолчанию 30]
+ */
+
+#include "kernel/kernel.h"
+#include "fs/fs.h"
+#include "fs/logger.h"
+#include "syscalls/syscalls.h"
+#include "driver/timer.h"
+#include "driver/gpio.h"
+#include "system/trace.h"
+#include "system/crash.h"
+#include "system/shell.h"
+#include "system/boot.h"
+#include "hal/native/sim.h"
+
+namespace
+{
+    GPIO led(13);
+    int counter = 0;
+
+    const char configName[] PROGMEM = "config.txt";
+    const char configData[] PROGMEM = "interval=1000";
+    const FileSystem::RomFile romFiles[] PROGMEM =
+    {
+        {configName, reinterpret_cast<const uint8_t*>(configData), sizeof(configData) - 1, false},
+    };
+
+    void blinkTask()
+    {
+        led.toggle();
+    }
+
+    void counterTask()
+    {
+        counter = (counter + 1) % 1000;
+        if (!os::file_write("counter.txt", String(counter)))
+        {
+            LOG_MSG(MSG_COUNTER_WRITE);
+        }
+    }
+
+    void idleTask()
+    {
+        fs.scrubStep();
+    }
+
+    void loggerInit()
+    {
+        logger.begin();
+    }
+
+    void consoleInit()
+    {
+        CrashLog::report(Serial);
+        kernel.printBanner(Serial);
+    }
+
+    void statTask()
+    {
+        Serial.print(F("Stat: T="));
+        Serial.print(kernel.getTaskCount());
+        Serial.print(F(" F="));
+        Serial.print(fs.getFileCount());
+        Serial.print(F(" counter="));
+        Serial.println(os::file_read("counter.txt"));
+        os::top(Serial);
+#ifdef OS_TRACE
+        Trace::flush(Serial);
+        Serial.println();
+#endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seconds = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 30;
+
+    sysTimer.begin();
+    CrashLog::begin();
+    Serial.begin(9600);
+    led.setMode(GPIO::GPIO_OUTPUT);
+    Boot::mark(Boot::STAGE_DRIVERS);
+    fs.createFile("counter.txt", "0");
+    fs.mountRom(romFiles, sizeof(romFiles) / sizeof(romFiles[0]));
+    Boot::mark(Boot::STAGE_STORAGE);
+
+    kernel.addTask(counterTask, 100, 1);
+    kernel.addTask(blinkTask, 500, 2);
+    kernel.addTask(statTask, 5000, 3);
+#ifdef OS_SHELL
+    kernel.addTask(Shell::poll, 2, 5);
+#endif
+    kernel.setIdleHook(idleTask);
+    Boot::defer(loggerInit, Boot::STAGE_LOGGER);
+    Boot::defer(consoleInit, Boot::STAGE_CONSOLE);
+    Boot::start();
+
+    SystemGuard::enable(WDTO_8S);
+    kernel.begin();
+
+    // Каждый проход цикла занимает 10 мкс модельного времени
+    hal::sim::setAutoAdvance(0);
+    uint64_t end = (uint64_t)seconds * 1000000ULL;
+    while (hal::sim::now() < end)
+    {
+        SystemGuard::reset();
+        kernel.run();
+        hal::sim::advance(10);
+    }
+
+    Serial.print(F("Simulated "));
+    Serial.print(sysTimer.millis());
+    Serial.println(F(" ms"));
+    Serial.print(os::sys_info());
+    Serial.println();
+    Boot::report(Serial);
+    return 0;
+}
+
+#endif
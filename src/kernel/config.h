@@ -0,0 +1,110 @@
+#ifndef OS_CONFIG_H
+#define OS_CONFIG_H
+
+#include <stdint.h>
+
+/*
+ * Размеры ядра и файловой системы, задаваемые при компиляции.
+ *
+ * Значения по умолчанию выбираются по микроконтроллеру: ATmega328P
+ * (Uno, 2 КБ SRAM) или ATmega1280/2560 (Mega, 8 КБ SRAM). Каждое
+ * можно переопределить флагом сборки, например -DOS_MAX_TASKS=12.
+ * Ширина счётчиков и индексов (uint8_t или uint16_t) выводится из
+ * ёмкости, поэтому на Uno увеличенные пределы ничего не стоят.
+ */
+
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+#define OS_TARGET_MEGA
+#endif
+
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__)
+// Драйверы с картой выводов Uno (input, softpwm, быстрый hal::pinWrite)
+#define OS_UNO_PINOUT
+#endif
+
+#ifdef OS_TARGET_MEGA
+#define OS_DEFAULT_TASKS 24
+#define OS_DEFAULT_SEMAPHORES 12
+#define OS_DEFAULT_FILES 16
+#define OS_DEFAULT_FILE_SIZE 1024
+#else
+#define OS_DEFAULT_TASKS 8
+#define OS_DEFAULT_SEMAPHORES 5
+#define OS_DEFAULT_FILES 5
+#define OS_DEFAULT_FILE_SIZE 512
+#endif
+
+// Блоков в кэше внешнего накопителя (fs/blockdev.h): на Uno один блок
+// занимает четверть SRAM
+#if defined(OS_TARGET_MEGA) || !defined(__AVR__)
+#define OS_DEFAULT_BLOCK_CACHE 4
+#else
+#define OS_DEFAULT_BLOCK_CACHE 1
+#endif
+
+#ifndef OS_MAX_TASKS
+#define OS_MAX_TASKS OS_DEFAULT_TASKS
+#endif
+#ifndef OS_MAX_SEMAPHORES
+#define OS_MAX_SEMAPHORES OS_DEFAULT_SEMAPHORES
+#endif
+#ifndef OS_MAX_FILES
+#define OS_MAX_FILES OS_DEFAULT_FILES
+#endif
+#ifndef OS_MAX_FILE_SIZE
+#define OS_MAX_FILE_SIZE OS_DEFAULT_FILE_SIZE
+#endif
+#ifndef OS_MAX_FILENAME_LEN
+#define OS_MAX_FILENAME_LEN 16
+#endif
+#ifndef OS_BLOCK_CACHE
+#define OS_BLOCK_CACHE OS_DEFAULT_BLOCK_CACHE
+#endif
+
+/**
+ * @brief Наименьший беззнаковый тип для значений 0..N
+ */
+template <bool Byte>
+struct IndexSelect
+{
+    typedef uint8_t Type;
+};
+
+template <>
+struct IndexSelect<false>
+{
+    typedef uint16_t Type;
+};
+
+template <unsigned long N>
+struct IndexFor
+{
+    static_assert(N <= 0xFFFF, "capacity exceeds 16-bit index");
+    typedef typename IndexSelect<(N <= 0xFF)>::Type Type;
+};
+
+/**
+ * @brief Конфигурация ядра и ФС для текущей цели
+ */
+struct OsConfig
+{
+    static constexpr uint16_t MAX_TASKS = OS_MAX_TASKS;
+    static constexpr uint16_t MAX_SEMAPHORES = OS_MAX_SEMAPHORES;
+    static constexpr uint16_t MAX_FILES = OS_MAX_FILES;
+    static constexpr uint16_t MAX_FILE_SIZE = OS_MAX_FILE_SIZE;
+    static constexpr uint8_t MAX_FILENAME_LEN = OS_MAX_FILENAME_LEN;
+    // Сектор SD-карты
+    static constexpr uint16_t BLOCK_SIZE = 512;
+    static constexpr uint8_t BLOCK_CACHE = OS_BLOCK_CACHE;
+
+    // Номер задачи - int8_t в записи аварии и трассе
+    static_assert(MAX_TASKS >= 1 && MAX_TASKS <= 127, "OS_MAX_TASKS must be 1..127");
+    static_assert(MAX_FILE_SIZE < 0xFFFF, "OS_MAX_FILE_SIZE must fit uint16_t with terminator");
+    static_assert(BLOCK_CACHE >= 1, "OS_BLOCK_CACHE must be at least 1");
+
+    typedef IndexFor<MAX_TASKS>::Type TaskIndex;
+    typedef IndexFor<MAX_SEMAPHORES>::Type SemIndex;
+    typedef IndexFor<MAX_FILES>::Type FileIndex;
+};
+
+#endif
@@ -1,41 +1,43 @@
 #include "scheduler.h"
 #include "driver/timer.h"
 #include "fs/logger.h"
+#include "system/irqstats.h"
+#include "system/trace.h"
+#include "system/boot.h"
 
 extern Logger logger;
 Scheduler kernel;
 
 /**
- * @brief Аварийный дамп системы
- * @param reason Причина аварии
+ * @brief Аварийный перезапуск системы
+ * @param cause Причина аварии
+ *
+ * Состояние сохраняется в запись CrashLog (без вывода в Serial) и
+ * выводится при следующей загрузке.
  */
-void Scheduler::emergencyDump(const char* reason) 
+void Scheduler::emergencyDump(CrashLog::Cause cause) 
 {
     SystemGuard::disable();
-    noInterrupts();
+    hal::irqDisable();
+    TRACE_DUMP();
+    CrashLog::capture(cause);
     
-    Serial.println("\n=== SYSTEM DUMP ===");
-    Serial.print("Reason: "); Serial.println(reason);
-    Serial.print("Uptime: "); Serial.print(sysTimer.millis()); Serial.println(" ms");
-    Serial.print("Tasks: "); Serial.println(taskCount);
-    
-    for(int i = 0; i < taskCount; i++) 
-    {
-        Serial.print("Task "); Serial.print(i);
-        Serial.print(": runs="); Serial.println(tasks[i].runCount);
-    }
-    
-    Serial.println("Rebooting...");
-    delay(100);
-    asm volatile ("jmp 0"); 
+#ifdef OS_TRACE
+    Trace::flush(Serial);
+    Serial.println();
+    Serial.flush();
+#endif
+    hal::reboot();
 }
 
-ISR(WDT_vect) 
+/**
+ * @brief Таймаут сторожевого таймера (из прерывания WDT)
+ */
+void SystemGuard::onTimeout() 
 {
-    kernel.emergencyDump("Watchdog timeout");
-    wdt_enable(WDTO_15MS); 
-    while(1);
+    kernel.emergencyDump(CrashLog::CAUSE_WDT_TIMEOUT);
 }
+
 /**
  * @brief Поиск задачи по функции
  * @param function Указатель на функцию задачи
@@ -64,28 +66,143 @@ bool Scheduler::addTask(TaskFunction function, unsigned long period, uint8_t pri
 {
     if(taskCount >= MAX_TASKS || period == 0 || priority > 255) 
     {
-        logger.log("ERR: Can't add task");
+        LOG_MSG(MSG_TASK_ADD);
         return false;
     }
     
     if(findTask(function) != -1) 
     {
-        logger.log("ERR: Task exists");
+        LOG_MSG(MSG_TASK_EXISTS);
         return false;
     }
     
-    tasks[taskCount] = {function, period, 0, true, priority, 0, 0, 0};
+    tasks[taskCount] = {function, period, sysTimer.millis(), true, priority, 0, 0, 0, 0, 0, 0,
+                        OVERRUN_LOG, 0, 0, 0, 0, 0, 0};
     taskCount++;
     sortTasks(); 
     return true;
 }
 
+/**
+ * @brief Удаление задачи
+ * @param function Функция задачи
+ * @return true если задача удалена
+ */
+bool Scheduler::removeTask(TaskFunction function)
+{
+    int index = findTask(function);
+    if(index == -1) return false;
+
+    for(OsConfig::TaskIndex i = index; i < taskCount - 1; i++)
+    {
+        tasks[i] = tasks[i+1];
+    }
+    taskCount--;
+    return true;
+}
+
+/**
+ * @brief Включение/отключение задачи
+ * @param function Функция задачи
+ * @param state true - включить
+ * @return true если задача найдена
+ */
+bool Scheduler::enableTask(TaskFunction function, bool state)
+{
+    int index = findTask(function);
+    if(index == -1) return false;
+
+    // Отсчёт заново, чтобы простой не считался пропущенными запусками
+    if(state && !tasks[index].enabled)
+    {
+        tasks[index].lastRun = sysTimer.millis();
+    }
+    tasks[index].enabled = state;
+    return true;
+}
+
+/**
+ * @brief Изменение периода задачи
+ * @param function Функция задачи
+ * @param new_period Новый период (мс)
+ * @return true если период изменён
+ */
+bool Scheduler::setPeriod(TaskFunction function, unsigned long new_period)
+{
+    int index = findTask(function);
+    if(index == -1 || new_period == 0) return false;
+
+    tasks[index].period = new_period;
+    tasks[index].degrade = 0;
+    return true;
+}
+
+/**
+ * @brief Изменение приоритета задачи
+ * @param function Функция задачи
+ * @param new_priority Новый приоритет (0 - высший)
+ * @return true если приоритет изменён
+ */
+bool Scheduler::setPriority(TaskFunction function, uint8_t new_priority)
+{
+    int index = findTask(function);
+    if(index == -1) return false;
+
+    tasks[index].priority = new_priority;
+    sortTasks();
+    return true;
+}
+
+/**
+ * @brief Получение приоритета задачи
+ * @param function Функция задачи
+ * @return Приоритет или 255 если задача не найдена
+ */
+uint8_t Scheduler::getPriority(TaskFunction function) const
+{
+    int index = findTask(function);
+    return (index == -1) ? 255 : tasks[index].priority;
+}
+
+/**
+ * @brief Установка реакции на превышение периода
+ * @param function Функция задачи
+ * @param policy Политика OVERRUN_*
+ * @return true если задача найдена
+ */
+bool Scheduler::setOverrunPolicy(TaskFunction function, OverrunPolicy policy)
+{
+    int index = findTask(function);
+    if(index == -1) return false;
+
+    tasks[index].policy = policy;
+    return true;
+}
+
+/**
+ * @brief Сброс временной статистики задачи
+ * @param function Функция задачи
+ * @return true если задача найдена
+ */
+bool Scheduler::resetStats(TaskFunction function)
+{
+    int index = findTask(function);
+    if(index == -1) return false;
+
+    Task& t = tasks[index];
+    t.maxRunTime = 0;
+    t.overruns = 0;
+    t.misses = 0;
+    t.maxJitter = 0;
+    return true;
+}
+
 /**
  * @brief Сортировка задач по приоритету
  */
 void Scheduler::sortTasks() 
 {
-    for(uint8_t i=1; i<taskCount; i++) 
+    for(OsConfig::TaskIndex i=1; i<taskCount; i++) 
     {
         Task key = tasks[i];
         int8_t j = i-1;
@@ -98,58 +215,246 @@ void Scheduler::sortTasks()
     }
 }
 
+/**
+ * @brief Установка обработчика простоя
+ * @param hook Функция, вызываемая после прохода без готовых задач
+ *             (nullptr - отключить)
+ *
+ * Обработчик должен выполняться за малую долю миллисекунды: его время
+ * учитывается как простой и задерживает следующий проход.
+ */
+void Scheduler::setIdleHook(TaskFunction hook) 
+{
+    idleHook = hook;
+}
+
 /**
  * @brief Основной цикл планировщика
+ *
+ * Проход без выполненных задач считается простоем до начала
+ * следующего прохода.
  */
 void Scheduler::run() 
 {
     uint32_t now = sysTimer.millis();
+    uint32_t passStart = sysTimer.micros();
+    bool worked = false;
+
+    if(lastPassIdle) 
+    {
+        idleTime += passStart - lastPass;
+    }
+    lastPass = passStart;
+
+    if(signalsPending) 
+    {
+        applyPendingSignals();
+    }
 
     for(int i = 0; i < taskCount; i++) 
     {
-        if(tasks[i].enabled && (now - tasks[i].lastRun >= tasks[i].period)) 
+        Task& t = tasks[i];
+        unsigned long period = t.period << t.degrade;
+        if(!t.enabled || now - t.lastRun < period) continue;
+
+        // Запуск привязан к плановому времени, а не к now: без дрейфа
+        unsigned long release = t.lastRun + period;
+        unsigned long lateness = now - release;
+        if(lateness >= period) 
         {
-            uint32_t startTime = now;
-            tasks[i].lastRun = now;
-            tasks[i].runCount++;
-            
-            tasks[i].function();
-            
-            uint32_t runTime = sysTimer.millis() - startTime;
-            tasks[i].lastRunTime = runTime;
-            if(runTime > tasks[i].maxRunTime) 
-            {
-                tasks[i].maxRunTime = runTime;
-            }
+            unsigned long missed = lateness / period;
+            uint32_t misses = t.misses + missed;
+            t.misses = (misses > 0xFFFF) ? 0xFFFF : misses;
+            release += missed * period;
+        }
+        t.lastRun = release;
+        t.runCount++;
+        
+        uint32_t startTime = sysTimer.micros();
+        t.lastJitter = startTime - release * 1000UL;
+        if(t.lastJitter > t.maxJitter) 
+        {
+            t.maxJitter = t.lastJitter;
+        }
+        if(!released) 
+        {
+            released = true;
+            Boot::mark(Boot::STAGE_FIRST_TASK);
+        }
+        currentTask = i;
+        TRACE_TASK_START(i);
+        t.function();
+        TRACE_TASK_STOP(i);
+        currentTask = -1;
+        
+        uint32_t runTime = sysTimer.micros() - startTime;
+        t.lastRunTime = runTime;
+        t.busyTime += runTime;
+        if(runTime > t.maxRunTime) 
+        {
+            t.maxRunTime = runTime;
+        }
+        worked = true;
+
+        if(runTime > period * 1000UL) 
+        {
+            handleOverrun(i);
+        }
+        else if(t.degrade && ++t.cleanRuns >= DEGRADE_RECOVER_RUNS) 
+        {
+            t.degrade--;
+            t.cleanRuns = 0;
         }
     }
+    lastPassIdle = !worked;
+    if(!worked && idleHook) 
+    {
+        idleHook();
+    }
     
-    checkTaskTimings(); 
+    updateLoad(passStart);
 }
 
 /**
- * @brief Проверка временных характеристик задач
+ * @brief Пересчёт загрузки по окончании окна OS_LOAD_WINDOW_MS
+ * @param now Начало текущего прохода, мкс
+ *
+ * Загрузка в промилле: занятые мкс / длительность окна в мс. Одно
+ * деление на задачу раз в окно.
  */
-void Scheduler::checkTaskTimings() 
+void Scheduler::updateLoad(uint32_t now)
 {
+    uint32_t window = now - windowStart;
+    if(window < OS_LOAD_WINDOW_MS * 1000UL) return;
+
+    uint32_t windowMs = window / 1000;
     for(int i = 0; i < taskCount; i++) 
     {
-        if(tasks[i].maxRunTime > tasks[i].period) 
-        {
-           emergencyDump("Task overrun");
-        }
+        uint32_t load = tasks[i].busyTime / windowMs;
+        tasks[i].load = (load > 1000) ? 1000 : load;
+        tasks[i].totalBusy += tasks[i].busyTime / 1000;
+        tasks[i].busyTime %= 1000;
+    }
+
+    uint32_t idle = idleTime / windowMs;
+    systemLoad = (idle >= 1000) ? 0 : 1000 - idle;
+    totalIdle += idleTime / 1000;
+    idleTime %= 1000;
+    windowStart = now;
+}
+
+/**
+ * @brief Реакция на выполнение задачи дольше её периода
+ * @param index Индекс задачи
+ *
+ * Пропущенные из-за других задач запуски только считаются (misses),
+ * политика применяется к задаче, превысившей свой период.
+ */
+void Scheduler::handleOverrun(int index) 
+{
+    Task& t = tasks[index];
+    TRACE_OVERRUN(index);
+    if(t.overruns < 0xFFFF) t.overruns++;
+    t.cleanRuns = 0;
+
+    switch(t.policy) 
+    {
+        case OVERRUN_REBOOT:
+            emergencyDump(CrashLog::CAUSE_OVERRUN);
+
+        case OVERRUN_SKIP:
+            t.lastRun += t.period << t.degrade;
+            break;
+
+        case OVERRUN_DEGRADE:
+            if(t.degrade < MAX_DEGRADE) t.degrade++;
+            break;
+
+        case OVERRUN_DISABLE:
+            t.enabled = false;
+            break;
+
+        case OVERRUN_LOG:
+            break;
     }
+    LOG_MSG(MSG_TASK_OVERRUN, index);
 }
 
 /**
  * @brief Получение количества задач
  * @return Количество активных задач
  */
-uint8_t Scheduler::getTaskCount() const 
+OsConfig::TaskIndex Scheduler::getTaskCount() const 
 {
     return taskCount;
 }
 
+/**
+ * @brief Получение задачи по индексу (только чтение)
+ * @param index Индекс задачи
+ * @return Указатель на задачу или nullptr при ошибке
+ */
+const Task* Scheduler::getTask(OsConfig::TaskIndex index) const
+{
+    return (index < taskCount) ? &tasks[index] : nullptr;
+}
+
+/**
+ * @brief Снимок состояния задачи без выделения памяти
+ * @param index Индекс задачи
+ * @param info Заполняемая структура
+ * @return false если индекс вне диапазона
+ */
+bool Scheduler::getTaskInfo(OsConfig::TaskIndex index, TaskInfo& info) const
+{
+    if(index >= taskCount) return false;
+
+    const Task& t = tasks[index];
+    info.function = t.function;
+    info.period = t.period;
+    info.priority = t.priority;
+    info.enabled = t.enabled;
+    info.runCount = t.runCount;
+    info.lastRunTime = t.lastRunTime;
+    info.maxRunTime = t.maxRunTime;
+    info.totalBusy = t.totalBusy;
+    info.load = t.load;
+    info.policy = t.policy;
+    info.activePeriod = t.period << t.degrade;
+    info.overruns = t.overruns;
+    info.misses = t.misses;
+    info.lastJitter = t.lastJitter;
+    info.maxJitter = t.maxJitter;
+    return true;
+}
+
+/**
+ * @brief Загрузка процессора за последнее окно
+ * @return Промилле (0..1000)
+ */
+uint16_t Scheduler::getSystemLoad() const
+{
+    return systemLoad;
+}
+
+/**
+ * @brief Суммарное время простоя
+ * @return Миллисекунды с начала работы
+ */
+uint32_t Scheduler::getIdleTime() const
+{
+    return totalIdle;
+}
+
+/**
+ * @brief Индекс выполняющейся задачи
+ * @return Индекс или -1 вне задачи
+ */
+int8_t Scheduler::getCurrentTask() const
+{
+    return currentTask;
+}
+
 /**
  * @brief Создание семафора
  * @param initial_count Начальное значение счетчика
@@ -161,6 +466,7 @@ int Scheduler::sem_create(int initial_count)
     
     semaphores[semCount].count = initial_count;
     semaphores[semCount].waitCount = 0;
+    semaphores[semCount].pending = 0;
     return semCount++;
 }
 
@@ -176,20 +482,19 @@ bool Scheduler::sem_wait(int sem_id)
     if (semaphores[sem_id].count > 0) 
     {
         semaphores[sem_id].count--;
+        TRACE_SEM_WAIT(sem_id, false);
         return true;
     } 
     else 
     {
+        TRACE_SEM_WAIT(sem_id, true);
         if (semaphores[sem_id].waitCount >= MAX_TASKS) return false;
         
-        for (int i = 0; i < taskCount; i++) 
+        // Блокируется вызвавшая задача; вне задачи ждать некому
+        if (currentTask >= 0) 
         {
-            if (tasks[i].enabled) 
-            {
-                semaphores[sem_id].waiting[semaphores[sem_id].waitCount++] = tasks[i].function;
-                tasks[i].enabled = false;
-                return false;
-            }
+            semaphores[sem_id].waiting[semaphores[sem_id].waitCount++] = tasks[currentTask].function;
+            tasks[currentTask].enabled = false;
         }
         return false;
     }
@@ -203,12 +508,13 @@ bool Scheduler::sem_wait(int sem_id)
 bool Scheduler::sem_signal(int sem_id) 
 {
     if (sem_id < 0 || sem_id >= semCount) return false;
+    TRACE_SEM_SIGNAL(sem_id);
     
     if (semaphores[sem_id].waitCount > 0) 
     {
         TaskFunction taskToWake = semaphores[sem_id].waiting[0];
         
-        for (uint8_t i = 0; i < semaphores[sem_id].waitCount - 1; i++) 
+        for (OsConfig::TaskIndex i = 0; i < semaphores[sem_id].waitCount - 1; i++) 
         {
             semaphores[sem_id].waiting[i] = semaphores[sem_id].waiting[i+1];
         }
@@ -230,6 +536,47 @@ bool Scheduler::sem_signal(int sem_id)
     return true;
 }
 
+/**
+ * @brief Освобождение семафора из обработчика прерывания
+ *
+ * Очередь ожидания и таблица задач в ISR не меняются: сигнал
+ * запоминается и применяется в начале следующего прохода run().
+ * @param sem_id Идентификатор семафора
+ * @return false при неверном идентификаторе или переполнении счётчика
+ */
+bool Scheduler::sem_signal_isr(int sem_id) 
+{
+    if (sem_id < 0 || sem_id >= semCount) return false;
+    uint8_t state = hal::irqSave();
+    bool stored = semaphores[sem_id].pending < 0xFF;
+    if (stored) 
+    {
+        semaphores[sem_id].pending = semaphores[sem_id].pending + 1;
+        signalsPending = true;
+    }
+    hal::irqRestore(state);
+    return stored;
+}
+
+/**
+ * @brief Применение сигналов, отложенных sem_signal_isr()
+ */
+void Scheduler::applyPendingSignals() 
+{
+    signalsPending = false;
+    for (OsConfig::SemIndex i = 0; i < semCount; i++) 
+    {
+        uint8_t state = hal::irqSave();
+        uint8_t count = semaphores[i].pending;
+        semaphores[i].pending = 0;
+        hal::irqRestore(state);
+        while (count--) 
+        {
+            sem_signal(i);
+        }
+    }
+}
+
 /**
  * @brief Удаление семафора
  * @param sem_id Идентификатор семафора
@@ -239,7 +586,7 @@ bool Scheduler::sem_delete(int sem_id)
 {
     if (sem_id < 0 || sem_id >= semCount) return false;
     
-    for (uint8_t i = sem_id; i < semCount - 1; i++) 
+    for (OsConfig::SemIndex i = sem_id; i < semCount - 1; i++) 
     {
         semaphores[i] = semaphores[i+1];
     }
@@ -247,16 +594,38 @@ bool Scheduler::sem_delete(int sem_id)
     return true;
 }
 
+/**
+ * @brief Запуск планировщика
+ *
+ * Задачи, добавленные до begin(), выполняются на первом проходе run(),
+ * а не через период после добавления. Заставка выводится отдельно
+ * (printBanner), обычно отложенным шагом загрузки.
+ */
 void Scheduler::begin() 
 {
-    noInterrupts();
-        Serial.println(F("=== OS Started ==="));
-        Serial.print(F("OS v1.0 | Time: "));
-        Serial.print(sysTimer.millis());
-        Serial.println(F(" ms"));
-        Serial.print(F("Tasks: "));
-        Serial.println(taskCount);
-        Serial.print(F("Watchdog: "));
-        Serial.println(SystemGuard::isEnabled() ? F("ON") : F("OFF")); 
-    interrupts();
-}
\ No newline at end of file
+    // Таблица задач пересчитывается одним окном запрета прерываний
+    // (его длительность учитывает IrqStats)
+    IRQ_LOCK();
+        uint32_t now = sysTimer.millis();
+        for(OsConfig::TaskIndex i = 0; i < taskCount; i++) 
+        {
+            tasks[i].lastRun = now - tasks[i].period;
+        }
+    IRQ_UNLOCK();
+    Boot::mark(Boot::STAGE_SCHEDULER);
+}
+
+/**
+ * @brief Заставка: версия, время, число задач, сторожевой таймер
+ */
+void Scheduler::printBanner(Print& out) const 
+{
+    out.println(F("=== OS Started ==="));
+    out.print(F("OS v1.0 | Time: "));
+    out.print(sysTimer.millis());
+    out.println(F(" ms"));
+    out.print(F("Tasks: "));
+    out.println(taskCount);
+    out.print(F("Watchdog: "));
+    out.println(SystemGuard::isEnabled() ? F("ON") : F("OFF")); 
+}
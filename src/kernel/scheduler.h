@@ -1,21 +1,46 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
-#include <Arduino.h>
-#include <avr/wdt.h>
+#include "hal/hal.h"
+#include "kernel/config.h"
+#include "system/crash.h"
 
-#define MAX_TASKS 8        
-#define MAX_SEMAPHORES 5   
+// Ёмкость задаётся в kernel/config.h (OS_MAX_TASKS, OS_MAX_SEMAPHORES)
+#define MAX_TASKS OsConfig::MAX_TASKS
+#define MAX_SEMAPHORES OsConfig::MAX_SEMAPHORES
 #define WDT_TIMEOUT WDTO_4S 
 
+// Окно усреднения загрузки процессора
+#ifndef OS_LOAD_WINDOW_MS
+#define OS_LOAD_WINDOW_MS 1000
+#endif
+
+// Максимальное замедление задачи политикой OVERRUN_DEGRADE (период << n)
+#define MAX_DEGRADE 3
+// Число своевременных запусков до отмены одной ступени замедления
+#define DEGRADE_RECOVER_RUNS 16
+
 typedef void (*TaskFunction)();
 
+/**
+ * @brief Реакция на превышение задачей своего периода
+ */
+enum OverrunPolicy : uint8_t
+{
+    OVERRUN_LOG,        // Запись в лог, работа продолжается
+    OVERRUN_SKIP,       // Пропуск следующего запуска
+    OVERRUN_DEGRADE,    // Удвоение периода (до MAX_DEGRADE раз)
+    OVERRUN_DISABLE,    // Отключение задачи
+    OVERRUN_REBOOT      // Аварийный перезапуск
+};
+
 
 struct Semaphore 
 {
     int count;                    
     TaskFunction waiting[MAX_TASKS];
-    uint8_t waitCount;              
+    OsConfig::TaskIndex waitCount;
+    volatile uint8_t pending;     // Сигналы из ISR, ещё не применённые
 };
 
 
@@ -23,12 +48,45 @@ struct Task
 {
     TaskFunction function;   
     unsigned long period;      
-    unsigned long lastRun;     
+    unsigned long lastRun;     // Плановое время последнего запуска, мс
     bool enabled;             
     uint8_t priority;          
     uint32_t runCount;         
-    uint32_t maxRunTime;        
-    uint32_t lastRunTime;     
+    uint32_t maxRunTime;       // мкс
+    uint32_t lastRunTime;      // мкс
+    uint32_t busyTime;         // мкс в текущем окне
+    uint32_t totalBusy;        // мс с начала работы
+    uint16_t load;             // ‰ за последнее окно
+    OverrunPolicy policy;
+    uint8_t degrade;           // Текущее замедление: период << degrade
+    uint8_t cleanRuns;         // Своевременных запусков подряд
+    uint16_t overruns;         // Выполнений дольше периода
+    uint16_t misses;           // Пропущенных плановых запусков
+    uint32_t lastJitter;       // Задержка запуска от планового времени, мкс
+    uint32_t maxJitter;        // мкс
+};
+
+
+/**
+ * @brief Снимок состояния задачи для os::task_info()
+ */
+struct TaskInfo
+{
+    TaskFunction function;
+    unsigned long period;
+    uint8_t priority;
+    bool enabled;
+    uint32_t runCount;
+    uint32_t lastRunTime;      // мкс
+    uint32_t maxRunTime;       // мкс
+    uint32_t totalBusy;        // мс
+    uint16_t load;             // ‰
+    OverrunPolicy policy;
+    unsigned long activePeriod; // Период с учётом замедления, мс
+    uint16_t overruns;
+    uint16_t misses;
+    uint32_t lastJitter;       // мкс
+    uint32_t maxJitter;        // мкс
 };
 
 
@@ -37,27 +95,25 @@ class SystemGuard
 public:
     static bool isEnabled() 
     {
-        return (WDTCSR & _BV(WDIE)) != 0;
+        return hal::wdtEnabled();
     }
     static void enable(uint8_t timeout = WDT_TIMEOUT) 
     {
-        cli(); 
-        wdt_reset(); 
-        MCUSR &= ~(1 << WDRF); 
-        WDTCSR |= (1 << WDCE) | (1 << WDE); 
-        WDTCSR = (1 << WDIE) | timeout; 
-        sei(); 
+        hal::wdtEnable(timeout, onTimeout);
     }
     
     static void reset() 
     {
-        wdt_reset();
+        hal::wdtReset();
     }
     
     static void disable() 
     {
-        wdt_disable();
+        hal::wdtDisable();
     }
+
+private:
+    static void onTimeout();
 };
 
 
@@ -65,15 +121,30 @@ class Scheduler
 {
 private:
     Task tasks[MAX_TASKS];        
-    uint8_t taskCount = 0;          
+    OsConfig::TaskIndex taskCount = 0;
     Semaphore semaphores[MAX_SEMAPHORES];
-    uint8_t semCount = 0;          
+    OsConfig::SemIndex semCount = 0;
+    int8_t currentTask = -1;
+    
+    uint32_t windowStart = 0;       // мкс
+    uint32_t lastPass = 0;          // мкс
+    bool lastPassIdle = false;
+    uint32_t idleTime = 0;          // мкс в текущем окне
+    uint32_t totalIdle = 0;         // мс
+    uint16_t systemLoad = 0;        // ‰
+    TaskFunction idleHook = nullptr;
+    volatile bool signalsPending = false;
+    bool released = false;          // Был запуск хотя бы одной задачи
     
     int findTask(TaskFunction function) const;
     
     void sortTasks();
     
-    void checkTaskTimings();
+    void handleOverrun(int index);
+    
+    void updateLoad(uint32_t now);
+    
+    void applyPendingSignals();
 
 public:
     bool addTask(TaskFunction function, unsigned long period, uint8_t priority = 0);
@@ -88,27 +159,45 @@ public:
     
     uint8_t getPriority(TaskFunction function) const;
     
+    bool setOverrunPolicy(TaskFunction function, OverrunPolicy policy);
+    
+    bool resetStats(TaskFunction function);
+    
+    void setIdleHook(TaskFunction hook);
+    
     /**
      * @brief Получение указателя на функцию задачи
      * @param index Индекс задачи
      * @return Указатель на функцию или nullptr при ошибке
      */
-    TaskFunction getTaskFunction(uint8_t index) const 
+    TaskFunction getTaskFunction(OsConfig::TaskIndex index) const 
     {
         if (index >= taskCount) return nullptr;
         return tasks[index].function;
     }
     void run();
     
-    uint8_t getTaskCount() const;
+    OsConfig::TaskIndex getTaskCount() const;
+    
+    const Task* getTask(OsConfig::TaskIndex index) const;
+    
+    int8_t getCurrentTask() const;
+    
+    bool getTaskInfo(OsConfig::TaskIndex index, TaskInfo& info) const;
+    
+    uint16_t getSystemLoad() const;
+    
+    uint32_t getIdleTime() const;
     
-    void emergencyDump(const char* reason);
+    [[noreturn]] void emergencyDump(CrashLog::Cause cause);
     
     int sem_create(int initial_count);
     bool sem_wait(int sem_id);
     bool sem_signal(int sem_id);
+    bool sem_signal_isr(int sem_id);
     bool sem_delete(int sem_id);
     void begin();
+    void printBanner(Print& out) const;
 };
 
 extern Scheduler kernel; 
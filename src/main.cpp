@@ -4,14 +4,25 @@
 #include "syscalls/syscalls.h"
 #include "driver/timer.h"
 #include "driver/gpio.h"
+#include "driver/adc.h"
 #include "system/monitor.h"
+#include "system/irqstats.h"
+#include "system/trace.h"
+#include "system/crash.h"
+#include "system/heap.h"
+#include "system/telemetry.h"
+#include "system/shell.h"
+#include "system/shared.h"
+#include "system/boot.h"
+#ifdef OS_SD_CS
+#include "driver/sdcard.h"
+#endif
 #include <LiquidCrystal.h>
 
 int sem_test;
-int counter = 0;
+// Пишется counterTask, читается задачами вывода и может читаться из ISR
+Shared::Atomic<int> counter(0);
 
-Logger logger;
-Timer sysTimer;
 GPIO led(13);
 GPIO lcdRS(4);
 GPIO lcdE(5);
@@ -26,54 +37,94 @@ LiquidCrystal lcd(
     lcdD6.getPin(), lcdD7.getPin()
 );
 
+// Неизменяемые файлы читаются прямо из flash, без копии в SRAM
+const char configName[] PROGMEM = "config.txt";
+const char configData[] PROGMEM = "interval=1000";
+const FileSystem::RomFile romFiles[] PROGMEM = 
+{
+    {configName, reinterpret_cast<const uint8_t*>(configData), sizeof(configData) - 1, false},
+};
+
+#ifdef OS_SD_CS
+// Том на SD-карте: лог пишется в /log.txt без ограничения размера
+SdCard sdCard(OS_SD_CS);
+BlockCache sdCache(sdCard);
+#endif
+
 void blinkTask();
 void counterTask();
 void fsTask();
+void idleTask();
 void systemMonitorTask();
 void ledStatusTask(); 
 void lcdTask(); 
 void debugTime();
 void testCrash();
+void loggerInit();
+void lcdInit();
+void consoleInit();
+#ifdef OS_TRACE
+void traceTask();
+#endif
+#ifdef OS_TELEMETRY
+void telemetryTask();
+#endif
 
+/**
+ * @brief Загрузка: в setup() только то, что нужно задачам
+ *
+ * Дисплей, том и файл лога, отчёт об аварии и заставка инициализируются
+ * задачей Boot::task после первых запусков задач (system/boot.h).
+ */
 void setup() 
 {
-    Serial.begin(9600);
-    while (!Serial) {}
-    delay(100);
-    Serial.flush();
-    
     sysTimer.begin();
-    logger.begin();
-
+    CrashLog::begin();
+#ifdef OS_TELEMETRY
+    Telemetry::begin();
+#else
+    Serial.begin(9600);
+#endif
+    SystemMonitor::begin();
+    sysAdc.begin(Adc::ADC_TIMER0);
     led.setMode(GPIO::GPIO_OUTPUT);
-    lcdRS.setMode(GPIO::GPIO_OUTPUT);
-    lcdE.setMode(GPIO::GPIO_OUTPUT);
-    lcdD4.setMode(GPIO::GPIO_OUTPUT);
-    lcdD5.setMode(GPIO::GPIO_OUTPUT);
-    lcdD6.setMode(GPIO::GPIO_OUTPUT);
-    lcdD7.setMode(GPIO::GPIO_OUTPUT);
-
-    lcd.begin(16, 2);
+    Boot::mark(Boot::STAGE_DRIVERS);
 
     if (!fs.createFile("counter.txt", "0")) 
     {
-        logger.log("ERR: Failed to create counter.txt");
+        LOG_MSG(MSG_FILE_CREATE, "counter.txt");
     }
 
-    if (!fs.createFile("config.txt", "interval=1000")) 
-    {
-        logger.log("ERR: Failed to create config.txt");
-    }
+    fs.mountRom(romFiles, sizeof(romFiles) / sizeof(romFiles[0]));
+    Boot::mark(Boot::STAGE_STORAGE);
 
     kernel.addTask(counterTask, 1000, 1);
     kernel.addTask(ledStatusTask, 2000, 2);
+#ifdef OS_TELEMETRY
+    kernel.addTask(telemetryTask, 20, 3);
+#else
     kernel.addTask(systemMonitorTask, 10000, 3);
+#endif
     kernel.addTask(fsTask, 4000, 4);
     kernel.addTask(blinkTask, 1000, 4);
+    // Включается после инициализации дисплея
     kernel.addTask(lcdTask, 5000, 4);
+    kernel.enableTask(lcdTask, false);
+#ifdef OS_TRACE
+    kernel.addTask(traceTask, 1000, 5);
+#endif
+#ifdef OS_SHELL
+    kernel.addTask(Shell::poll, 2, 5);
+#endif
+    kernel.setIdleHook(idleTask);
     //kernel.addTask(debugTime, 3000, 1);
     //kernel.addTask(testCrash, 3000, 1);
 
+    Boot::defer(loggerInit, Boot::STAGE_LOGGER);
+    Boot::defer(lcdInit, Boot::STAGE_DISPLAY);
+    Boot::defer(consoleInit, Boot::STAGE_CONSOLE);
+    Boot::start();
+
     if(SystemGuard::isEnabled()) 
     {
         SystemGuard::disable();
@@ -82,6 +133,62 @@ void setup()
     kernel.begin();
 }
 
+/**
+ * @brief Том на SD-карте (если есть) и файл лога
+ *
+ * Инициализация карты идёт по шагу за запуск задачи загрузки.
+ */
+void loggerInit() 
+{
+#ifdef OS_SD_CS
+    static bool started = false;
+    if (!started) 
+    {
+        sysSpi.begin();
+        sdCard.start();
+        started = true;
+    }
+    SdCard::InitState state = sdCard.poll();
+    if (state == SdCard::INIT_BUSY) 
+    {
+        Boot::retry();
+        return;
+    }
+    if (state == SdCard::INIT_READY && fs.mountVolume(sdCache, true)) 
+    {
+        logger.setFile("/log.txt");
+    }
+#endif
+    logger.begin();
+}
+
+/**
+ * @brief Дисплей: lcd.begin() ждёт готовности контроллера более 50 мс
+ */
+void lcdInit() 
+{
+    lcdRS.setMode(GPIO::GPIO_OUTPUT);
+    lcdE.setMode(GPIO::GPIO_OUTPUT);
+    lcdD4.setMode(GPIO::GPIO_OUTPUT);
+    lcdD5.setMode(GPIO::GPIO_OUTPUT);
+    lcdD6.setMode(GPIO::GPIO_OUTPUT);
+    lcdD7.setMode(GPIO::GPIO_OUTPUT);
+
+    lcd.begin(16, 2);
+    kernel.enableTask(lcdTask, true);
+    lcdTask();
+}
+
+/**
+ * @brief Отчёт об аварии, заставка и время этапов загрузки
+ */
+void consoleInit() 
+{
+    CrashLog::report(Serial);
+    kernel.printBanner(Serial);
+    Boot::report(Serial);
+}
+
 void testCrash() 
 {
 static int fileCounter = 0;
@@ -90,7 +197,7 @@ static int fileCounter = 0;
     
     if (!fs.createFile(fileName, content)) 
     {
-        logger.log("ERR: Failed to create " + fileName);
+        LOG_MSG(MSG_FILE_CREATE, fileName);
     } 
     else 
     {
@@ -110,29 +217,46 @@ void loop()
 
 void counterTask() 
 {
-    counter = (counter + 1) % 1000;
+    int value = (counter.load() + 1) % 1000;
+    counter.store(value);
     static int lastCounter = -1;
 
-    if (counter != lastCounter) 
+    if (value != lastCounter) 
     {
-        if (!fs.writeFile("counter.txt", String(counter))) 
+        if (!fs.writeFile("counter.txt", String(value))) 
         {
-            logger.log("ERR: Failed to write counter");
+            LOG_MSG(MSG_COUNTER_WRITE);
         }
-        lastCounter = counter;
+        lastCounter = value;
     }
 }
 
 void fsTask() 
 {
     static uint32_t lastCheck = 0;
+    // Карта ещё писала блок при sync(): повтор при следующем запуске
+    static bool syncPending = false;
+    if (syncPending) 
+    {
+        syncPending = !fs.sync() && fs.isVolumeBusy();
+    }
     if (sysTimer.millis() - lastCheck > 30000) 
     {
         lastCheck = sysTimer.millis();
 
+        if (!fs.verifyFilesystem()) 
+        {
+            LOG_MSG(MSG_FS_CORRUPT);
+        }
+        if (!fs.sync()) 
+        {
+            syncPending = fs.isVolumeBusy();
+            if (!syncPending) LOG_MSG(MSG_VOLUME_SYNC);
+        }
+
         if (!fs.fileExists("counter.txt")) 
         {
-            logger.log("WARN: counter.txt missing, recreating");
+            LOG_MSG(MSG_COUNTER_MISSING);
             fs.createFile("counter.txt", "0");
         }
 
@@ -142,6 +266,14 @@ void fsTask()
     }
 }
 
+/**
+ * @brief Фоновая проверка данных ФС в простое планировщика
+ */
+void idleTask() 
+{
+    fs.scrubStep();
+}
+
 void debugTime() 
 {
     while (true) {}
@@ -161,7 +293,40 @@ void systemMonitorTask()
     Serial.print(F(" M="));
     Serial.print(SystemMonitor::freeMemory());
     Serial.println(F("B"));
+    Heap::report(Serial);
+    os::top(Serial);
+#ifdef OS_IRQ_STATS
+    IrqStats::report(Serial);
+#endif
+}
+
+#ifdef OS_TELEMETRY
+/**
+ * @brief Потоковая телеметрия вместо systemMonitorTask
+ *
+ * Одна запись за вызов по кругу: система, память, задачи по одной.
+ * Кадр не длиннее буфера передачи, поэтому задача не ждёт UART.
+ */
+void telemetryTask() 
+{
+    static uint8_t slot = 0;
+    if (slot == 0) Telemetry::sendSystem();
+    else if (slot == 1) Telemetry::sendMemory();
+    else Telemetry::sendTask(slot - 2);
+
+    if (++slot >= kernel.getTaskCount() + 2) slot = 0;
+}
+#endif
+
+#ifdef OS_TRACE
+/**
+ * @brief Вывод накопленной трассы в Serial (декодер: tools/trace_decode.py)
+ */
+void traceTask() 
+{
+    Trace::flush(Serial);
 }
+#endif
 
 void blinkTask() 
 {
@@ -177,10 +342,14 @@ void ledStatusTask()
     static uint32_t lastPrintTime = 0;
     if (sysTimer.millis() - lastPrintTime >= 1000) {
         lastPrintTime = sysTimer.millis();
+#ifdef OS_TELEMETRY
+        Telemetry::sendCounter(0, counter.load());
+#else
         Serial.print("[");
         Serial.print(sysTimer.millis());
         Serial.print(" ms] Counter: ");
-        Serial.println(counter);
+        Serial.println(counter.load());
+#endif
     }
 }
 
@@ -197,7 +366,7 @@ void lcdTask()
 
         lcd.setCursor(0, 1);
         lcd.print("Counter: ");
-        lcd.print(counter);
+        lcd.print(counter.load());
         lcd.print("    "); 
     }
 }
\ No newline at end of file
@@ -1,5 +1,4 @@
 #include "syscalls.h"
-#include <Arduino.h>
 #include "driver/timer.h"
 
 extern Timer sysTimer;
@@ -21,8 +20,8 @@ namespace os
      */
     void task_delay(unsigned long ms) 
     {
-        unsigned long start = millis();
-        while (millis() - start < ms) 
+        uint32_t start = sysTimer.millis();
+        while (sysTimer.millis() - start < ms) 
         {
             kernel.run();
         }
@@ -83,7 +82,36 @@ namespace os
      */
     void sys_reboot() 
     {
-        asm volatile ("jmp 0");
+        hal::irqDisable();
+        CrashLog::capture(CrashLog::CAUSE_SOFTWARE);
+        hal::reboot();
+    }
+
+    /**
+     * @brief Системное время
+     * @return Миллисекунды с начала работы
+     */
+    uint32_t sys_millis() 
+    {
+        return sysTimer.millis();
+    }
+
+    /**
+     * @brief Системное время с микросекундным разрешением
+     * @return Микросекунды с начала работы (32 бита, переполнение через ~71 мин)
+     */
+    uint32_t sys_micros() 
+    {
+        return sysTimer.micros();
+    }
+
+    /**
+     * @brief Полный аптайм без переполнения
+     * @return Микросекунды с начала работы (64 бита)
+     */
+    uint64_t sys_uptime() 
+    {
+        return sysTimer.uptimeMicros();
     }
 
     /**
@@ -131,6 +159,16 @@ namespace os
         return kernel.sem_signal(sem_id);
     }
     
+    /**
+     * @brief Освобождение семафора из обработчика прерывания
+     * @param sem_id Идентификатор семафора
+     * @return true если сигнал принят (применится в следующем проходе планировщика)
+     */
+    bool sem_signal_isr(int sem_id)
+    {
+        return kernel.sem_signal_isr(sem_id);
+    }
+    
     /**
      * @brief Удаление семафора
      * @param sem_id Идентификатор семафора
@@ -140,4 +178,86 @@ namespace os
     {
         return kernel.sem_delete(sem_id);
     }
-};
\ No newline at end of file
+
+    /**
+     * @brief Получение события ввода без дребезга
+     * @param event Событие (пин, уровень, время в мкс)
+     * @return true если событие получено
+     */
+    bool input_read(InputEvent& event) 
+    {
+#ifdef __AVR__
+        return sysInput.read(event);
+#else
+        (void)event;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Снимок состояния задачи
+     * @param index Индекс задачи (0..getTaskCount()-1)
+     * @param info Заполняемая структура
+     * @return false если задачи нет
+     */
+    bool task_info(uint8_t index, TaskInfo& info)
+    {
+        return kernel.getTaskInfo(index, info);
+    }
+
+    /**
+     * @brief Загрузка процессора
+     * @return Промилле за последнее окно OS_LOAD_WINDOW_MS
+     */
+    uint16_t sys_load()
+    {
+        return kernel.getSystemLoad();
+    }
+
+    /**
+     * @brief Таблица загрузки задач в стиле top (без String и кучи)
+     * @param out Поток вывода
+     */
+    void top(Print& out)
+    {
+        uint16_t load = kernel.getSystemLoad();
+        out.print(F("CPU "));
+        out.print(load / 10);
+        out.print('.');
+        out.print(load % 10);
+        out.print(F("% idle "));
+        out.print(kernel.getIdleTime());
+        out.println(F(" ms"));
+        out.println(F("#\tpri\tperiod\truns\tlast\tmax\tjitter\tovr\tmiss\tbusy\tload"));
+
+        TaskInfo info;
+        for (uint8_t i = 0; task_info(i, info); i++)
+        {
+            out.print(i);
+            if (!info.enabled) out.print('-');
+            out.print('\t');
+            out.print(info.priority);
+            out.print('\t');
+            out.print(info.activePeriod);
+            out.print('\t');
+            out.print(info.runCount);
+            out.print('\t');
+            out.print(info.lastRunTime);
+            out.print('\t');
+            out.print(info.maxRunTime);
+            out.print('\t');
+            out.print(info.maxJitter);
+            out.print('\t');
+            out.print(info.overruns);
+            out.print('\t');
+            out.print(info.misses);
+            out.print('\t');
+            out.print(info.totalBusy);
+            out.print('\t');
+            out.print(info.load / 10);
+            out.print('.');
+            out.print(info.load % 10);
+            out.println('%');
+        }
+    }
+};
@@ -3,6 +3,7 @@
 
 #include "kernel/kernel.h"
 #include "fs/fs.h"
+#include "driver/input.h"
 
 namespace os 
 {
@@ -14,13 +15,21 @@ namespace os
     bool file_write(const String& name, const String& content);
     bool file_delete(const String& name);
     void sys_reboot();
+    uint32_t sys_millis();
+    uint32_t sys_micros();
+    uint64_t sys_uptime();
     String sys_info();
     
     int sem_create(int initial_count = 1);
     bool sem_wait(int sem_id);
     bool sem_signal(int sem_id);
+    bool sem_signal_isr(int sem_id);
     bool sem_delete(int sem_id);
-    String task_info();
+
+    bool input_read(InputEvent& event);
+    bool task_info(uint8_t index, TaskInfo& info);
+    uint16_t sys_load();
+    void top(Print& out);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "system/boot.h"
+#include "driver/timer.h"
+
+namespace
+{
+    struct Step
+    {
+        TaskFunction function;
+        Boot::Stage stage;
+    };
+
+    uint32_t times[Boot::STAGE_COUNT];
+    uint16_t marked = 0;
+
+    Step steps[OS_BOOT_STEPS];
+    uint8_t stepCount = 0;
+    uint8_t nextStep = 0;
+    bool repeat = false;
+
+    const char* const stageNames[Boot::STAGE_COUNT] =
+    {
+        "drivers", "storage", "scheduler", "first-task", "logger", "display", "console", "ready"
+    };
+
+    static_assert(Boot::STAGE_COUNT <= 16, "stage bits must fit in marked");
+}
+
+namespace Boot
+{
+    /**
+     * @brief Отметка этапа загрузки
+     * @param stage Этап; повторная отметка не меняет время
+     */
+    void mark(Stage stage)
+    {
+        if (stage >= STAGE_COUNT || isMarked(stage)) return;
+        times[stage] = sysTimer.micros();
+        marked |= 1U << stage;
+    }
+
+    bool isMarked(Stage stage)
+    {
+        return stage < STAGE_COUNT && (marked & (1U << stage));
+    }
+
+    /**
+     * @brief Время этапа
+     * @return мкс от запуска системного таймера, 0 если этап не отмечен
+     */
+    uint32_t stageTime(Stage stage)
+    {
+        return isMarked(stage) ? times[stage] : 0;
+    }
+
+    /**
+     * @brief Регистрация отложенного шага инициализации
+     * @param step Функция шага
+     * @param stage Этап, отмечаемый после выполнения шага
+     * @return false если нет места (OS_BOOT_STEPS)
+     *
+     * Шаги выполняются в порядке регистрации.
+     */
+    bool defer(TaskFunction step, Stage stage)
+    {
+        if (!step || stepCount >= OS_BOOT_STEPS) return false;
+        steps[stepCount++] = {step, stage};
+        return true;
+    }
+
+    /**
+     * @brief Повтор текущего шага при следующем запуске задачи
+     *
+     * Вызывается из шага, который ждёт устройство: вместо ожидания в
+     * одном запуске шаг повторяется, пока не перестанет вызывать retry().
+     */
+    void retry()
+    {
+        repeat = true;
+    }
+
+    /**
+     * @brief Добавление задачи отложенной инициализации
+     * @param priority Приоритет задачи; по умолчанию - ниже всех
+     * @return true если задача добавлена
+     */
+    bool start(uint8_t priority)
+    {
+        return kernel.addTask(task, OS_BOOT_STEP_MS, priority);
+    }
+
+    /**
+     * @brief Задача загрузки: один отложенный шаг за запуск
+     *
+     * После последнего шага отмечает STAGE_READY и отключается
+     * (удаление задачи во время прохода run() сдвинуло бы таблицу).
+     */
+    void task()
+    {
+        if (nextStep < stepCount)
+        {
+            const Step& step = steps[nextStep];
+            repeat = false;
+            step.function();
+            if (repeat) return;
+            nextStep++;
+            mark(step.stage);
+        }
+        if (nextStep >= stepCount)
+        {
+            mark(STAGE_READY);
+            kernel.enableTask(task, false);
+        }
+    }
+
+    /**
+     * @brief Вывод отмеченных этапов одной строкой, мкс
+     */
+    void report(Print& out)
+    {
+        out.print(F("Boot, us:"));
+        for (uint8_t i = 0; i < STAGE_COUNT; i++)
+        {
+            if (!isMarked((Stage)i)) continue;
+            out.print(' ');
+            out.print(stageNames[i]);
+            out.print('=');
+            out.print(times[i]);
+        }
+        out.println();
+    }
+}
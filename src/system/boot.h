@@ -0,0 +1,59 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include "hal/hal.h"
+#include "kernel/scheduler.h"
+
+// Отложенных шагов инициализации
+#ifndef OS_BOOT_STEPS
+#define OS_BOOT_STEPS 4
+#endif
+
+// Период задачи отложенной инициализации, мс: шаг должен успевать за
+// период, иначе в лог попадёт перегрузка задачи. Отчёт о сбросе и
+// заставка (около 250 символов) на 9600 бод выводятся примерно за 250 мс
+#ifndef OS_BOOT_STEP_MS
+#define OS_BOOT_STEP_MS 300
+#endif
+
+/**
+ * @brief Поэтапная загрузка
+ *
+ * В setup() выполняется только то, без чего не могут работать задачи;
+ * медленная и необязательная инициализация (дисплей, том и файл лога,
+ * вывод в Serial) регистрируется defer() и выполняется задачей
+ * низшего приоритета по одному шагу за запуск, уже после первых
+ * запусков остальных задач.
+ *
+ * Время этапов отсчитывается в мкс от запуска системного таймера
+ * (начало setup()); загрузчик и конструкторы глобальных объектов в
+ * него не входят. Каждый этап отмечается один раз.
+ */
+namespace Boot
+{
+    enum Stage : uint8_t
+    {
+        STAGE_DRIVERS,      // Таймер, АЦП, порты
+        STAGE_STORAGE,      // Файлы ФС и ПЗУ
+        STAGE_SCHEDULER,    // Задачи добавлены, Scheduler::begin()
+        STAGE_FIRST_TASK,   // Первый запуск задачи
+        STAGE_LOGGER,       // Том и файл лога
+        STAGE_DISPLAY,      // Дисплей
+        STAGE_CONSOLE,      // Отчёт об аварии и заставка в Serial
+        STAGE_READY,        // Все отложенные шаги выполнены
+        STAGE_COUNT
+    };
+
+    void mark(Stage stage);
+    bool isMarked(Stage stage);
+    uint32_t stageTime(Stage stage);
+
+    bool defer(TaskFunction step, Stage stage);
+    void retry();
+    bool start(uint8_t priority = 255);
+    void task();
+
+    void report(Print& out);
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include "system/crash.h"
+#include "kernel/scheduler.h"
+#include "driver/timer.h"
+#ifdef __AVR__
+#include "system/monitor.h"
+#endif
+#include <stddef.h>
+#include <string.h>
+
+static_assert(CrashLog::TASK_SLOTS == MAX_TASKS, "crash record must hold every task");
+
+#ifndef OS_CRASH_EEPROM_ADDR
+#define OS_CRASH_EEPROM_ADDR 0
+#endif
+
+namespace
+{
+    const uint16_t MAGIC = 0xC7A5;
+
+    struct Counters
+    {
+        uint16_t magic;
+        uint16_t counts[CrashLog::CAUSE_COUNT];
+        uint16_t check;
+    };
+
+    // Переживают перезапуск, но не отключение питания
+    CrashLog::Record saved HAL_NOINIT;
+    Counters counters HAL_NOINIT;
+
+    CrashLog::Cause bootCause = CrashLog::CAUSE_POWER_ON;
+
+    const char* const causeNames[CrashLog::CAUSE_COUNT] =
+    {
+        "power-on", "external", "brown-out", "watchdog", "software", "wdt-timeout", "overrun", "memory"
+    };
+
+    /**
+     * @brief Контрольная сумма Флетчера-16
+     */
+    uint16_t checksum(const void* data, size_t size)
+    {
+        const uint8_t* p = (const uint8_t*)data;
+        uint8_t a = 0, b = 0;
+        while (size--)
+        {
+            a += *p++;
+            b += a;
+        }
+        return ((uint16_t)b << 8) | a;
+    }
+
+    bool recordValid(const CrashLog::Record& r)
+    {
+        return r.magic == MAGIC && r.cause < CrashLog::CAUSE_COUNT &&
+               r.check == checksum(&r, offsetof(CrashLog::Record, check));
+    }
+
+    void sealRecord(CrashLog::Record& r)
+    {
+        r.check = checksum(&r, offsetof(CrashLog::Record, check));
+    }
+
+    bool countersValid(const Counters& c)
+    {
+        return c.magic == MAGIC && c.check == checksum(&c, offsetof(Counters, check));
+    }
+
+    void sealCounters(Counters& c)
+    {
+        c.check = checksum(&c, offsetof(Counters, check));
+    }
+
+    bool isCrash(CrashLog::Cause cause)
+    {
+        return cause >= CrashLog::CAUSE_WDT_TIMEOUT;
+    }
+}
+
+namespace CrashLog
+{
+    /**
+     * @brief Определение причины сброса при загрузке
+     * @return Причина последнего сброса
+     *
+     * Вызывается один раз в начале setup(). Счётчик причины
+     * увеличивается, новая запись об аварии помечается обработанной.
+     */
+    Cause begin()
+    {
+        uint8_t flags = hal::resetFlags();
+        bool fresh = recordValid(saved) && saved.pending;
+
+#ifdef OS_CRASH_EEPROM
+        const uint16_t recordAddr = OS_CRASH_EEPROM_ADDR + sizeof(Counters);
+        Counters stored;
+        hal::eepromRead(OS_CRASH_EEPROM_ADDR, &stored, sizeof(stored));
+        if (countersValid(stored)) counters = stored;
+        if (!recordValid(saved)) hal::eepromRead(recordAddr, &saved, sizeof(saved));
+#endif
+        if (!countersValid(counters) || ((flags & hal::RESET_POWER_ON) && !fresh))
+        {
+#ifdef OS_CRASH_EEPROM
+            if (!countersValid(stored))
+#endif
+            {
+                memset(&counters, 0, sizeof(counters));
+                counters.magic = MAGIC;
+            }
+        }
+        if (!recordValid(saved)) saved.magic = 0;
+
+        if (fresh) bootCause = saved.cause;
+        else if (flags & hal::RESET_POWER_ON) bootCause = CAUSE_POWER_ON;
+        else if (flags & hal::RESET_BROWN_OUT) bootCause = CAUSE_BROWN_OUT;
+        else if (flags & hal::RESET_EXTERNAL) bootCause = CAUSE_EXTERNAL;
+        else if (flags & hal::RESET_WATCHDOG) bootCause = CAUSE_WATCHDOG;
+        else bootCause = CAUSE_SOFTWARE;
+
+        if (counters.counts[bootCause] < 0xFFFF) counters.counts[bootCause]++;
+        sealCounters(counters);
+
+        if (fresh)
+        {
+            saved.pending = 0;
+            sealRecord(saved);
+        }
+#ifdef OS_CRASH_EEPROM
+        if (fresh && isCrash(bootCause)) hal::eepromWrite(recordAddr, &saved, sizeof(saved));
+        hal::eepromWrite(OS_CRASH_EEPROM_ADDR, &counters, sizeof(counters));
+#endif
+        return bootCause;
+    }
+
+    /**
+     * @brief Заполнение записи об аварии (с запрещёнными прерываниями)
+     * @param cause Причина
+     *
+     * Только запись в SRAM, без вывода: после неё сразу выполняется
+     * перезапуск.
+     */
+    void capture(Cause cause)
+    {
+        saved.magic = MAGIC;
+        saved.cause = cause;
+        saved.task = kernel.getCurrentTask();
+        saved.pc = hal::faultAddress();
+        saved.uptime = sysTimer.millis();
+#ifdef __AVR__
+        saved.freeMemory = SystemMonitor::freeMemory();
+#else
+        saved.freeMemory = 0;
+#endif
+        uint8_t n = kernel.getTaskCount();
+        saved.taskCount = n;
+        for (uint8_t i = 0; i < TASK_SLOTS; i++)
+        {
+            TaskRecord& t = saved.tasks[i];
+            const Task* task = (i < n) ? kernel.getTask(i) : nullptr;
+            t.runCount = task ? task->runCount : 0;
+            t.maxRunTime = task ? task->maxRunTime : 0;
+            t.lastRunTime = task ? task->lastRunTime : 0;
+        }
+        saved.pending = 1;
+        sealRecord(saved);
+    }
+
+    /**
+     * @brief Причина последнего сброса (после begin())
+     */
+    Cause lastCause()
+    {
+        return bootCause;
+    }
+
+    /**
+     * @brief Есть ли сохранённая запись об аварии
+     */
+    bool hasRecord()
+    {
+        return recordValid(saved) && isCrash(saved.cause);
+    }
+
+    const Record& record()
+    {
+        return saved;
+    }
+
+    /**
+     * @brief Количество сбросов по причине
+     */
+    uint16_t count(Cause cause)
+    {
+        return (cause < CAUSE_COUNT) ? counters.counts[cause] : 0;
+    }
+
+    /**
+     * @brief Обнуление счётчиков сбросов
+     */
+    void clearCounts()
+    {
+        memset(counters.counts, 0, sizeof(counters.counts));
+        sealCounters(counters);
+#ifdef OS_CRASH_EEPROM
+        hal::eepromWrite(OS_CRASH_EEPROM_ADDR, &counters, sizeof(counters));
+#endif
+    }
+
+    const char* causeName(Cause cause)
+    {
+        return (cause < CAUSE_COUNT) ? causeNames[cause] : "?";
+    }
+
+    /**
+     * @brief Вывод причины сброса, счётчиков и последней записи об аварии
+     * @param out Поток вывода
+     */
+    void report(Print& out)
+    {
+        out.print(F("Reset: "));
+        out.println(causeName(bootCause));
+        out.print(F("Resets:"));
+        for (uint8_t i = 0; i < CAUSE_COUNT; i++)
+        {
+            if (counters.counts[i] == 0) continue;
+            out.print(' ');
+            out.print(causeNames[i]);
+            out.print('=');
+            out.print(counters.counts[i]);
+        }
+        out.println();
+
+        if (!hasRecord()) return;
+        out.print(F("Crash: "));
+        out.print(causeName(saved.cause));
+        out.print(F(" task="));
+        out.print(saved.task);
+        out.print(F(" pc=0x"));
+        out.print(saved.pc, HEX);
+        out.print(F(" uptime="));
+        out.print(saved.uptime);
+        out.print(F(" ms free="));
+        out.print(saved.freeMemory);
+        out.println(F(" B"));
+        for (uint8_t i = 0; i < saved.taskCount && i < TASK_SLOTS; i++)
+        {
+            out.print(F("  task "));
+            out.print(i);
+            out.print(F(": runs="));
+            out.print(saved.tasks[i].runCount);
+            out.print(F(" max="));
+            out.print(saved.tasks[i].maxRunTime);
+            out.print(F("us last="));
+            out.print(saved.tasks[i].lastRunTime);
+            out.println(F("us"));
+        }
+    }
+}
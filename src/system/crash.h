@@ -0,0 +1,69 @@
+#ifndef CRASH_H
+#define CRASH_H
+
+#include "hal/hal.h"
+#include "kernel/config.h"
+
+/**
+ * @brief Запись об аварии, переживающая перезапуск
+ *
+ * При аварии запись заполняется в секции .noinit (без вывода в Serial) и
+ * устройство сразу перезапускается. При следующей загрузке begin()
+ * определяет причину сброса, увеличивает счётчик этой причины и
+ * сообщает о новой записи. С флагом -DOS_CRASH_EEPROM запись и
+ * счётчики при загрузке копируются в EEPROM и переживают отключение
+ * питания.
+ */
+namespace CrashLog
+{
+    enum Cause : uint8_t
+    {
+        CAUSE_POWER_ON,     // Включение питания
+        CAUSE_EXTERNAL,     // Кнопка сброса / DTR
+        CAUSE_BROWN_OUT,    // Просадка питания
+        CAUSE_WATCHDOG,     // Аппаратный сброс сторожевым таймером без записи
+        CAUSE_SOFTWARE,     // os::sys_reboot()
+        CAUSE_WDT_TIMEOUT,  // Зависание задачи (прерывание сторожевого таймера)
+        CAUSE_OVERRUN,      // Превышение времени выполнения задачи
+        CAUSE_MEMORY,       // Нехватка памяти
+        CAUSE_COUNT
+    };
+
+    // Слотов задач в записи (равно MAX_TASKS планировщика)
+    const uint8_t TASK_SLOTS = OsConfig::MAX_TASKS;
+
+    struct TaskRecord
+    {
+        uint32_t runCount;
+        uint32_t maxRunTime;    // мкс
+        uint32_t lastRunTime;   // мкс
+    };
+
+    struct Record
+    {
+        uint16_t magic;
+        Cause cause;
+        int8_t task;            // Индекс выполнявшейся задачи, -1 вне задачи
+        uint32_t pc;            // Прерванный адрес (байтовый), 0 если неизвестен
+        uint32_t uptime;        // мс
+        int16_t freeMemory;
+        uint8_t taskCount;
+        uint8_t pending;        // Запись ещё не обработана при загрузке
+        TaskRecord tasks[TASK_SLOTS];
+        uint16_t check;
+    };
+
+    Cause begin();
+    void capture(Cause cause);
+
+    Cause lastCause();
+    bool hasRecord();
+    const Record& record();
+    uint16_t count(Cause cause);
+    void clearCounts();
+
+    const char* causeName(Cause cause);
+    void report(Print& out);
+}
+
+#endif
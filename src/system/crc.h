@@ -0,0 +1,49 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include "hal/hal.h"
+
+#ifdef __AVR__
+#include <util/crc16.h>
+#endif
+
+/**
+ * @brief CRC-16/CCITT-FALSE (полином 0x1021, начальное значение 0xFFFF)
+ *
+ * На AVR используется _crc_xmodem_update из avr-libc, на остальных
+ * платформах - побитовый расчёт с тем же результатом.
+ */
+namespace Crc
+{
+    const uint16_t CRC16_INIT = 0xFFFF;
+
+    inline uint16_t crc16Update(uint16_t crc, uint8_t data)
+    {
+#ifdef __AVR__
+        return _crc_xmodem_update(crc, data);
+#else
+        crc ^= (uint16_t)data << 8;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+        return crc;
+#endif
+    }
+
+    /**
+     * @brief Продолжение расчёта CRC по блоку данных
+     * @param data Данные
+     * @param size Размер в байтах
+     * @param crc Текущее значение (CRC16_INIT для нового расчёта)
+     * @return Новое значение
+     */
+    inline uint16_t crc16(const void* data, size_t size, uint16_t crc = CRC16_INIT)
+    {
+        const uint8_t* p = (const uint8_t*)data;
+        while (size--) crc = crc16Update(crc, *p++);
+        return crc;
+    }
+}
+
+#endif
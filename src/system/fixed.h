@@ -0,0 +1,298 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include "hal/hal.h"
+
+/*
+ * Числа с фиксированной точкой (формат Q) для мониторинга и обработки
+ * показаний датчиков без плавающей точки. На AVR нет FPU: программная
+ * арифметика float добавляет несколько КБ flash и сотни тактов на
+ * операцию, целочисленная - единицы и десятки тактов.
+ *
+ * Q<F, T>   - значение raw / 2^F в целом типе T. Умножение и деление
+ *             идут через тип двойной ширины (Wide), результат
+ *             округляется к ближайшему. Переполнение не проверяется,
+ *             как у встроенных целых.
+ * Percent, Volts, Millivolts - единицы SystemMonitor.
+ * Ema, MovingAverage - фильтры целых выборок.
+ * format    - десятичная запись без printf("%f").
+ */
+
+namespace Fixed
+{
+    // Тип промежуточного результата умножения
+    template <typename T> struct Wide;
+    template <> struct Wide<int8_t> { typedef int16_t Type; };
+    template <> struct Wide<uint8_t> { typedef uint16_t Type; };
+    template <> struct Wide<int16_t> { typedef int32_t Type; };
+    template <> struct Wide<uint16_t> { typedef uint32_t Type; };
+    template <> struct Wide<int32_t> { typedef int64_t Type; };
+    template <> struct Wide<uint32_t> { typedef uint64_t Type; };
+
+    // Деление с округлением отдельно для знаковых и беззнаковых типов:
+    // проверка знака беззнакового значения дала бы -Wtype-limits
+    template <typename W, bool SIGNED = ((W)-1 < (W)0)>
+    struct Rounding
+    {
+        static W divide(W num, W den)
+        {
+            if (den < 0) { num = -num; den = -den; }
+            return (num < 0) ? -((-num + den / 2) / den) : (num + den / 2) / den;
+        }
+    };
+
+    template <typename W>
+    struct Rounding<W, false>
+    {
+        static W divide(W num, W den) { return (num + den / 2) / den; }
+    };
+
+    /**
+     * @brief Частное с округлением к ближайшему
+     */
+    template <typename W>
+    inline W divRound(W num, W den)
+    {
+        return Rounding<W>::divide(num, den);
+    }
+
+    /**
+     * @brief Число с фиксированной точкой: F дробных бит в типе T
+     */
+    template <uint8_t F, typename T = int16_t>
+    class Q
+    {
+    public:
+        typedef T Raw;
+        typedef typename Wide<T>::Type WideRaw;
+        static const uint8_t FRACTION = F;
+        static constexpr T ONE = (T)((T)1 << F);
+
+        static_assert(F < sizeof(T) * 8, "fraction bits exceed storage");
+
+        constexpr Q() : _raw(0) {}
+
+        static constexpr Q fromRaw(T raw) { return Q(raw, 0); }
+        static constexpr Q fromInt(T value) { return Q((T)(value * ONE), 0); }
+
+        /**
+         * @brief num / den с округлением
+         * @note num * 2^F должно помещаться в WideRaw
+         */
+        static Q fromRatio(WideRaw num, WideRaw den)
+        {
+            return Q((T)divRound<WideRaw>(num * ONE, den), 0);
+        }
+
+        /**
+         * @brief Перевод из другого формата с округлением
+         */
+        template <uint8_t G, typename U>
+        static Q from(Q<G, U> other)
+        {
+            WideRaw raw = other.raw();
+            if (G > F) return Q((T)divRound<WideRaw>(raw, (WideRaw)1 << (G > F ? G - F : 0)), 0);
+            return Q((T)(raw * ((WideRaw)1 << (F > G ? F - G : 0))), 0);
+        }
+
+        constexpr T raw() const { return _raw; }
+        // Целая часть с округлением вниз
+        constexpr T floor() const { return _raw >> F; }
+        T round() const { return (T)divRound<WideRaw>(_raw, ONE); }
+
+        /**
+         * @brief Значение в единицах 1/scale (например, scale = 1000 - тысячные)
+         */
+        WideRaw scaled(uint16_t scale) const { return divRound<WideRaw>((WideRaw)_raw * scale, ONE); }
+
+        Q operator+(Q b) const { return Q((T)(_raw + b._raw), 0); }
+        Q operator-(Q b) const { return Q((T)(_raw - b._raw), 0); }
+        Q operator-() const { return Q((T)-_raw, 0); }
+        Q operator*(Q b) const { return Q((T)divRound<WideRaw>((WideRaw)_raw * b._raw, ONE), 0); }
+        Q operator/(Q b) const { return Q((T)divRound<WideRaw>((WideRaw)_raw * ONE, b._raw), 0); }
+        Q operator*(T k) const { return Q((T)(_raw * k), 0); }
+        Q operator/(T k) const { return Q((T)divRound<WideRaw>(_raw, k), 0); }
+
+        Q& operator+=(Q b) { _raw += b._raw; return *this; }
+        Q& operator-=(Q b) { _raw -= b._raw; return *this; }
+
+        constexpr bool operator==(Q b) const { return _raw == b._raw; }
+        constexpr bool operator!=(Q b) const { return _raw != b._raw; }
+        constexpr bool operator<(Q b) const { return _raw < b._raw; }
+        constexpr bool operator<=(Q b) const { return _raw <= b._raw; }
+        constexpr bool operator>(Q b) const { return _raw > b._raw; }
+        constexpr bool operator>=(Q b) const { return _raw >= b._raw; }
+
+    private:
+        T _raw;
+
+        constexpr Q(T raw, int) : _raw(raw) {}
+    };
+
+    // 0..127.99 %, шаг 1/256 %
+    typedef Q<8, int16_t> Percent;
+    // 0..15.99 В, шаг 0.25 мВ
+    typedef Q<12, uint16_t> Volts;
+
+    /**
+     * @brief Доля part от whole в процентах
+     * @note part * 25600 должно помещаться в uint32_t (part < 167772)
+     */
+    inline Percent percent(uint32_t part, uint32_t whole)
+    {
+        if (whole == 0) return Percent();
+        return Percent::fromRaw((int16_t)((part * 100UL * Percent::ONE + whole / 2) / whole));
+    }
+
+    /**
+     * @brief Напряжение в целых милливольтах
+     */
+    class Millivolts
+    {
+    public:
+        constexpr explicit Millivolts(uint16_t mv = 0) : _mv(mv) {}
+
+        constexpr uint16_t value() const { return _mv; }
+        Volts volts() const { return Volts::fromRatio(_mv, 1000); }
+
+        constexpr bool operator<(Millivolts b) const { return _mv < b._mv; }
+        constexpr bool operator>(Millivolts b) const { return _mv > b._mv; }
+        constexpr bool operator==(Millivolts b) const { return _mv == b._mv; }
+
+    private:
+        uint16_t _mv;
+    };
+
+    /**
+     * @brief a * b / c с округлением, без переполнения промежуточного результата
+     */
+    inline uint32_t mulDiv(uint16_t a, uint16_t b, uint16_t c)
+    {
+        return ((uint32_t)a * b + c / 2) / c;
+    }
+
+    /**
+     * @brief Линейный перевод x из [inMin, inMax] в [outMin, outMax]
+     *
+     * В отличие от map() Arduino округляет к ближайшему. Значения вне
+     * диапазона экстраполируются.
+     */
+    inline int32_t scale(int32_t x, int32_t inMin, int32_t inMax, int32_t outMin, int32_t outMax)
+    {
+        if (inMax == inMin) return outMin;
+        return outMin + divRound<int32_t>((x - inMin) * (outMax - outMin), inMax - inMin);
+    }
+
+    /**
+     * @brief Экспоненциальное сглаживание: y += (x - y) / 2^SHIFT
+     *
+     * Состояние хранится с F дробными битами, чтобы малые приращения не
+     * терялись при сдвиге (как IIR каналов Adc). Первая выборка
+     * принимается как есть.
+     */
+    template <uint8_t SHIFT, uint8_t F = 6>
+    class Ema
+    {
+    public:
+        int16_t update(int16_t x)
+        {
+            int32_t target = (int32_t)x * (1L << F);
+            if (!_ready) { _state = target; _ready = true; }
+            else _state += (target - _state) / (1L << SHIFT);
+            return value();
+        }
+
+        int16_t value() const { return (int16_t)divRound<int32_t>(_state, 1L << F); }
+        Q<F, int32_t> precise() const { return Q<F, int32_t>::fromRaw(_state); }
+        bool isReady() const { return _ready; }
+        void reset() { _state = 0; _ready = false; }
+
+    private:
+        int32_t _state = 0;
+        bool _ready = false;
+    };
+
+    /**
+     * @brief Скользящее среднее по N последним выборкам с бегущей суммой
+     */
+    template <uint8_t N>
+    class MovingAverage
+    {
+    public:
+        static_assert(N != 0 && (N & (N - 1)) == 0, "window must be a power of two");
+
+        int16_t update(int16_t x)
+        {
+            _sum += x - _ring[_pos];
+            _ring[_pos] = x;
+            _pos = (_pos + 1) & (N - 1);
+            if (_filled < N) _filled++;
+            return value();
+        }
+
+        // До заполнения окна - среднее по имеющимся выборкам
+        int16_t value() const { return _filled ? (int16_t)divRound<int32_t>(_sum, _filled) : 0; }
+        bool isFull() const { return _filled == N; }
+
+    private:
+        int16_t _ring[N] = {};
+        int32_t _sum = 0;
+        uint8_t _pos = 0;
+        uint8_t _filled = 0;
+    };
+
+    /**
+     * @brief Десятичная запись значения
+     * @param buffer Буфер результата
+     * @param size Размер буфера с завершающим нулём
+     * @param decimals Знаков после точки (0..4), последний округляется
+     * @return Длина записи или 0, если буфер мал
+     */
+    template <uint8_t F, typename T>
+    uint8_t format(char* buffer, uint8_t size, Q<F, T> value, uint8_t decimals)
+    {
+        static const uint16_t POWERS[] = {1, 10, 100, 1000, 10000};
+        if (decimals > 4) decimals = 4;
+
+        typedef typename Q<F, T>::WideRaw W;
+        W raw = value.raw();
+        bool negative = raw < 0;
+        if (negative) raw = -raw;
+
+        uint32_t whole = (uint32_t)(raw >> F);
+        uint32_t bits = (uint32_t)(raw & ((W)Q<F, T>::ONE - 1));
+        // До 16 дробных бит произведение помещается в 32 бита
+        uint32_t fraction = (F <= 16)
+            ? (uint32_t)(((uint32_t)bits * POWERS[decimals] + (1UL << F >> 1)) >> F)
+            : (uint32_t)(((uint64_t)bits * POWERS[decimals] + (1ULL << F >> 1)) >> F);
+        if (fraction >= POWERS[decimals])
+        {
+            whole++;
+            fraction -= POWERS[decimals];
+        }
+
+        // Округлённый до нуля отрицательный результат пишется без знака
+        negative = negative && (whole || fraction);
+        char digits[16];
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < decimals; i++)
+        {
+            digits[count++] = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        if (decimals) digits[count++] = '.';
+        do
+        {
+            digits[count++] = '0' + whole % 10;
+            whole /= 10;
+        } while (whole);
+        if (negative) digits[count++] = '-';
+
+        if (count + 1 > size) return 0;
+        for (uint8_t i = 0; i < count; i++) buffer[i] = digits[count - 1 - i];
+        buffer[count] = 0;
+        return count;
+    }
+}
+
+#endif
@@ -0,0 +1,397 @@
+#include "system/heap.h"
+#ifdef OS_HEAP_POOLS_STRICT
+#include "kernel/scheduler.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    Heap::Tag currentTag = Heap::TAG_OTHER;
+    Heap::TagStats tagStats[Heap::TAG_COUNT];
+
+    const char* const tagNames[Heap::TAG_COUNT] =
+    {
+        "other", "fs", "logger", "string"
+    };
+
+#ifdef OS_HEAP_POOLS
+    typedef Heap::SizeClassPools<OS_HEAP_POOL_BLOCKS> PoolSet;
+    PoolSet pools;
+#endif
+}
+
+#ifdef __AVR__
+
+// Заголовок свободного блока avr-libc (malloc.c)
+struct FreeBlock
+{
+    size_t size;
+    FreeBlock* next;
+};
+
+extern "C"
+{
+    extern FreeBlock* __flp;
+    extern char* __brkval;
+    extern char __heap_start;
+}
+
+#if defined(OS_HEAP_TAGS) || defined(OS_HEAP_POOLS)
+
+extern "C"
+{
+    void* __real_malloc(size_t size);
+    void __real_free(void* ptr);
+    void* __real_realloc(void* ptr, size_t size);
+}
+
+namespace
+{
+    // realloc() avr-libc вызывает malloc()/free() изнутри - их не помечаем
+    bool inHook = false;
+
+#ifdef OS_HEAP_TAGS
+    const uint8_t TAG_BYTES = 1;
+#else
+    const uint8_t TAG_BYTES = 0;
+#endif
+
+    /**
+     * @brief Выделение из пулов или кучи avr-libc
+     */
+    void* rawAlloc(size_t size)
+    {
+#ifdef OS_HEAP_POOLS
+        void* ptr = pools.alloc(size);
+        if (ptr) return ptr;
+#ifdef OS_HEAP_POOLS_STRICT
+        if (size <= PoolSet::MAX_SIZE) kernel.emergencyDump(CrashLog::CAUSE_MEMORY);
+#endif
+#endif
+        inHook = true;
+        void* block = __real_malloc(size);
+        inHook = false;
+        return block;
+    }
+
+    void rawFree(void* ptr)
+    {
+#ifdef OS_HEAP_POOLS
+        if (pools.free(ptr)) return;
+#endif
+        inHook = true;
+        __real_free(ptr);
+        inHook = false;
+    }
+
+    /**
+     * @brief Изменение размера блока
+     *
+     * Блок пула остаётся на месте, пока новый размер помещается в него,
+     * иначе данные переносятся в блок большего класса или в кучу.
+     */
+    void* rawRealloc(void* ptr, size_t size)
+    {
+#ifdef OS_HEAP_POOLS
+        uint8_t have = pools.blockSize(ptr);
+        if (have)
+        {
+            if (size <= have) return ptr;
+            void* moved = rawAlloc(size);
+            if (!moved) return nullptr;
+            memcpy(moved, ptr, have);
+            pools.free(ptr);
+            return moved;
+        }
+#endif
+        inHook = true;
+        void* moved = __real_realloc(ptr, size);
+        inHook = false;
+        return moved;
+    }
+
+#ifdef OS_HEAP_TAGS
+    /**
+     * @brief Учёт блока в статистике метки
+     * @param raw Начало блока (байт метки)
+     * @param add true - выделение, false - освобождение
+     */
+    void account(uint8_t* raw, bool add)
+    {
+        uint8_t tag = raw[0];
+        if (tag >= Heap::TAG_COUNT) tag = Heap::TAG_OTHER;
+        // Размер блока пула или размер данных, который avr-libc хранит
+        // перед блоком
+#ifdef OS_HEAP_POOLS
+        uint16_t size = pools.blockSize(raw);
+        if (!size) size = ((size_t*)raw)[-1] + sizeof(size_t);
+#else
+        uint16_t size = ((size_t*)raw)[-1] + sizeof(size_t);
+#endif
+        if (add)
+        {
+            tagStats[tag].bytes += size;
+            tagStats[tag].blocks++;
+        }
+        else
+        {
+            tagStats[tag].bytes -= size;
+            tagStats[tag].blocks--;
+        }
+    }
+#endif
+
+    void* allocate(size_t size, Heap::Tag tag)
+    {
+        uint8_t* raw = (uint8_t*)rawAlloc(size + TAG_BYTES);
+        if (!raw) return nullptr;
+#ifdef OS_HEAP_TAGS
+        raw[0] = tag;
+        account(raw, true);
+#else
+        (void)tag;
+#endif
+        return raw + TAG_BYTES;
+    }
+}
+
+extern "C"
+{
+    void* __wrap_malloc(size_t size)
+    {
+        if (inHook) return __real_malloc(size);
+        return allocate(size, currentTag);
+    }
+
+    void __wrap_free(void* ptr)
+    {
+        if (inHook || !ptr)
+        {
+            __real_free(ptr);
+            return;
+        }
+        uint8_t* raw = (uint8_t*)ptr - TAG_BYTES;
+#ifdef OS_HEAP_TAGS
+        account(raw, false);
+#endif
+        rawFree(raw);
+    }
+
+    void* __wrap_realloc(void* ptr, size_t size)
+    {
+        if (inHook) return __real_realloc(ptr, size);
+        if (!ptr) return allocate(size, currentTag == Heap::TAG_OTHER ? Heap::TAG_STRING : currentTag);
+
+        uint8_t* raw = (uint8_t*)ptr - TAG_BYTES;
+#ifdef OS_HEAP_TAGS
+        account(raw, false);
+#endif
+        uint8_t* moved = (uint8_t*)rawRealloc(raw, size + TAG_BYTES);
+        // При неудаче старый блок остаётся на месте
+        if (!moved)
+        {
+#ifdef OS_HEAP_TAGS
+            account(raw, true);
+#endif
+            return nullptr;
+        }
+#ifdef OS_HEAP_TAGS
+        account(moved, true);
+#endif
+        return moved + TAG_BYTES;
+    }
+}
+
+#endif
+#endif
+
+namespace Heap
+{
+    /**
+     * @brief Обход свободного списка кучи
+     * @param out Результат
+     * @return false если куча недоступна для анализа (сборка native)
+     */
+    bool stats(Stats& out)
+    {
+        memset(&out, 0, sizeof(out));
+#ifdef __AVR__
+        uint8_t state = hal::irqSave();
+        char* top = __brkval ? __brkval : &__heap_start;
+        char* sp = (char*)SP;
+        out.heapSize = top - &__heap_start;
+        out.gap = (sp > top) ? sp - top : 0;
+
+        uint16_t largest = 0;
+        for (FreeBlock* block = __flp; block; block = block->next)
+        {
+            out.freeListBytes += block->size + sizeof(size_t);
+            if (block->size > largest) largest = block->size;
+            if (out.fragments < 0xFF) out.fragments++;
+        }
+        hal::irqRestore(state);
+
+        // malloc() расширяет кучу не ближе __malloc_margin к стеку
+        uint16_t margin = __malloc_margin + sizeof(size_t);
+        uint16_t fromGap = (out.gap > margin) ? out.gap - margin : 0;
+        out.largestFree = (fromGap > largest) ? fromGap : largest;
+        out.totalFree = out.freeListBytes + out.gap;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Фрагментация свободной памяти
+     * @return Процент свободной памяти, недоступной одним блоком
+     */
+    uint8_t fragmentation()
+    {
+        Stats s;
+        if (!stats(s) || s.totalFree == 0) return 0;
+        return 100 - (uint32_t)s.largestFree * 100 / s.totalFree;
+    }
+
+    /**
+     * @brief Память, занятая блоками с меткой (только с -DOS_HEAP_TAGS)
+     */
+    TagStats tagged(Tag tag)
+    {
+        TagStats result = {0, 0};
+        if (tag >= TAG_COUNT) return result;
+        uint8_t state = hal::irqSave();
+        result = tagStats[tag];
+        hal::irqRestore(state);
+        return result;
+    }
+
+    /**
+     * @brief Установка текущей метки выделений
+     * @param tag Новая метка
+     * @return Предыдущая метка
+     */
+    Tag setTag(Tag tag)
+    {
+        Tag prev = currentTag;
+        currentTag = tag;
+        return prev;
+    }
+
+    const char* tagName(Tag tag)
+    {
+        return (tag < TAG_COUNT) ? tagNames[tag] : "?";
+    }
+
+    /**
+     * @brief Заполнение класса пулов (только с -DOS_HEAP_POOLS)
+     * @param index Класс: 0 - 8 байт ... 3 - 64 байта
+     * @return false если класса нет или пулы выключены
+     */
+    bool poolStats(uint8_t index, PoolStats& out)
+    {
+#ifdef OS_HEAP_POOLS
+        uint8_t state = hal::irqSave();
+        bool ok = pools.stats(index, out);
+        hal::irqRestore(state);
+        return ok;
+#else
+        (void)index;
+        (void)out;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Запросы до 64 байт, обслуженные кучей из-за исчерпания пулов
+     */
+    uint16_t poolMisses()
+    {
+#ifdef OS_HEAP_POOLS
+        return pools.misses();
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * @brief Строка отчёта о куче (не длиннее 40 символов)
+     * @param index Номер строки: куча, дыры, метки, классы пулов, промахи
+     * @param out Поток вывода
+     * @return false если строки с таким номером нет
+     *
+     * Консоль выводит отчёт по строке за вызов, не переполняя свой буфер.
+     */
+    bool reportLine(uint8_t index, Print& out)
+    {
+        Stats s;
+        if (!stats(s)) return false;
+        if (index == 0)
+        {
+            out.print(F("Heap: size="));
+            out.print(s.heapSize);
+            out.print(F(" free="));
+            out.print(s.totalFree);
+            out.print(F(" largest="));
+            out.println(s.largestFree);
+            return true;
+        }
+        if (index == 1)
+        {
+            out.print(F("Holes: "));
+            out.print(s.freeListBytes);
+            out.print('/');
+            out.print(s.fragments);
+            out.print(F(" gap="));
+            out.println(s.gap);
+            return true;
+        }
+        index -= 2;
+#ifdef OS_HEAP_TAGS
+        if (index < TAG_COUNT)
+        {
+            TagStats t = tagged((Tag)index);
+            out.print(F("Tag "));
+            out.print(tagNames[index]);
+            out.print(F(": "));
+            out.print(t.bytes);
+            out.print('/');
+            out.println(t.blocks);
+            return true;
+        }
+        index -= TAG_COUNT;
+#endif
+#ifdef OS_HEAP_POOLS
+        PoolStats p;
+        if (poolStats(index, p))
+        {
+            out.print(F("Pool "));
+            out.print(p.blockSize);
+            out.print(F(": "));
+            out.print(p.used);
+            out.print('/');
+            out.print(p.blocks);
+            out.print(F(" peak "));
+            out.println(p.peak);
+            return true;
+        }
+        if (index == PoolSet::CLASSES)
+        {
+            out.print(F("Pool misses: "));
+            out.println(poolMisses());
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    /**
+     * @brief Вывод состояния кучи и памяти по меткам
+     * @param out Поток вывода
+     */
+    void report(Print& out)
+    {
+        for (uint8_t i = 0; reportLine(i, out); i++) {}
+    }
+}
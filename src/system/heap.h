@@ -0,0 +1,95 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "hal/hal.h"
+#include "kernel/config.h"
+#include "system/pool.h"
+
+/*
+ * Анализ кучи avr-libc: обход свободного списка __flp даёт объём дыр,
+ * их число и наибольший блок, который реально выделит malloc().
+ *
+ * Учёт выделений по подсистемам включается флагом -DOS_HEAP_TAGS вместе
+ * с флагами компоновщика -Wl,--wrap=malloc,--wrap=free,--wrap=realloc.
+ * Каждый блок получает байт метки перед данными; метка берётся из
+ * текущей области HEAP_TAG(), выделения через realloc() без области
+ * (буферы String) помечаются TAG_STRING. Без флага HEAP_TAG() не
+ * генерирует кода.
+ *
+ * Флаг -DOS_HEAP_POOLS с теми же флагами компоновщика направляет запросы
+ * malloc(), realloc() и operator new (ядро Arduino вызывает malloc()) до
+ * 64 байт в пулы классов 8/16/32/64 байта (system/pool.h); больше -
+ * в кучу avr-libc. realloc() блока пула в пределах его размера не
+ * перемещает данные. С -DOS_HEAP_POOLS_STRICT запрос, не обслуженный
+ * исчерпанными пулами, перезапускает систему с CrashLog::CAUSE_MEMORY.
+ */
+
+// Блоков в классах пулов 8/16/32/64 байта (-DOS_HEAP_POOL_BLOCKS=16,8,4,2):
+// 448 байт SRAM на Uno, 1216 на Mega
+#ifdef OS_TARGET_MEGA
+#define OS_DEFAULT_POOLS 24, 16, 12, 6
+#else
+#define OS_DEFAULT_POOLS 8, 8, 4, 2
+#endif
+#ifndef OS_HEAP_POOL_BLOCKS
+#define OS_HEAP_POOL_BLOCKS OS_DEFAULT_POOLS
+#endif
+
+namespace Heap
+{
+    enum Tag : uint8_t
+    {
+        TAG_OTHER,
+        TAG_FS,
+        TAG_LOGGER,
+        TAG_STRING,
+        TAG_COUNT
+    };
+
+    struct Stats
+    {
+        uint16_t totalFree;     // Дыры свободного списка + промежуток до стека
+        uint16_t largestFree;   // Наибольший блок, который выделит malloc()
+        uint16_t freeListBytes; // Байт в дырах свободного списка
+        uint16_t gap;           // Между вершиной кучи и стеком
+        uint16_t heapSize;      // Размер кучи от __heap_start
+        uint8_t fragments;      // Блоков в свободном списке
+    };
+
+    struct TagStats
+    {
+        uint16_t bytes;         // Включая заголовки блоков
+        uint16_t blocks;
+    };
+
+    bool stats(Stats& out);
+    uint8_t fragmentation();
+    TagStats tagged(Tag tag);
+    Tag setTag(Tag tag);
+    const char* tagName(Tag tag);
+    bool poolStats(uint8_t index, PoolStats& out);
+    uint16_t poolMisses();
+    bool reportLine(uint8_t index, Print& out);
+    void report(Print& out);
+
+    /**
+     * @brief Область, выделения в которой получают метку подсистемы
+     */
+    class TagScope
+    {
+    public:
+        explicit TagScope(Tag tag) : prev(setTag(tag)) {}
+        ~TagScope() { setTag(prev); }
+
+    private:
+        Tag prev;
+    };
+}
+
+#if defined(OS_HEAP_TAGS) && defined(__AVR__)
+#define HEAP_TAG(tag) Heap::TagScope _heap_tag(tag)
+#else
+#define HEAP_TAG(tag)
+#endif
+
+#endif
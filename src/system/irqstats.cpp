@@ -0,0 +1,171 @@
+#include "system/irqstats.h"
+
+namespace
+{
+    IrqStats::VectorStats stats[IrqStats::VEC_COUNT];
+    uint32_t maxLocked = 0;
+    uint32_t lockedAt = 0;
+
+    IrqStats::Vector systickVector()
+    {
+        return (sysTimer.getSource() == HwTimers::TIMER_2) ? IrqStats::VEC_TIMER2_COMPA : IrqStats::VEC_TIMER1_COMPA;
+    }
+
+    const char* const vectorNames[IrqStats::VEC_COUNT] =
+    {
+        "TIMER1_COMPA", "TIMER1_COMPB", "TIMER2_COMPA", "TIMER2_COMPB", "WDT", "INT0", "INT1", "PCINT0", "PCINT2", "TIMER1_CAPT", "ADC", "SPI_STC", "TWI"
+    };
+}
+
+namespace IrqStats
+{
+    /**
+     * @brief Фиксация входа в обработчик
+     * @param vec Вектор прерывания
+     * @param entry Значение счётчика системного таймера при входе
+     */
+    void enter(Vector vec, uint16_t entry)
+    {
+        stats[vec].count++;
+        // В режиме CTC счётчик обнуляется в момент совпадения, поэтому
+        // значение при входе - это задержка обработки прерывания тика
+        if (vec == systickVector() && entry > stats[vec].maxLatency)
+        {
+            stats[vec].maxLatency = entry;
+        }
+    }
+
+    /**
+     * @brief Фиксация выхода из обработчика
+     * @param vec Вектор прерывания
+     * @param entry Значение счётчика системного таймера при входе
+     */
+    void exit(Vector vec, uint16_t entry)
+    {
+        uint16_t now = sysTimer.ticks();
+        uint16_t duration = (now >= entry) ? now - entry : now + sysTimer.ticksPerMs() - entry;
+        if (duration > stats[vec].maxDuration)
+        {
+            stats[vec].maxDuration = duration;
+        }
+    }
+
+    /**
+     * @brief Начало окна с запрещёнными прерываниями
+     *
+     * Вызывается из hal::irqSave() уже после запрета; окна не вложены,
+     * поэтому достаточно одного времени начала.
+     */
+    void lockStart()
+    {
+        lockedAt = sysTimer.micros();
+    }
+
+    /**
+     * @brief Конец окна, вызывается из hal::irqRestore() до разрешения
+     *
+     * Окна длиннее 2 мс измеряются с занижением: тики таймера,
+     * пропущенные при запрещённых прерываниях, не восстанавливаются.
+     */
+    void lockEnd()
+    {
+        uint32_t duration = sysTimer.micros() - lockedAt;
+        if (duration > maxLocked)
+        {
+            maxLocked = duration;
+        }
+    }
+
+    /**
+     * @brief Согласованная копия статистики вектора
+     */
+    VectorStats get(Vector vec)
+    {
+        hal::irqDisable();
+        VectorStats copy = stats[vec];
+        hal::irqEnable();
+        return copy;
+    }
+
+    /**
+     * @brief Наибольшее окно с запрещёнными прерываниями
+     * @return Длительность (мкс)
+     */
+    uint32_t maxLockedMicros()
+    {
+        hal::irqDisable();
+        uint32_t value = maxLocked;
+        hal::irqEnable();
+        return value;
+    }
+
+    /**
+     * @brief Перевод тактов системного таймера в микросекунды
+     */
+    uint32_t ticksToMicros(uint16_t ticks)
+    {
+        return sysTimer.ticksToMicros(ticks);
+    }
+
+    /**
+     * @brief Худшая задержка входа в обработчик
+     * @param vec Вектор прерывания
+     * @return Измеренная задержка (для вектора тика) или оценка сверху:
+     *         наибольшее окно запрета плюс самый длинный чужой обработчик
+     */
+    uint32_t worstLatencyMicros(Vector vec)
+    {
+        VectorStats own = get(vec);
+        if (vec == systickVector() && own.count > 0)
+        {
+            return ticksToMicros(own.maxLatency);
+        }
+
+        uint16_t longestOther = 0;
+        for (uint8_t i = 0; i < VEC_COUNT; i++)
+        {
+            if (i == vec) continue;
+            VectorStats other = get((Vector)i);
+            if (other.maxDuration > longestOther)
+            {
+                longestOther = other.maxDuration;
+            }
+        }
+        return maxLockedMicros() + ticksToMicros(longestOther);
+    }
+
+    /**
+     * @brief Сброс статистики
+     */
+    void reset()
+    {
+        hal::irqDisable();
+        memset(stats, 0, sizeof(stats));
+        maxLocked = 0;
+        hal::irqEnable();
+    }
+
+    /**
+     * @brief Вывод статистики прерываний
+     * @param out Поток вывода
+     */
+    void report(Print& out)
+    {
+        out.println(F("IRQ: vector count dur_us lat_us"));
+        for (uint8_t i = 0; i < VEC_COUNT; i++)
+        {
+            VectorStats s = get((Vector)i);
+            out.print(F("  "));
+            out.print(vectorNames[i]);
+            out.print(' ');
+            out.print(s.count);
+            out.print(' ');
+            out.print(ticksToMicros(s.maxDuration));
+            out.print(' ');
+            out.println(worstLatencyMicros((Vector)i));
+        }
+        out.print(F("  cli max: "));
+        out.print(maxLockedMicros());
+        out.println(F(" us"));
+    }
+}
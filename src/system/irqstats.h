@@ -0,0 +1,69 @@
+#ifndef IRQSTATS_H
+#define IRQSTATS_H
+
+#include "hal/hal.h"
+#include "driver/timer.h"
+#include "system/trace.h"
+
+/*
+ * Инструментирование прерываний. Включается флагом сборки -DOS_IRQ_STATS,
+ * без него макросы ниже не генерируют кода.
+ *
+ * IRQ_ENTER/IRQ_EXIT ставятся в начало и конец обработчика и измеряют
+ * длительность по счётчику системного таймера (TCNT1 или TCNT2).
+ * Окно с запрещёнными прерываниями измеряется в hal::irqSave/irqRestore
+ * (внешняя пара); IRQ_LOCK/IRQ_UNLOCK - та же пара для блоков, которые
+ * раньше запрещали прерывания noInterrupts()/interrupts().
+ */
+namespace IrqStats
+{
+    enum Vector : uint8_t
+    {
+        VEC_TIMER1_COMPA,
+        VEC_TIMER1_COMPB,
+        VEC_TIMER2_COMPA,
+        VEC_TIMER2_COMPB,
+        VEC_WDT,
+        VEC_INT0,
+        VEC_INT1,
+        VEC_PCINT0,
+        VEC_PCINT2,
+        VEC_TIMER1_CAPT,
+        VEC_ADC,
+        VEC_SPI_STC,
+        VEC_TWI,
+        VEC_COUNT
+    };
+
+    struct VectorStats
+    {
+        uint32_t count;         // Количество вызовов
+        uint16_t maxDuration;   // Наибольшая длительность (такты системного таймера)
+        uint16_t maxLatency;    // Наибольшая задержка входа (такты системного таймера), 0 если не измеряется
+    };
+
+    void enter(Vector vec, uint16_t entry);
+    void exit(Vector vec, uint16_t entry);
+    void lockStart();
+    void lockEnd();
+
+    VectorStats get(Vector vec);
+    uint32_t maxLockedMicros();
+    uint32_t worstLatencyMicros(Vector vec);
+    uint32_t ticksToMicros(uint16_t ticks);
+    void reset();
+    void report(Print& out);
+}
+
+#ifdef OS_IRQ_STATS
+#define IRQ_ENTER(vec) uint16_t _irq_entry = sysTimer.ticks(); IrqStats::enter(vec, _irq_entry); TRACE_IRQ_ENTER(vec)
+#define IRQ_EXIT(vec) TRACE_IRQ_EXIT(vec); IrqStats::exit(vec, _irq_entry)
+#else
+#define IRQ_ENTER(vec) TRACE_IRQ_ENTER(vec)
+#define IRQ_EXIT(vec) TRACE_IRQ_EXIT(vec)
+#endif
+
+#define IRQ_LOCK() uint8_t _irq_state = hal::irqSave()
+#define IRQ_UNLOCK() hal::irqRestore(_irq_state)
+
+#endif
@@ -1,4 +1,5 @@
 #include "system/monitor.h"
+#include "driver/adc.h"
 #include <Arduino.h>
 
 #ifdef __AVR__
@@ -19,30 +20,35 @@ int SystemMonitor::freeMemory()
     return free_memory;
 }
 
-int SystemMonitor::freeMemoryPercent() 
+Fixed::Percent SystemMonitor::freeMemoryPercent() 
 {
     int free_mem = freeMemory();
-    return (free_mem > 0) ? (free_mem * 100) / TOTAL_MEMORY : 0;
+    return (free_mem > 0) ? Fixed::percent(free_mem, TOTAL_MEMORY) : Fixed::Percent();
 }
 
 bool SystemMonitor::isMemoryCritical() 
 {
-    return freeMemoryPercent() < 0.1;
+    return freeMemoryPercent() < CRITICAL_MEMORY;
 }
 
-float SystemMonitor::getVccVoltage() 
+void SystemMonitor::begin() 
 {
-    ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
-    delay(2);
-    ADCSRA |= _BV(ADSC);
-    while (bit_is_set(ADCSRA, ADSC));
-    uint8_t low = ADCL;
-    unsigned int val = (ADCH << 8) | low;
-    return (val * 1.1f) / 1024.0f;
+    sysAdc.addChannel(Adc::CHANNEL_BANDGAP, 3, 4);
+}
+
+uint16_t SystemMonitor::getVccMillivolts() 
+{
+    return sysAdc.vccMillivolts();
+}
+
+Fixed::Volts SystemMonitor::getVccVoltage() 
+{
+    return Fixed::Millivolts(getVccMillivolts()).volts();
 }
 
 bool SystemMonitor::isLowVoltage() 
 {
-    return getVccVoltage() < LOW_VOLTAGE_THRESHOLD;
+    uint16_t mv = getVccMillivolts();
+    return mv != 0 && mv < LOW_VOLTAGE_MV;
 }
 #endif
\ No newline at end of file
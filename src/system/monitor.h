@@ -3,17 +3,23 @@
 
 #ifdef __AVR__
 #include <Arduino.h>
+#include "system/fixed.h"
 
 namespace SystemMonitor 
 {
+    void begin();
     int freeMemory();
-    int freeMemoryPercent();
+    Fixed::Percent freeMemoryPercent();
     bool isMemoryCritical();
-    float getVccVoltage();
+    uint16_t getVccMillivolts();
+    Fixed::Volts getVccVoltage();
     bool isLowVoltage();
     
-    constexpr int TOTAL_MEMORY = 2048;
-    constexpr float LOW_VOLTAGE_THRESHOLD = 3.3f;
+    // Объём SRAM цели: 2048 на ATmega328P, 8192 на ATmega2560
+    constexpr int TOTAL_MEMORY = RAMEND - RAMSTART + 1;
+    constexpr uint16_t LOW_VOLTAGE_MV = 3300;
+    // Порог isMemoryCritical: свободно меньше 10 % SRAM
+    constexpr Fixed::Percent CRITICAL_MEMORY = Fixed::Percent::fromInt(10);
 }
 
 #endif
@@ -0,0 +1,157 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "hal/hal.h"
+
+/*
+ * Пулы блоков фиксированного размера. Выделение и освобождение - снятие
+ * и возврат блока в односвязный список свободных за O(1), блоки одного
+ * размера не дробят память.
+ *
+ * Объекты пулов размещаются только в статической памяти: они не имеют
+ * конструктора и готовы к работе после обнуления .bss, то есть до
+ * конструкторов глобальных объектов, которые уже могут вызывать malloc().
+ * Список свободных строится при первом выделении. Пулы не защищены от
+ * прерываний, как и malloc() avr-libc.
+ */
+namespace Heap
+{
+    struct PoolStats
+    {
+        uint8_t blockSize;
+        uint8_t blocks;
+        uint8_t used;
+        uint8_t peak;           // Наибольшее число занятых блоков
+    };
+
+    /**
+     * @brief COUNT блоков по SIZE байт
+     */
+    template <uint8_t SIZE, uint8_t COUNT>
+    class BlockPool
+    {
+    public:
+        static_assert(SIZE >= sizeof(void*), "block must hold a free-list link");
+        static_assert(COUNT > 0, "pool must have blocks");
+
+        void* alloc()
+        {
+            if (!_ready) init();
+            Node* node = _free;
+            if (!node) return nullptr;
+            _free = node->next;
+            if (++_used > _peak) _peak = _used;
+            return node;
+        }
+
+        void free(void* ptr)
+        {
+            Node* node = (Node*)ptr;
+            node->next = _free;
+            _free = node;
+            _used--;
+        }
+
+        bool owns(const void* ptr) const
+        {
+            return (const uint8_t*)ptr >= _blocks && (const uint8_t*)ptr < _blocks + sizeof(_blocks);
+        }
+
+        PoolStats stats() const { return {SIZE, COUNT, _used, _peak}; }
+
+    private:
+        struct Node
+        {
+            Node* next;
+        };
+
+        // Без инициализаторов: объект обнуляется вместе с .bss
+        alignas(Node) uint8_t _blocks[SIZE * COUNT];
+        Node* _free;
+        bool _ready;
+        uint8_t _used;
+        uint8_t _peak;
+
+        void init()
+        {
+            for (uint8_t i = COUNT; i > 0; i--)
+            {
+                Node* node = (Node*)(_blocks + (i - 1) * SIZE);
+                node->next = _free;
+                _free = node;
+            }
+            _ready = true;
+        }
+    };
+
+    /**
+     * @brief Пулы классов 8, 16, 32 и 64 байта
+     *
+     * Запрос получает блок наименьшего подходящего класса; если класс
+     * исчерпан - следующего. Запрос больше MAX_SIZE или при исчерпании
+     * всех подходящих классов возвращает nullptr (обслуживается кучей);
+     * второй случай учитывается в misses().
+     */
+    template <uint8_t N8, uint8_t N16, uint8_t N32, uint8_t N64>
+    class SizeClassPools
+    {
+    public:
+        static const uint8_t CLASSES = 4;
+        static const uint8_t MAX_SIZE = 64;
+
+        void* alloc(size_t size)
+        {
+            void* ptr = nullptr;
+            if (size <= 8) ptr = _pool8.alloc();
+            if (!ptr && size <= 16) ptr = _pool16.alloc();
+            if (!ptr && size <= 32) ptr = _pool32.alloc();
+            if (!ptr && size <= MAX_SIZE) ptr = _pool64.alloc();
+            if (!ptr && size <= MAX_SIZE && _misses < 0xFFFF) _misses++;
+            return ptr;
+        }
+
+        /**
+         * @brief Возврат блока
+         * @return false если блок не из пулов
+         */
+        bool free(void* ptr)
+        {
+            if (_pool8.owns(ptr)) _pool8.free(ptr);
+            else if (_pool16.owns(ptr)) _pool16.free(ptr);
+            else if (_pool32.owns(ptr)) _pool32.free(ptr);
+            else if (_pool64.owns(ptr)) _pool64.free(ptr);
+            else return false;
+            return true;
+        }
+
+        // Размер блока пулов или 0, если блок из кучи
+        uint8_t blockSize(const void* ptr) const
+        {
+            return _pool8.owns(ptr) ? 8 : _pool16.owns(ptr) ? 16 :
+                   _pool32.owns(ptr) ? 32 : _pool64.owns(ptr) ? 64 : 0;
+        }
+
+        bool stats(uint8_t index, PoolStats& out) const
+        {
+            switch (index)
+            {
+                case 0: out = _pool8.stats(); return true;
+                case 1: out = _pool16.stats(); return true;
+                case 2: out = _pool32.stats(); return true;
+                case 3: out = _pool64.stats(); return true;
+                default: return false;
+            }
+        }
+
+        uint16_t misses() const { return _misses; }
+
+    private:
+        BlockPool<8, N8> _pool8;
+        BlockPool<16, N16> _pool16;
+        BlockPool<32, N32> _pool32;
+        BlockPool<64, N64> _pool64;
+        uint16_t _misses;
+    };
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef SHARED_H
+#define SHARED_H
+
+#include "hal/hal.h"
+
+/*
+ * Обмен данными между задачами и обработчиками прерываний без длинных
+ * критических секций. На 8-битном AVR чтение и запись многобайтового
+ * значения не атомарны: прерывание между байтами даёт смесь старого и
+ * нового значения.
+ *
+ * SeqLock   - писатель ISR (или задача), читатель задача: чтение
+ *             повторяется, если за время копирования была запись.
+ *             Так же устроены Timer::millis() и Adc.
+ * DoubleBuffer - писатель задача, читатель ISR: запись идёт в неактивный
+ *             буфер, переключение - запись одного байта.
+ * Atomic    - счётчики и флаги: операции над многобайтовым значением
+ *             выполняются с запретом прерываний на несколько тактов с
+ *             восстановлением прежнего состояния (допустимо в ISR).
+ *
+ * У каждого объекта SeqLock и DoubleBuffer один писатель.
+ */
+
+// Запрет компилятору переносить обращения к памяти через эту точку
+#define SHARED_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+namespace Shared
+{
+    /**
+     * @brief Значение, публикуемое одним писателем, с согласованным чтением
+     *
+     * Номер версии нечётный во время записи. Читатель копирует значение и
+     * принимает копию, если номер чётный и не изменился. Читатель в ISR
+     * не может дождаться писателя-задачу: для такого направления
+     * использовать tryRead() или DoubleBuffer.
+     */
+    template <typename T>
+    class SeqLock
+    {
+    public:
+        void write(const T& value)
+        {
+            _seq = _seq + 1;
+            SHARED_BARRIER();
+            _value = value;
+            SHARED_BARRIER();
+            _seq = _seq + 1;
+        }
+
+        /**
+         * @brief Одна попытка чтения
+         * @return false если запись шла во время чтения
+         */
+        bool tryRead(T& value) const
+        {
+            uint8_t seq = _seq;
+            SHARED_BARRIER();
+            if (seq & 1) return false;
+            value = _value;
+            SHARED_BARRIER();
+            return seq == _seq;
+        }
+
+        T read() const
+        {
+            T value;
+            while (!tryRead(value)) {}
+            return value;
+        }
+
+        uint8_t version() const { return _seq; }
+
+    private:
+        T _value = T();
+        volatile uint8_t _seq = 0;
+    };
+
+    /**
+     * @brief Два экземпляра значения: активный для читателя, второй для писателя
+     *
+     * Читатель не должен прерываться писателем (ISR или задача того же
+     * кооперативного планировщика). Запись не меняет активный буфер до
+     * переключения индекса.
+     */
+    template <typename T>
+    class DoubleBuffer
+    {
+    public:
+        void write(const T& value)
+        {
+            uint8_t back = _front ^ 1;
+            _buffers[back] = value;
+            SHARED_BARRIER();
+            _front = back;
+        }
+
+        T read() const
+        {
+            return _buffers[_front];
+        }
+
+        const T& front() const
+        {
+            return _buffers[_front];
+        }
+
+    private:
+        T _buffers[2] = {T(), T()};
+        volatile uint8_t _front = 0;
+    };
+
+    /**
+     * @brief Целое значение с атомарными операциями
+     *
+     * Однобайтовые load/store выполняются одной инструкцией, остальное -
+     * с сохранением SREG и запретом прерываний на время операции.
+     */
+    template <typename T>
+    class Atomic
+    {
+        static_assert(sizeof(T) <= 4, "Atomic supports up to 32-bit values");
+
+    public:
+        Atomic(T value = T()) : _value(value) {}
+
+        T load() const
+        {
+            if (sizeof(T) == 1) return _value;
+            uint8_t state = hal::irqSave();
+            T value = _value;
+            hal::irqRestore(state);
+            return value;
+        }
+
+        void store(T value)
+        {
+            if (sizeof(T) == 1)
+            {
+                _value = value;
+                return;
+            }
+            uint8_t state = hal::irqSave();
+            _value = value;
+            hal::irqRestore(state);
+        }
+
+        /**
+         * @brief Прибавление
+         * @return Значение до операции
+         */
+        T fetchAdd(T delta)
+        {
+            uint8_t state = hal::irqSave();
+            T old = _value;
+            _value = old + delta;
+            hal::irqRestore(state);
+            return old;
+        }
+
+        T exchange(T value)
+        {
+            uint8_t state = hal::irqSave();
+            T old = _value;
+            _value = value;
+            hal::irqRestore(state);
+            return old;
+        }
+
+        /**
+         * @brief Замена значения, если оно равно ожидаемому
+         * @param expected Ожидаемое значение; при неудаче - текущее
+         * @return true если значение заменено
+         */
+        bool compareExchange(T& expected, T desired)
+        {
+            uint8_t state = hal::irqSave();
+            T current = _value;
+            bool equal = current == expected;
+            if (equal) _value = desired;
+            hal::irqRestore(state);
+            expected = current;
+            return equal;
+        }
+
+        operator T() const { return load(); }
+
+    private:
+        volatile T _value;
+    };
+}
+
+#endif
@@ -0,0 +1,469 @@
+#include "system/shell.h"
+#include "system/heap.h"
+#include "system/trace.h"
+#include "system/boot.h"
+#include "kernel/scheduler.h"
+#include "fs/fs.h"
+#include "fs/logger.h"
+#ifdef __AVR__
+#include "system/monitor.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    const uint16_t TX_SIZE = OS_SHELL_TX_SIZE;
+    static_assert((TX_SIZE & (TX_SIZE - 1)) == 0, "OS_SHELL_TX_SIZE must be a power of two");
+
+    const uint8_t LINE_SIZE = 40;
+    const uint8_t MAX_ARGS = 5;
+    // Свободное место в буфере вывода для очередной строки задания
+    const uint8_t LINE_SPACE = 64;
+
+    /**
+     * @brief Буфер вывода, из которого UART получает данные без ожидания
+     */
+    class Writer : public Print
+    {
+    public:
+        size_t write(uint8_t c) override
+        {
+            uint16_t next = (head + 1) & (TX_SIZE - 1);
+            if (next == tail)
+            {
+                lost++;
+                return 0;
+            }
+            buffer[head] = c;
+            head = next;
+            return 1;
+        }
+        using Print::write;
+
+        uint16_t space() const
+        {
+            return (tail - head - 1) & (TX_SIZE - 1);
+        }
+
+        /**
+         * @brief Передача в UART того, что помещается без ожидания
+         */
+        void drain()
+        {
+            int room = Serial.availableForWrite();
+            while (room-- > 0 && tail != head)
+            {
+                Serial.write(buffer[tail]);
+                tail = (tail + 1) & (TX_SIZE - 1);
+            }
+        }
+
+        uint16_t lost = 0;
+
+    private:
+        uint8_t buffer[TX_SIZE];
+        uint16_t head = 0;
+        uint16_t tail = 0;
+    };
+
+    enum Job : uint8_t
+    {
+        JOB_NONE,
+        JOB_PS,
+        JOB_LS,
+        JOB_CAT,
+        JOB_LOG,
+        JOB_MEM
+    };
+
+    Writer writer;
+    char line[LINE_SIZE];
+    uint8_t lineLength = 0;
+    char lastChar = 0;
+    bool started = false;
+
+    Job job = JOB_NONE;
+    uint8_t jobIndex = 0;
+    uint16_t jobOffset = 0;
+    char catName[FileSystem::MAX_FILENAME_LEN + 1];
+    bool catRom = false;
+
+    void prompt()
+    {
+        writer.print(F("> "));
+    }
+
+    int findFile(const char* name)
+    {
+        for (int i = 0; i < fs.getFileCount(); i++)
+        {
+            if (strcmp(fs.getFile(i)->name.c_str(), name) == 0) return i;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Есть ли в RAM файл, переопределяющий файл во flash
+     */
+    bool overridden(const char* romName)
+    {
+        for (int i = 0; i < fs.getFileCount(); i++)
+        {
+            if (strcmp_P(fs.getFile(i)->name.c_str(), romName) == 0) return true;
+        }
+        return false;
+    }
+
+    void printTask(uint8_t index, const TaskInfo& info)
+    {
+        writer.print(index);
+        if (!info.enabled) writer.print('-');
+        writer.print('\t');
+        writer.print(info.priority);
+        writer.print('\t');
+        writer.print(info.activePeriod);
+        writer.print('\t');
+        writer.print(info.runCount);
+        writer.print('\t');
+        writer.print(info.maxRunTime);
+        writer.print('\t');
+        writer.print(info.overruns);
+        writer.print('\t');
+        writer.print(info.load / 10);
+        writer.print('.');
+        writer.print(info.load % 10);
+        writer.println('%');
+    }
+
+    /**
+     * @brief Очередной шаг вывода cat
+     * @return false по окончании файла
+     */
+    bool catStep()
+    {
+        const uint8_t* data;
+        uint16_t size;
+        bool binary;
+        if (catRom)
+        {
+            // Таблица во flash не меняется во время работы
+            FileSystem::RomFile rom;
+            fs.getRomFile(jobIndex, rom);
+            data = rom.data;
+            size = rom.size;
+            binary = rom.isBinary;
+        }
+        else
+        {
+            const FileSystem::File* file = (jobIndex < fs.getFileCount()) ? fs.getFile(jobIndex) : nullptr;
+            if (!file || strcmp(file->name.c_str(), catName) != 0)
+            {
+                writer.println(F("cat: file changed"));
+                return false;
+            }
+            data = file->data;
+            // Текстовый файл хранится с завершающим нулём
+            size = file->isBinary ? file->size : file->size - 1;
+            binary = file->isBinary;
+        }
+
+        if (jobOffset >= size)
+        {
+            writer.println();
+            return false;
+        }
+
+        uint16_t count = size - jobOffset;
+        uint16_t limit = binary ? 16 : LINE_SPACE;
+        if (count > limit) count = limit;
+
+        uint8_t romChunk[LINE_SPACE];
+        const uint8_t* bytes = data + jobOffset;
+        if (catRom)
+        {
+            memcpy_P(romChunk, bytes, count);
+            bytes = romChunk;
+        }
+        jobOffset += count;
+
+        if (binary)
+        {
+            for (uint8_t i = 0; i < count; i++)
+            {
+                if (bytes[i] < 0x10) writer.print('0');
+                writer.print(bytes[i], HEX);
+                writer.print(' ');
+            }
+            writer.println();
+        }
+        else
+        {
+            writer.write(bytes, count);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Очередная строка ls: файлы RAM, затем непереопределённые файлы flash
+     * @return false по окончании списка
+     */
+    bool lsStep()
+    {
+        const FileSystem::File* file = fs.getFile(jobIndex);
+        if (file)
+        {
+            jobIndex++;
+            writer.print(file->name);
+            writer.print('\t');
+            writer.print(file->isBinary ? F("bin\t") : F("txt\t"));
+            writer.println((unsigned)file->size);
+            return true;
+        }
+
+        FileSystem::RomFile rom;
+        while (jobIndex >= fs.getFileCount() && fs.getRomFile(jobIndex - fs.getFileCount(), rom))
+        {
+            jobIndex++;
+            if (overridden(rom.name)) continue;
+            writer.print(reinterpret_cast<const __FlashStringHelper*>(rom.name));
+            writer.print('\t');
+            writer.print(rom.isBinary ? F("rom bin\t") : F("rom txt\t"));
+            writer.println(rom.size);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Очередная строка mem: свободная память, затем отчёт кучи
+     * @return false по окончании отчёта
+     */
+    bool memStep()
+    {
+#ifdef __AVR__
+        if (jobIndex == 0)
+        {
+            jobIndex++;
+            writer.print(F("free "));
+            writer.print(SystemMonitor::freeMemory());
+            writer.println(F(" B"));
+            return true;
+        }
+        return Heap::reportLine(jobIndex++ - 1, writer);
+#else
+        return Heap::reportLine(jobIndex++, writer);
+#endif
+    }
+
+    /**
+     * @brief Одна строка вывода текущего задания
+     */
+    void stepJob()
+    {
+        bool more = false;
+        if (job == JOB_PS)
+        {
+            TaskInfo info;
+            more = kernel.getTaskInfo(jobIndex, info);
+            if (more) printTask(jobIndex++, info);
+        }
+        else if (job == JOB_LS)
+        {
+            more = lsStep();
+        }
+        else if (job == JOB_CAT)
+        {
+            more = catStep();
+        }
+        else if (job == JOB_LOG)
+        {
+            more = logger.printRecord(jobIndex++, writer);
+        }
+        else if (job == JOB_MEM)
+        {
+            more = memStep();
+        }
+
+        if (!more)
+        {
+            job = JOB_NONE;
+            prompt();
+        }
+    }
+
+    void startJob(Job next, uint8_t index)
+    {
+        job = next;
+        jobIndex = index;
+        jobOffset = 0;
+    }
+
+    void commandTrace(uint8_t argc, char** argv)
+    {
+#ifdef OS_TRACE
+        if (argc > 1) Trace::setMask(strtoul(argv[1], nullptr, 16));
+        writer.print(F("trace mask 0x"));
+        writer.println(Trace::getMask(), HEX);
+#else
+        (void)argc;
+        (void)argv;
+        writer.println(F("trace: build with -DOS_TRACE"));
+#endif
+    }
+
+    void commandSet(uint8_t argc, char** argv)
+    {
+        if (argc == 4 && strcmp_P(argv[1], PSTR("period")) == 0)
+        {
+            TaskFunction task = kernel.getTaskFunction(atoi(argv[2]));
+            if (task && kernel.setPeriod(task, strtoul(argv[3], nullptr, 10)))
+            {
+                writer.println(F("ok"));
+                return;
+            }
+        }
+        writer.println(F("usage: set period <task> <ms>"));
+    }
+
+    /**
+     * @brief Разбор строки на аргументы и выполнение команды
+     */
+    void execute(char* text)
+    {
+        char* argv[MAX_ARGS];
+        uint8_t argc = 0;
+        char* p = text;
+        while (*p && argc < MAX_ARGS)
+        {
+            while (*p == ' ') *p++ = 0;
+            if (!*p) break;
+            argv[argc++] = p;
+            while (*p && *p != ' ') p++;
+        }
+        if (argc == 0) return;
+
+        const char* cmd = argv[0];
+        if (strcmp_P(cmd, PSTR("ps")) == 0)
+        {
+            writer.println(F("#\tpri\tperiod\truns\tmax\tovr\tload"));
+            startJob(JOB_PS, 0);
+        }
+        else if (strcmp_P(cmd, PSTR("ls")) == 0)
+        {
+            startJob(JOB_LS, 0);
+        }
+        else if (strcmp_P(cmd, PSTR("cat")) == 0 && argc == 2)
+        {
+            int index = findFile(argv[1]);
+            catRom = index < 0;
+            if (catRom) index = fs.findRomIndex(argv[1]);
+            if (index < 0)
+            {
+                writer.println(F("cat: no such file"));
+                return;
+            }
+            strncpy(catName, argv[1], sizeof(catName) - 1);
+            catName[sizeof(catName) - 1] = 0;
+            startJob(JOB_CAT, index);
+        }
+        else if (strcmp_P(cmd, PSTR("rm")) == 0 && argc == 2)
+        {
+            writer.println(fs.deleteFile(argv[1]) ? F("ok") : F("rm: failed"));
+        }
+        else if (strcmp_P(cmd, PSTR("set")) == 0)
+        {
+            commandSet(argc, argv);
+        }
+        else if (strcmp_P(cmd, PSTR("mem")) == 0)
+        {
+            startJob(JOB_MEM, 0);
+        }
+        else if (strcmp_P(cmd, PSTR("trace")) == 0)
+        {
+            commandTrace(argc, argv);
+        }
+        else if (strcmp_P(cmd, PSTR("log")) == 0)
+        {
+            startJob(JOB_LOG, 0);
+        }
+        else if (strcmp_P(cmd, PSTR("boot")) == 0)
+        {
+            Boot::report(writer);
+        }
+        else
+        {
+            // help и неизвестная команда - список команд
+            writer.println(F("help ps ls cat rm set mem trace log boot"));
+        }
+    }
+}
+
+namespace Shell
+{
+    /**
+     * @brief Задача консоли: один символ ввода или одна строка вывода
+     */
+    void poll()
+    {
+        writer.drain();
+        if (!started)
+        {
+            started = true;
+            writer.println();
+            prompt();
+            return;
+        }
+
+        if (job != JOB_NONE)
+        {
+            if (writer.space() >= LINE_SPACE) stepJob();
+            return;
+        }
+
+        if (Serial.available() <= 0) return;
+        char c = Serial.read();
+        char previous = lastChar;
+        lastChar = c;
+
+        if (c == '\r' || c == '\n')
+        {
+            // CR LF от терминала - один перевод строки
+            if (c == '\n' && previous == '\r') return;
+            writer.println();
+            line[lineLength] = 0;
+            lineLength = 0;
+            execute(line);
+            if (job == JOB_NONE) prompt();
+        }
+        else if (c == 0x08 || c == 0x7F)
+        {
+            if (lineLength > 0)
+            {
+                lineLength--;
+                writer.print(F("\b \b"));
+            }
+        }
+        else if (c >= ' ' && lineLength < LINE_SIZE - 1)
+        {
+            line[lineLength++] = c;
+            writer.print(c);
+        }
+    }
+
+    /**
+     * @brief Вывод через буфер консоли (для команд приложения)
+     */
+    Print& out()
+    {
+        return writer;
+    }
+
+    /**
+     * @brief Байт вывода, потерянных при заполненном буфере
+     */
+    uint16_t dropped()
+    {
+        return writer.lost;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+#include "hal/hal.h"
+
+#ifndef OS_SHELL_TX_SIZE
+#define OS_SHELL_TX_SIZE 128
+#endif
+
+/*
+ * Консоль для просмотра и настройки системы во время работы. Включается
+ * в main.cpp флагом -DOS_SHELL (задача Shell::poll).
+ *
+ * Ввод берётся из кольцевого буфера приёма Serial, который заполняется
+ * прерыванием USART_RX: за один вызов poll() обрабатывается не больше
+ * одного символа. Вывод идёт через кольцевой буфер OS_SHELL_TX_SIZE
+ * байт, из которого за вызов в UART переписывается только то, что
+ * помещается в буфер передачи без ожидания. Длинный вывод (ps, ls, cat,
+ * mem, log) выдаётся по строке за вызов, когда в буфере есть место.
+ *
+ * Команды: help, ps, ls, cat <файл>, rm <файл>,
+ * set period <задача> <мс>, mem, trace [маска], log, boot.
+ */
+namespace Shell
+{
+    void poll();
+    Print& out();
+    uint16_t dropped();
+}
+
+#endif
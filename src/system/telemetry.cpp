@@ -0,0 +1,202 @@
+#include "system/telemetry.h"
+#include "system/crc.h"
+#include "system/heap.h"
+#include "kernel/scheduler.h"
+#include "driver/timer.h"
+#include "fs/fs.h"
+#ifdef __AVR__
+#include "system/monitor.h"
+#endif
+#include <string.h>
+
+namespace
+{
+    // type + seq + тело + crc
+    const uint8_t MAX_RAW = Telemetry::MAX_BODY + 4;
+    // Байт COBS и разделитель
+    const uint8_t MAX_FRAME = MAX_RAW + 2;
+
+    uint8_t seq = 0;
+    uint16_t sentCount = 0;
+    uint16_t droppedCount = 0;
+
+    /**
+     * @brief Кодирование COBS (кадр короче 254 байт, блоков 0xFF не бывает)
+     * @return Длина закодированных данных без разделителя
+     */
+    uint8_t cobsEncode(const uint8_t* in, uint8_t size, uint8_t* out)
+    {
+        uint8_t codePos = 0;
+        uint8_t code = 1;
+        uint8_t o = 1;
+        for (uint8_t i = 0; i < size; i++)
+        {
+            if (in[i] == 0)
+            {
+                out[codePos] = code;
+                codePos = o++;
+                code = 1;
+            }
+            else
+            {
+                out[o++] = in[i];
+                code++;
+            }
+        }
+        out[codePos] = code;
+        return o;
+    }
+}
+
+namespace Telemetry
+{
+    /**
+     * @brief Запуск Serial на скорости телеметрии
+     * @param baud Скорость, бод
+     */
+    void begin(unsigned long baud)
+    {
+        Serial.begin(baud);
+    }
+
+    /**
+     * @brief Отправка записи без ожидания линии
+     * @param type Тип записи
+     * @param body Тело
+     * @param size Размер тела (не больше MAX_BODY)
+     * @return false если кадр не поместился в буфер передачи и отброшен
+     */
+    bool send(Record type, const void* body, uint8_t size)
+    {
+        if (size > MAX_BODY) size = MAX_BODY;
+
+        uint8_t raw[MAX_RAW];
+        raw[0] = type;
+        raw[1] = seq++;
+        memcpy(raw + 2, body, size);
+        uint16_t crc = Crc::crc16(raw, size + 2);
+        raw[size + 2] = crc & 0xFF;
+        raw[size + 3] = crc >> 8;
+
+        uint8_t frame[MAX_FRAME];
+        uint8_t length = cobsEncode(raw, size + 4, frame);
+        frame[length++] = 0;
+
+        if (Serial.availableForWrite() < length)
+        {
+            droppedCount++;
+            return false;
+        }
+        Serial.write(frame, length);
+        sentCount++;
+        return true;
+    }
+
+    /**
+     * @brief Статистика задачи
+     * @param index Индекс задачи
+     */
+    bool sendTask(uint8_t index)
+    {
+        TaskInfo info;
+        if (!kernel.getTaskInfo(index, info)) return false;
+
+        TaskBody body;
+        body.index = index;
+        body.enabled = info.enabled;
+        body.period = info.activePeriod;
+        body.runCount = info.runCount;
+        body.lastRunTime = info.lastRunTime;
+        body.maxRunTime = info.maxRunTime;
+        body.maxJitter = info.maxJitter;
+        body.overruns = info.overruns;
+        body.misses = info.misses;
+        body.load = info.load;
+        return send(REC_TASK, &body, sizeof(body));
+    }
+
+    /**
+     * @brief Время работы, загрузка, число задач и файлов, Vcc
+     */
+    bool sendSystem()
+    {
+        SystemBody body;
+        body.uptime = sysTimer.millis();
+        body.idle = kernel.getIdleTime();
+        body.load = kernel.getSystemLoad();
+        body.taskCount = kernel.getTaskCount();
+        body.fileCount = fs.getFileCount();
+#ifdef __AVR__
+        body.vcc = SystemMonitor::getVccMillivolts();
+#else
+        body.vcc = 0;
+#endif
+        body.dropped = droppedCount;
+        return send(REC_SYSTEM, &body, sizeof(body));
+    }
+
+    /**
+     * @brief Свободная память и фрагментация кучи
+     */
+    bool sendMemory()
+    {
+        MemoryBody body;
+        Heap::Stats heap;
+        Heap::stats(heap);
+#ifdef __AVR__
+        body.freeMemory = SystemMonitor::freeMemory();
+#else
+        body.freeMemory = 0;
+#endif
+        body.heapFree = heap.totalFree;
+        body.largestFree = heap.largestFree;
+        body.fragments = heap.fragments;
+        return send(REC_MEMORY, &body, sizeof(body));
+    }
+
+    /**
+     * @brief Сообщение лога
+     * @param level Уровень (Trace::LogLevel)
+     * @param text Текст, обрезается до MAX_BODY - 1 символов
+     */
+    bool sendLog(uint8_t level, const char* text)
+    {
+        uint8_t body[MAX_BODY];
+        size_t length = strlen(text);
+        if (length > MAX_BODY - 1) length = MAX_BODY - 1;
+        body[0] = level;
+        memcpy(body + 1, text, length);
+        return send(REC_LOG, body, length + 1);
+    }
+
+    /**
+     * @brief Запись лога с номером сообщения (Logger::record)
+     * @param record Номер сообщения, время и аргументы в формате Logger
+     * @param size Длина записи
+     */
+    bool sendLogRecord(const uint8_t* record, uint8_t size)
+    {
+        return send(REC_LOG_ID, record, size);
+    }
+
+    /**
+     * @brief Произвольный счётчик приложения
+     * @param id Идентификатор счётчика
+     * @param value Значение
+     */
+    bool sendCounter(uint8_t id, int32_t value)
+    {
+        CounterBody body = {id, value};
+        return send(REC_COUNTER, &body, sizeof(body));
+    }
+
+    uint16_t sent()
+    {
+        return sentCount;
+    }
+
+    uint16_t dropped()
+    {
+        return droppedCount;
+    }
+}
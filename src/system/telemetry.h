@@ -0,0 +1,89 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "hal/hal.h"
+
+#ifndef OS_TELEMETRY_BAUD
+#define OS_TELEMETRY_BAUD 250000
+#endif
+
+/*
+ * Двоичная телеметрия через Serial. Включается флагом -DOS_TELEMETRY:
+ * тогда Serial работает на OS_TELEMETRY_BAUD (по умолчанию 250000 -
+ * без ошибки частоты на 16 МГц), а systemMonitorTask, ledStatusTask и
+ * Logger отправляют записи вместо текста.
+ *
+ * Кадр: COBS(type:u8 | seq:u8 | тело | crc:u16) 0x00
+ * crc - CRC-16/CCITT-FALSE по type, seq и телу, все поля little-endian.
+ * seq увеличивается и для отброшенных кадров, пропуски видны декодеру
+ * tools/telemetry_decode.py. Кадр отправляется только если целиком
+ * помещается в буфер передачи UART, поэтому отправка не ждёт линию.
+ */
+namespace Telemetry
+{
+    enum Record : uint8_t
+    {
+        REC_TASK = 1,
+        REC_SYSTEM,
+        REC_MEMORY,
+        REC_LOG,
+        REC_COUNTER,
+        REC_LOG_ID      // Запись лога: номер сообщения (fs/logmsg.h), время, аргументы
+    };
+
+    // Наибольшее тело записи (текст REC_LOG обрезается)
+    const uint8_t MAX_BODY = 48;
+
+    struct __attribute__((packed)) TaskBody
+    {
+        uint8_t index;
+        uint8_t enabled;
+        uint32_t period;        // мс, с учётом замедления
+        uint32_t runCount;
+        uint32_t lastRunTime;   // мкс
+        uint32_t maxRunTime;    // мкс
+        uint32_t maxJitter;     // мкс
+        uint16_t overruns;
+        uint16_t misses;
+        uint16_t load;          // ‰
+    };
+
+    struct __attribute__((packed)) SystemBody
+    {
+        uint32_t uptime;        // мс
+        uint32_t idle;          // мс
+        uint16_t load;          // ‰
+        uint8_t taskCount;
+        uint8_t fileCount;
+        uint16_t vcc;           // мВ, 0 если не измеряется
+        uint16_t dropped;       // Отброшенных кадров телеметрии
+    };
+
+    struct __attribute__((packed)) MemoryBody
+    {
+        int16_t freeMemory;     // Промежуток между кучей и стеком
+        uint16_t heapFree;      // Вместе с дырами кучи
+        uint16_t largestFree;
+        uint8_t fragments;
+    };
+
+    struct __attribute__((packed)) CounterBody
+    {
+        uint8_t id;
+        int32_t value;
+    };
+
+    void begin(unsigned long baud = OS_TELEMETRY_BAUD);
+    bool send(Record type, const void* body, uint8_t size);
+    bool sendTask(uint8_t index);
+    bool sendSystem();
+    bool sendMemory();
+    bool sendLog(uint8_t level, const char* text);
+    bool sendLogRecord(const uint8_t* record, uint8_t size);
+    bool sendCounter(uint8_t id, int32_t value);
+
+    uint16_t sent();
+    uint16_t dropped();
+}
+
+#endif
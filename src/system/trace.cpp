@@ -0,0 +1,169 @@
+#include "system/trace.h"
+#include "driver/timer.h"
+
+namespace
+{
+    struct Entry
+    {
+        uint8_t type;
+        uint8_t arg;
+        uint16_t stamp;     // Младшие 16 бит времени (мкс)
+    };
+
+    const uint16_t INDEX_MASK = Trace::SIZE - 1;
+    // Наибольший интервал между событиями без EV_SYNC (половина периода 16-битной метки)
+    const uint32_t SYNC_INTERVAL = 32768UL;
+
+    Entry buffer[Trace::SIZE];
+    uint16_t head = 0;
+    uint16_t count = 0;
+    uint16_t lost = 0;
+    uint32_t baseMicros = 0;    // Время, относительно которого раскрывается метка самого старого события
+    uint32_t lastMicros = 0;    // Время последнего записанного события
+    bool started = false;
+    volatile bool paused = false;
+    uint8_t mask = Trace::CAT_ALL & ~Trace::CAT_IRQ;
+
+    /**
+     * @brief Полное время события по опорному времени
+     */
+    uint32_t absoluteTime(const Entry& e, uint32_t base)
+    {
+        if (e.type == Trace::EV_SYNC)
+        {
+            return ((uint32_t)e.arg << 24) | ((uint32_t)e.stamp << 8);
+        }
+        return base + (uint16_t)(e.stamp - (uint16_t)base);
+    }
+
+    void put(uint8_t type, uint8_t arg, uint16_t stamp)
+    {
+        if (count == Trace::SIZE)
+        {
+            // Самое старое событие перезаписывается, опорное время переходит на него
+            baseMicros = absoluteTime(buffer[head], baseMicros);
+            count--;
+            if (lost < 0xFFFF) lost++;
+        }
+        Entry& e = buffer[head];
+        e.type = type;
+        e.arg = arg;
+        e.stamp = stamp;
+        head = (head + 1) & INDEX_MASK;
+        count++;
+    }
+
+    void writeByte(Print& out, uint8_t value, uint8_t& check)
+    {
+        out.write(value);
+        check ^= value;
+    }
+
+    void writeWord(Print& out, uint16_t value, uint8_t& check)
+    {
+        writeByte(out, value & 0xFF, check);
+        writeByte(out, value >> 8, check);
+    }
+}
+
+namespace Trace
+{
+    /**
+     * @brief Запись события (из задачи или обработчика прерывания)
+     * @param type Тип события
+     * @param arg Аргумент
+     */
+    void record(Event type, uint8_t arg)
+    {
+        uint8_t sreg = hal::irqSave();
+        if (paused)
+        {
+            if (lost < 0xFFFF) lost++;
+            hal::irqRestore(sreg);
+            return;
+        }
+
+        uint32_t now = sysTimer.micros();
+        if (!started)
+        {
+            baseMicros = lastMicros = now;
+            started = true;
+        }
+        if (now - lastMicros >= SYNC_INTERVAL)
+        {
+            put(EV_SYNC, now >> 24, now >> 8);
+        }
+        put(type, arg, (uint16_t)now);
+        lastMicros = now;
+        hal::irqRestore(sreg);
+    }
+
+    /**
+     * @brief Выбор записываемых категорий
+     * @param value Маска Category (по умолчанию всё, кроме прерываний)
+     */
+    void setMask(uint8_t value)
+    {
+        mask = value;
+    }
+
+    uint8_t getMask()
+    {
+        return mask;
+    }
+
+    /**
+     * @brief Вывод накопленных событий одним блоком и очистка буфера
+     * @param out Поток вывода
+     * @return Количество выведенных событий
+     *
+     * Во время вывода запись приостановлена, пропущенные события
+     * учитываются в поле lost следующего блока. Можно вызывать с
+     * запрещёнными прерываниями (аварийный дамп).
+     */
+    uint16_t flush(Print& out)
+    {
+        uint8_t sreg = hal::irqSave();
+        paused = true;
+        uint16_t n = count;
+        uint16_t first = (head - count) & INDEX_MASK;
+        uint16_t lostNow = lost;
+        uint32_t base = baseMicros;
+        lost = 0;
+        hal::irqRestore(sreg);
+
+        uint8_t check = 0;
+        out.write((const uint8_t*)"TRC\x01", 4);
+        writeWord(out, n, check);
+        writeWord(out, lostNow, check);
+        writeWord(out, base & 0xFFFF, check);
+        writeWord(out, base >> 16, check);
+        for (uint16_t i = 0; i < n; i++)
+        {
+            const Entry& e = buffer[(first + i) & INDEX_MASK];
+            writeByte(out, e.type, check);
+            writeByte(out, e.arg, check);
+            writeWord(out, e.stamp, check);
+        }
+        out.write(check);
+
+        sreg = hal::irqSave();
+        count = 0;
+        baseMicros = lastMicros;
+        paused = false;
+        hal::irqRestore(sreg);
+        return n;
+    }
+
+    /**
+     * @brief Очистка буфера без вывода
+     */
+    void clear()
+    {
+        uint8_t sreg = hal::irqSave();
+        count = 0;
+        lost = 0;
+        baseMicros = lastMicros;
+        hal::irqRestore(sreg);
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "hal/hal.h"
+
+/*
+ * Двоичная трасса событий ядра. Включается флагом сборки -DOS_TRACE,
+ * без него макросы TRACE_* ниже не генерируют кода.
+ *
+ * Событие занимает 4 байта: тип, аргумент и младшие 16 бит времени в мкс
+ * (sysTimer.micros(), т.е. TCNT1/TCNT2). Если с предыдущего события прошло
+ * больше 32 мс, перед событием записывается EV_SYNC со старшими битами
+ * времени. Буфер кольцевой: при переполнении теряются старые события.
+ *
+ * Блок в потоке (все поля little-endian):
+ *   "TRC" 0x01 | count:u16 | lost:u16 | firstMicros:u32 | события | xor:u8
+ * xor - исключающее ИЛИ всех байт после сигнатуры. Блоки можно смешивать
+ * с текстовым выводом Serial: декодер tools/trace_decode.py ищет сигнатуру.
+ */
+namespace Trace
+{
+    enum Event : uint8_t
+    {
+        EV_SYNC,          // arg = биты 24-31 времени, stamp = биты 8-23
+        EV_TASK_START,    // arg = индекс задачи
+        EV_TASK_STOP,
+        EV_SEM_WAIT,      // arg = семафор, бит 7 - задача заблокирована
+        EV_SEM_SIGNAL,
+        EV_IRQ_ENTER,     // arg = IrqStats::Vector
+        EV_IRQ_EXIT,
+        EV_FS_BEGIN,      // arg = FsOp
+        EV_FS_END,
+        EV_LOG_BEGIN,     // arg = LogLevel
+        EV_LOG_END,
+        EV_OVERRUN,       // arg = индекс задачи
+        EV_DUMP,
+        EV_MARK           // Пользовательская отметка, arg произвольный
+    };
+
+    enum FsOp : uint8_t
+    {
+        FS_CREATE,
+        FS_READ,
+        FS_WRITE,
+        FS_DELETE,
+        FS_VERIFY
+    };
+
+    enum LogLevel : uint8_t
+    {
+        LOG_INFO,
+        LOG_WARN,
+        LOG_ERR
+    };
+
+    // Категории для setMask()
+    enum Category : uint8_t
+    {
+        CAT_TASK = 0x01,
+        CAT_SEM  = 0x02,
+        CAT_IRQ  = 0x04,
+        CAT_FS   = 0x08,
+        CAT_LOG  = 0x10,
+        CAT_ALL  = 0xFF
+    };
+
+#ifndef OS_TRACE_SIZE
+#define OS_TRACE_SIZE 64
+#endif
+    // Ёмкость буфера в событиях (степень двойки)
+    const uint16_t SIZE = OS_TRACE_SIZE;
+    static_assert((SIZE & (SIZE - 1)) == 0, "OS_TRACE_SIZE must be a power of two");
+
+    void record(Event type, uint8_t arg);
+    void setMask(uint8_t mask);
+    uint8_t getMask();
+    uint16_t flush(Print& out);
+    void clear();
+
+    /**
+     * @brief Пара событий начала и конца на время жизни объекта
+     */
+    class Scope
+    {
+    public:
+        Scope(uint8_t category, Event begin, uint8_t arg)
+            : _active(getMask() & category), _end((Event)(begin + 1)), _arg(arg)
+        {
+            if (_active) record(begin, arg);
+        }
+        ~Scope()
+        {
+            if (_active) record(_end, _arg);
+        }
+
+    private:
+        bool _active;
+        Event _end;             // Событие конца следует за событием начала
+        uint8_t _arg;
+    };
+}
+
+#ifdef OS_TRACE
+#define TRACE_EVENT(cat, type, arg) do { if (Trace::getMask() & (cat)) Trace::record(type, arg); } while (0)
+#define TRACE_SCOPE(cat, begin, arg) Trace::Scope _trace_scope(cat, begin, arg)
+#else
+#define TRACE_EVENT(cat, type, arg) do {} while (0)
+#define TRACE_SCOPE(cat, begin, arg) do {} while (0)
+#endif
+
+#define TRACE_TASK_START(i) TRACE_EVENT(Trace::CAT_TASK, Trace::EV_TASK_START, i)
+#define TRACE_TASK_STOP(i) TRACE_EVENT(Trace::CAT_TASK, Trace::EV_TASK_STOP, i)
+#define TRACE_SEM_WAIT(id, blocked) TRACE_EVENT(Trace::CAT_SEM, Trace::EV_SEM_WAIT, (id) | ((blocked) ? 0x80 : 0))
+#define TRACE_SEM_SIGNAL(id) TRACE_EVENT(Trace::CAT_SEM, Trace::EV_SEM_SIGNAL, id)
+#define TRACE_IRQ_ENTER(vec) TRACE_EVENT(Trace::CAT_IRQ, Trace::EV_IRQ_ENTER, vec)
+#define TRACE_IRQ_EXIT(vec) TRACE_EVENT(Trace::CAT_IRQ, Trace::EV_IRQ_EXIT, vec)
+#define TRACE_FS(op) TRACE_SCOPE(Trace::CAT_FS, Trace::EV_FS_BEGIN, op)
+#define TRACE_LOG(level) TRACE_SCOPE(Trace::CAT_LOG, Trace::EV_LOG_BEGIN, level)
+#define TRACE_OVERRUN(i) TRACE_EVENT(Trace::CAT_ALL, Trace::EV_OVERRUN, i)
+#define TRACE_DUMP() TRACE_EVENT(Trace::CAT_ALL, Trace::EV_DUMP, 0)
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef TEST_PERF_H
+#define TEST_PERF_H
+
+/*
+ * Общие средства тестов: время, такты и занятая память кучи.
+ *
+ * На AVR (env:unittest под simavr) системный тик переносится на Timer2,
+ * Timer1 без предделителя со счётчиком переполнений считает такты CPU,
+ * как в bench/bench_main.cpp. В env:native время продвигается моделью
+ * hal::sim, такты не измеряются и тесты тактов отмечаются пропущенными.
+ *
+ * Подключается одним файлом теста на программу (определяет ISR и точку
+ * входа PERF_TEST_MAIN).
+ */
+
+#include <unity.h>
+#include "kernel/kernel.h"
+#include "fs/fs.h"
+#include "driver/timer.h"
+#include "system/heap.h"
+#ifdef __AVR__
+#include <avr/sleep.h>
+#else
+#include "hal/native/sim.h"
+#include <malloc.h>
+#endif
+
+namespace perf
+{
+#ifdef __AVR__
+    volatile uint16_t overflows = 0;
+
+    inline uint32_t cycles()
+    {
+        uint8_t sreg = SREG;
+        cli();
+        uint16_t lo = TCNT1;
+        uint16_t hi = overflows;
+        if ((TIFR1 & (1 << TOV1)) && lo < 0x8000) hi++;
+        SREG = sreg;
+        return ((uint32_t)hi << 16) | lo;
+    }
+#else
+    inline uint32_t cycles()
+    {
+        return 0;
+    }
+#endif
+
+    /**
+     * @brief Запуск системного таймера и счётчика тактов
+     */
+    inline void begin()
+    {
+#ifdef __AVR__
+        sysTimer.begin(HwTimers::TIMER_2);
+        HwTimers::acquire(HwTimers::TIMER_1, HwTimers::OWNER_BENCH);
+        noInterrupts();
+        TCCR1A = 0;
+        TCCR1B = (1 << CS10);
+        TCNT1 = 0;
+        TIFR1 = (1 << TOV1);
+        TIMSK1 = (1 << TOIE1);
+        interrupts();
+#else
+        hal::sim::reset();
+        hal::sim::setAutoAdvance(0);
+        sysTimer.begin();
+#endif
+    }
+
+    /**
+     * @brief Остановка после вывода результатов (simavr завершает работу)
+     */
+    inline void finish()
+    {
+#ifdef __AVR__
+        Serial.flush();
+        cli();
+        set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+        sleep_enable();
+        sleep_cpu();
+#endif
+    }
+
+    /**
+     * @brief Байт кучи, занятых блоками (с заголовками)
+     */
+    inline int32_t heapUsed()
+    {
+#ifdef __AVR__
+        Heap::Stats s;
+        Heap::stats(s);
+        return (int32_t)s.heapSize - s.freeListBytes;
+#else
+        return mallinfo2().uordblks;
+#endif
+    }
+
+    /**
+     * @brief Занятость CPU внутри задачи
+     * @param us Микросекунды
+     */
+    inline void busy(uint32_t us)
+    {
+#ifdef __AVR__
+        for (; us > 1000; us -= 1000) delayMicroseconds(1000);
+        delayMicroseconds(us);
+#else
+        hal::sim::advance(us);
+#endif
+    }
+
+    /**
+     * @brief Работа планировщика в течение заданного времени
+     * @param ms Миллисекунды
+     */
+    inline void runFor(uint32_t ms)
+    {
+        uint32_t end = sysTimer.millis() + ms;
+        while ((int32_t)(sysTimer.millis() - end) < 0)
+        {
+            kernel.run();
+#ifndef __AVR__
+            hal::sim::advance(10);
+#endif
+        }
+    }
+
+    /**
+     * @brief Наименьшее число тактов операции из нескольких повторов
+     *
+     * Минимум не содержит прерываний тика.
+     */
+    template <typename Op>
+    uint32_t measure(Op op, uint8_t reps = 20)
+    {
+        uint32_t best = 0xFFFFFFFFUL;
+        for (uint8_t i = 0; i < reps; i++)
+        {
+            uint32_t start = cycles();
+            op();
+            uint32_t elapsed = cycles() - start;
+            if (elapsed < best) best = elapsed;
+        }
+        return best;
+    }
+
+    // Такты пустой операции в measure() (вызов и чтение счётчика),
+    // измеряются при первом замере и вычитаются из каждого
+    uint32_t overhead = 0;
+
+    /**
+     * @brief Такты операции без затрат самого измерения
+     */
+    template <typename Op>
+    uint32_t netCycles(Op op)
+    {
+        if (!overhead) overhead = measure([] {});
+        uint32_t total = measure(op);
+        return (total > overhead) ? total - overhead : 0;
+    }
+
+    /**
+     * @brief Проверка границы тактов с выводом замера
+     *
+     * Строка "cycles <строка теста>: <замер> <= <граница>" в выводе
+     * env:unittest - исходные данные для калибровки границ.
+     */
+    template <typename Op>
+    void assertCycles(uint32_t limit, Op op, unsigned line)
+    {
+#ifdef __AVR__
+        uint32_t cycles = netCycles(op);
+        Serial.print(F("cycles "));
+        Serial.print(line);
+        Serial.print(F(": "));
+        Serial.print(cycles);
+        Serial.print(F(" <= "));
+        Serial.println(limit);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(limit, cycles);
+#else
+        (void)limit;
+        (void)op;
+        (void)line;
+        TEST_IGNORE_MESSAGE("cycles are measured under simavr only");
+#endif
+    }
+
+    inline void clearTasks()
+    {
+        while (kernel.getTaskCount() > 0)
+        {
+            kernel.removeTask(kernel.getTaskFunction(0));
+        }
+    }
+
+    inline void clearFiles()
+    {
+        while (fs.getFileCount() > 0)
+        {
+            fs.deleteFile(fs.getFile(0)->name);
+        }
+    }
+}
+
+#ifdef __AVR__
+ISR(TIMER1_OVF_vect)
+{
+    perf::overflows++;
+}
+#endif
+
+/*
+ * Верхняя граница тактов операции без затрат измерения (perf::overhead).
+ * Только под simavr; в env:native тест отмечается пропущенным, поэтому
+ * проверки тактов выносятся в отдельные тесты test_*_cycles.
+ */
+#define TEST_ASSERT_CYCLES(limit, op) perf::assertCycles(limit, op, __LINE__)
+
+/*
+ * Точка входа набора: runTests() под simavr из setup() с остановкой
+ * после вывода, в env:native - из main().
+ */
+#ifdef ARDUINO
+#define PERF_TEST_MAIN(run)     \
+    void setup()                \
+    {                           \
+        perf::begin();          \
+        run();                  \
+        perf::finish();         \
+    }                           \
+    void loop() {}
+#else
+#define PERF_TEST_MAIN(run)     \
+    int main()                  \
+    {                           \
+        perf::begin();          \
+        return run();           \
+    }
+#endif
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Арифметика с фиксированной точкой (system/fixed.h).
+ */
+
+#include "../perf.h"
+#include "system/fixed.h"
+
+using Fixed::Q;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_arithmetic()
+{
+    typedef Q<8> Q8;
+    Q8 a = Q8::fromRatio(3, 2);         // 1.5
+    Q8 b = Q8::fromInt(-2);
+    TEST_ASSERT_EQUAL_INT16(384, a.raw());
+    TEST_ASSERT_EQUAL_INT16(-128, (a + b).raw());
+    TEST_ASSERT_EQUAL_INT16(-768, (a * b).raw());
+    TEST_ASSERT_EQUAL_INT16(-192, (a / b).raw());
+    TEST_ASSERT_EQUAL_INT16(1152, (a * 3).raw());
+    TEST_ASSERT_TRUE(b < a);
+
+    // Округление к ближайшему, в том числе для отрицательных
+    TEST_ASSERT_EQUAL_INT16(2, a.round());
+    TEST_ASSERT_EQUAL_INT16(-1, Q8::fromRatio(-3, 4).round());
+    TEST_ASSERT_EQUAL_INT16(-1, Q8::fromRatio(-1, 4).floor());
+    TEST_ASSERT_EQUAL_INT16(-33, Q8::fromRatio(-1, 3).scaled(100));
+
+    // Перевод между форматами
+    typedef Q<12, uint16_t> Q12;
+    TEST_ASSERT_EQUAL_UINT16(6144, Q12::from(a).raw());
+    TEST_ASSERT_EQUAL_INT16(384, Q8::from(Q12::fromRaw(6144)).raw());
+}
+
+void test_units()
+{
+    TEST_ASSERT_EQUAL_INT16(25 * 256, Fixed::percent(512, 2048).raw());
+    TEST_ASSERT_EQUAL_INT16(0, Fixed::percent(1, 0).raw());
+    TEST_ASSERT_TRUE(Fixed::percent(100, 2048) < Fixed::Percent::fromInt(10));
+
+    Fixed::Volts vcc = Fixed::Millivolts(4980).volts();
+    TEST_ASSERT_EQUAL_INT32(4980, vcc.scaled(1000));
+    TEST_ASSERT_EQUAL_UINT16(5, vcc.round());
+
+    TEST_ASSERT_EQUAL_UINT32(3299, Fixed::mulDiv(675, 5000, 1023));
+    TEST_ASSERT_EQUAL_UINT32(3296, Fixed::mulDiv(675, 5000, 1024));
+    TEST_ASSERT_EQUAL_INT32(512, Fixed::scale(50, 0, 100, 0, 1023));
+    TEST_ASSERT_EQUAL_INT32(-40, Fixed::scale(0, 0, 1023, -40, 125));
+}
+
+void test_filters()
+{
+    Fixed::Ema<2> ema;
+    TEST_ASSERT_FALSE(ema.isReady());
+    TEST_ASSERT_EQUAL_INT16(100, ema.update(100));
+    TEST_ASSERT_EQUAL_INT16(125, ema.update(200));
+    // Малые приращения накапливаются в дробной части
+    for (uint8_t i = 0; i < 50; i++) ema.update(200);
+    TEST_ASSERT_EQUAL_INT16(200, ema.value());
+
+    Fixed::MovingAverage<4> average;
+    TEST_ASSERT_EQUAL_INT16(10, average.update(10));
+    TEST_ASSERT_EQUAL_INT16(15, average.update(20));
+    average.update(30);
+    TEST_ASSERT_FALSE(average.isFull());
+    TEST_ASSERT_EQUAL_INT16(25, average.update(40));
+    TEST_ASSERT_EQUAL_INT16(35, average.update(50));
+    TEST_ASSERT_TRUE(average.isFull());
+}
+
+void test_format()
+{
+    char text[12];
+    TEST_ASSERT_EQUAL_UINT8(4, Fixed::format(text, sizeof(text), Fixed::Millivolts(4980).volts(), 2));
+    TEST_ASSERT_EQUAL_STRING("4.98", text);
+    Fixed::format(text, sizeof(text), Q<8>::fromRatio(-5, 2), 1);
+    TEST_ASSERT_EQUAL_STRING("-2.5", text);
+    Fixed::format(text, sizeof(text), Q<8>::fromRatio(1999, 1000), 2);
+    TEST_ASSERT_EQUAL_STRING("2.00", text);
+    Fixed::format(text, sizeof(text), Q<8>::fromRaw(-1), 1);
+    TEST_ASSERT_EQUAL_STRING("0.0", text);
+    Fixed::format(text, sizeof(text), Fixed::Percent::fromInt(42), 0);
+    TEST_ASSERT_EQUAL_STRING("42", text);
+    TEST_ASSERT_EQUAL_UINT8(0, Fixed::format(text, 4, Fixed::Percent::fromInt(100), 2));
+}
+
+void test_cycles()
+{
+    static volatile int16_t raw = 384;
+    TEST_ASSERT_CYCLES(95, [] { volatile int16_t v = (Q<8>::fromRaw(raw) * Q<8>::fromRaw(raw)).raw(); (void)v; });
+    TEST_ASSERT_CYCLES(35, [] { volatile bool v = Q<8>::fromRaw(raw) < Fixed::Percent::fromInt(10); (void)v; });
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_arithmetic);
+    RUN_TEST(test_units);
+    RUN_TEST(test_filters);
+    RUN_TEST(test_format);
+    RUN_TEST(test_cycles);
+    return UNITY_END();
+}
+
+PERF_TEST_MAIN(runTests)
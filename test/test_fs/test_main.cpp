@@ -0,0 +1,234 @@
+/*
+ * Файловая система: ограничения, перезапись, сдвиг при удалении,
+ * стоимость операций и отсутствие утечек памяти.
+ */
+
+#include "../perf.h"
+#include "fs/logger.h"
+
+namespace
+{
+    const char romText[] PROGMEM = "rate=10";
+    const uint8_t romBin[] PROGMEM = {1, 2, 3, 4};
+    const char romTextName[] PROGMEM = "rom.txt";
+    const char romBinName[] PROGMEM = "rom.bin";
+    const FileSystem::RomFile romFiles[] PROGMEM =
+    {
+        {romTextName, reinterpret_cast<const uint8_t*>(romText), sizeof(romText) - 1, false},
+        {romBinName, romBin, sizeof(romBin), true},
+    };
+
+    String filled(size_t length)
+    {
+        String s;
+        s.reserve(length);
+        for (size_t i = 0; i < length; i++) s += (char)('a' + i % 26);
+        return s;
+    }
+
+    String nameOf(uint8_t i)
+    {
+        return "f" + String(i);
+    }
+
+    // Полный проход фоновой проверки по всем файлам
+    bool scrubAll()
+    {
+        bool valid = true;
+        uint16_t steps = FileSystem::MAX_FILES * (FileSystem::MAX_FILE_SIZE / FileSystem::SCRUB_CHUNK + 1);
+        for (uint16_t i = 0; i < steps; i++)
+        {
+            valid &= fs.scrubStep();
+        }
+        return valid;
+    }
+}
+
+void setUp()
+{
+    perf::clearTasks();
+    perf::clearFiles();
+}
+
+void tearDown()
+{
+    perf::clearFiles();
+    fs.mountRom(nullptr, 0);
+}
+
+void test_max_files()
+{
+    for (uint8_t i = 0; i < FileSystem::MAX_FILES; i++)
+    {
+        TEST_ASSERT_TRUE(fs.createFile(nameOf(i), "x"));
+    }
+    TEST_ASSERT_FALSE(fs.createFile("extra", "x"));
+    TEST_ASSERT_EQUAL_INT(FileSystem::MAX_FILES, fs.getFileCount());
+}
+
+void test_name_limits()
+{
+    TEST_ASSERT_TRUE(fs.createFile(filled(FileSystem::MAX_FILENAME_LEN), ""));
+    TEST_ASSERT_FALSE(fs.createFile(filled(FileSystem::MAX_FILENAME_LEN + 1), ""));
+    TEST_ASSERT_FALSE(fs.createFile("", ""));
+    TEST_ASSERT_FALSE(fs.createFile("a/b", ""));
+    TEST_ASSERT_FALSE(fs.createFile(filled(FileSystem::MAX_FILENAME_LEN), ""));
+}
+
+void test_size_limits()
+{
+    TEST_ASSERT_TRUE(fs.createFile("max", filled(FileSystem::MAX_FILE_SIZE)));
+    TEST_ASSERT_FALSE(fs.createFile("over", filled(FileSystem::MAX_FILE_SIZE + 1)));
+
+    // Слишком большая перезапись отклоняется, старое содержимое остаётся
+    TEST_ASSERT_TRUE(fs.writeFile("small", "keep"));
+    TEST_ASSERT_FALSE(fs.writeFile("small", filled(FileSystem::MAX_FILE_SIZE + 1)));
+    TEST_ASSERT_EQUAL_STRING("keep", fs.readFile("small").c_str());
+
+    static uint8_t data[FileSystem::MAX_FILE_SIZE + 1];
+    TEST_ASSERT_TRUE(fs.createBinaryFile("bin", data, FileSystem::MAX_FILE_SIZE));
+    TEST_ASSERT_FALSE(fs.writeBinaryFile("bin", data, sizeof(data)));
+    TEST_ASSERT_TRUE(fs.verifyFilesystem());
+}
+
+// Перезапись освобождает прежний блок
+void test_overwrite()
+{
+    TEST_ASSERT_TRUE(fs.createFile("data", filled(100)));
+    int32_t before = perf::heapUsed();
+
+    for (uint8_t i = 0; i < 20; i++)
+    {
+        TEST_ASSERT_TRUE(fs.writeFile("data", filled(100)));
+    }
+    TEST_ASSERT_EQUAL_INT32(before, perf::heapUsed());
+    TEST_ASSERT_EQUAL_INT(1, fs.getFileCount());
+
+    TEST_ASSERT_TRUE(fs.writeFile("data", "new"));
+    TEST_ASSERT_EQUAL_STRING("new", fs.readFile("data").c_str());
+}
+
+// Удаление из середины сохраняет порядок остальных файлов
+void test_delete_compaction()
+{
+    for (uint8_t i = 0; i < FileSystem::MAX_FILES; i++)
+    {
+        fs.createFile(nameOf(i), nameOf(i));
+    }
+    TEST_ASSERT_TRUE(fs.deleteFile(nameOf(1)));
+
+    TEST_ASSERT_EQUAL_INT(FileSystem::MAX_FILES - 1, fs.getFileCount());
+    TEST_ASSERT_EQUAL_STRING("f0", fs.getFile(0)->name.c_str());
+    TEST_ASSERT_EQUAL_STRING("f2", fs.getFile(1)->name.c_str());
+    String last = nameOf(FileSystem::MAX_FILES - 1);
+    TEST_ASSERT_EQUAL_STRING(last.c_str(), fs.getFile(FileSystem::MAX_FILES - 2)->name.c_str());
+    TEST_ASSERT_EQUAL_STRING(last.c_str(), fs.readFile(last).c_str());
+
+    TEST_ASSERT_TRUE(fs.createFile("last", "x"));
+    TEST_ASSERT_TRUE(fs.verifyFilesystem());
+    // Ошибка попадает в буфер записей лога; log.txt не создаётся -
+    // места под файл нет, а ошибка записи лога не логируется повторно
+    TEST_ASSERT_FALSE(fs.deleteFile(nameOf(1)));
+    TEST_ASSERT_FALSE(fs.fileExists("log.txt"));
+}
+
+// Файлы во flash читаются без выделения памяти под данные и
+// переопределяются файлом в RAM с тем же именем
+void test_rom_files()
+{
+    fs.mountRom(romFiles, 2);
+    TEST_ASSERT_TRUE(fs.fileExists("rom.txt"));
+    TEST_ASSERT_EQUAL_INT(0, fs.getFileCount());
+    TEST_ASSERT_EQUAL_STRING("rate=10", fs.readFile("rom.txt").c_str());
+
+    uint8_t buffer[4];
+    TEST_ASSERT_TRUE(fs.readBinaryFile("rom.bin", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_UINT8(4, buffer[3]);
+    TEST_ASSERT_FALSE(fs.readBinaryFile("rom.bin", buffer, 3));
+
+    TEST_ASSERT_TRUE(fs.writeFile("rom.txt", "rate=20"));
+    TEST_ASSERT_EQUAL_STRING("rate=20", fs.readFile("rom.txt").c_str());
+    TEST_ASSERT_TRUE(fs.deleteFile("rom.txt"));
+    TEST_ASSERT_EQUAL_STRING("rate=10", fs.readFile("rom.txt").c_str());
+
+    TEST_ASSERT_FALSE(fs.deleteFile("rom.txt"));
+}
+
+// Дописывание продолжает CRC; проверки находят порчу данных и таблицы
+void test_integrity()
+{
+    TEST_ASSERT_TRUE(fs.createFile("a", "abc"));
+    TEST_ASSERT_TRUE(fs.appendFile("a", "def"));
+    TEST_ASSERT_TRUE(fs.appendFile("b", "new"));
+    TEST_ASSERT_FALSE(fs.appendFile("a", filled(FileSystem::MAX_FILE_SIZE)));
+    TEST_ASSERT_EQUAL_STRING("abcdef", fs.readFile("a").c_str());
+    uint8_t data[100] = {7};
+    TEST_ASSERT_TRUE(fs.createBinaryFile("bin", data, sizeof(data)));
+    TEST_ASSERT_TRUE(fs.verifyFilesystem());
+    TEST_ASSERT_TRUE(scrubAll());
+
+    FileSystem::File* file = const_cast<FileSystem::File*>(fs.getFile(2));
+    file->data[50] ^= 0x01;
+    TEST_ASSERT_TRUE(fs.verifyFilesystem());
+    // Повторные проходы не повторяют запись о порче в логе
+    logger.clearRecords();
+    TEST_ASSERT_FALSE(scrubAll());
+    TEST_ASSERT_FALSE(scrubAll());
+    TEST_ASSERT_EQUAL_UINT8(1, logger.getRecordCount());
+    file->data[50] ^= 0x01;
+    TEST_ASSERT_TRUE(scrubAll());
+
+    file->size--;
+    TEST_ASSERT_FALSE(fs.verifyFilesystem());
+    file->size++;
+    TEST_ASSERT_TRUE(fs.verifyFilesystem());
+}
+
+// Циклы создания и удаления не увеличивают кучу после первого
+void test_create_delete_heap()
+{
+    fs.createFile(nameOf(0), filled(64));
+    fs.deleteFile(nameOf(0));
+    int32_t before = perf::heapUsed();
+
+    for (uint8_t i = 0; i < 50; i++)
+    {
+        TEST_ASSERT_TRUE(fs.createFile(nameOf(0), filled(64)));
+        TEST_ASSERT_TRUE(fs.deleteFile(nameOf(0)));
+    }
+    TEST_ASSERT_EQUAL_INT32(before, perf::heapUsed());
+}
+
+void test_operation_cycles()
+{
+    for (uint8_t i = 0; i < FileSystem::MAX_FILES - 1; i++)
+    {
+        fs.createFile(nameOf(i), "x");
+    }
+    fs.createFile("data", filled(64));
+    static const String content = filled(64);
+    static const String name = "data";
+
+    TEST_ASSERT_CYCLES(4000, [] { fs.fileExists(name); });
+    TEST_ASSERT_CYCLES(12000, [] { fs.readFile(name); });
+    TEST_ASSERT_CYCLES(15000, [] { fs.writeFile(name, content); });
+    TEST_ASSERT_CYCLES(6000, [] { fs.verifyFilesystem(); });
+    TEST_ASSERT_CYCLES(2000, [] { fs.scrubStep(); });
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_max_files);
+    RUN_TEST(test_name_limits);
+    RUN_TEST(test_size_limits);
+    RUN_TEST(test_overwrite);
+    RUN_TEST(test_delete_compaction);
+    RUN_TEST(test_rom_files);
+    RUN_TEST(test_integrity);
+    RUN_TEST(test_create_delete_heap);
+    RUN_TEST(test_operation_cycles);
+    return UNITY_END();
+}
+
+PERF_TEST_MAIN(runTests)
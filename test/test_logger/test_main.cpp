@@ -0,0 +1,172 @@
+/*
+ * Логгер: ограничение log.txt, удаление старых записей целыми строками,
+ * стоимость записи и постоянство кучи; записи с номером сообщения.
+ */
+
+#include "../perf.h"
+#include "fs/logger.h"
+
+namespace
+{
+    String logText()
+    {
+        return fs.readFile("log.txt");
+    }
+
+    class Capture : public Print
+    {
+    public:
+        size_t write(uint8_t c) override
+        {
+            text += (char)c;
+            return 1;
+        }
+        using Print::write;
+
+        String text;
+    };
+
+    String recordText(uint8_t index)
+    {
+        Capture out;
+        logger.printRecord(index, out);
+        return out.text;
+    }
+
+    void logMany(uint16_t count)
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            logger.log("INFO: entry " + String(i));
+        }
+    }
+
+    void recordMany(uint16_t count)
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            LOG_MSG(MSG_TASK_OVERRUN, i);
+        }
+    }
+}
+
+void setUp()
+{
+    perf::clearTasks();
+    perf::clearFiles();
+    logger.begin();
+}
+
+void tearDown()
+{
+    perf::clearFiles();
+}
+
+void test_size_cap()
+{
+    logMany(100);
+
+    String text = logText();
+    TEST_ASSERT_TRUE(text.length() > 0);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(Logger::MAX_LOG_SIZE, text.length());
+    // Первая строка целая, последняя завершена
+    TEST_ASSERT_EQUAL_CHAR('[', text[0]);
+    TEST_ASSERT_EQUAL_CHAR('\n', text[text.length() - 1]);
+}
+
+void test_newest_kept()
+{
+    logMany(100);
+    logger.log("INFO: last");
+
+    String text = logText();
+    TEST_ASSERT_TRUE(text.endsWith("INFO: last\n"));
+    TEST_ASSERT_TRUE(text.indexOf("entry 99") >= 0);
+    TEST_ASSERT_TRUE(text.indexOf("entry 0\n") < 0);
+}
+
+// Запись длиннее лога обрезается, а не теряется
+void test_long_message()
+{
+    String message = "WARN: ";
+    for (uint16_t i = 0; i < Logger::MAX_LOG_SIZE; i++) message += 'x';
+    logger.log(message);
+
+    String text = logText();
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(Logger::MAX_LOG_SIZE, text.length());
+    TEST_ASSERT_TRUE(text.indexOf("WARN: xxx") > 0);
+
+    logger.log("INFO: after");
+    TEST_ASSERT_TRUE(logText().endsWith("INFO: after\n"));
+}
+
+// После заполнения лога запись не увеличивает кучу (размер log.txt
+// колеблется в пределах одной строки)
+void test_heap_stable()
+{
+    logMany(60);
+    int32_t before = perf::heapUsed();
+    logMany(40);
+    TEST_ASSERT_INT32_WITHIN(32, before, perf::heapUsed());
+}
+
+// Запись хранит номер и аргументы и раскрывается по формату из flash
+void test_record_format()
+{
+    logger.clearRecords();
+    LOG_MSG(MSG_TASK_OVERRUN, 3);
+    LOG_MSG(MSG_FILE_CORRUPT, String("a_very_long_file_name.txt"));
+    LOG_MSG(MSG_TASK_OVERRUN, -70000L);
+
+    TEST_ASSERT_EQUAL_UINT8(3, logger.getRecordCount());
+    TEST_ASSERT_TRUE(recordText(0).endsWith(" ms] WARN: Task 3 overrun\r\n"));
+    // Строковый аргумент ограничен Log::MAX_STRING символами
+    TEST_ASSERT_TRUE(recordText(1).endsWith("ERR: Corrupt file a_very_long_file\r\n"));
+    TEST_ASSERT_TRUE(recordText(2).indexOf("Task -70000 overrun") > 0);
+    TEST_ASSERT_FALSE(logger.printRecord(3, Serial));
+    // В log.txt запись дописывается текстом, как строки log()
+    TEST_ASSERT_TRUE(logText().indexOf(" ms] WARN: Task 3 overrun\n") > 0);
+    TEST_ASSERT_TRUE(logText().endsWith("Task -70000 overrun\n"));
+}
+
+// Буфер вытесняет старые записи целиком; после заполнения log.txt
+// запись не увеличивает кучу
+void test_record_buffer()
+{
+    recordMany(100);
+    logger.clearRecords();
+    LOG_MSG(MSG_FS_CORRUPT);
+    int32_t before = perf::heapUsed();
+    recordMany(100);
+    TEST_ASSERT_INT32_WITHIN(32, before, perf::heapUsed());
+
+    // Номер, время и аргумент - не больше 7 байт с длиной записи
+    uint8_t count = logger.getRecordCount();
+    TEST_ASSERT_TRUE(count < 100);
+    TEST_ASSERT_TRUE(count >= Log::BUFFER_SIZE / 7);
+    TEST_ASSERT_TRUE(recordText(count - 1).endsWith("Task 99 overrun\r\n"));
+    TEST_ASSERT_TRUE(recordText(0).indexOf("ERR") < 0);
+}
+
+void test_log_cycles()
+{
+    logMany(60);
+    static const String message = "INFO: entry";
+
+    TEST_ASSERT_CYCLES(60000, [] { logger.log(message); });
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_size_cap);
+    RUN_TEST(test_newest_kept);
+    RUN_TEST(test_long_message);
+    RUN_TEST(test_heap_stable);
+    RUN_TEST(test_record_format);
+    RUN_TEST(test_record_buffer);
+    RUN_TEST(test_log_cycles);
+    return UNITY_END();
+}
+
+PERF_TEST_MAIN(runTests)
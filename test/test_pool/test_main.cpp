@@ -0,0 +1,83 @@
+/*
+ * Пулы блоков фиксированного размера (system/pool.h).
+ */
+
+#include "../perf.h"
+#include "system/pool.h"
+
+typedef Heap::SizeClassPools<2, 2, 1, 1> Pools;
+
+// Пулы размещаются только в статической памяти
+Pools pools;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_size_classes()
+{
+    void* a = pools.alloc(3);
+    void* b = pools.alloc(8);
+    TEST_ASSERT_EQUAL_UINT8(8, pools.blockSize(a));
+    TEST_ASSERT_EQUAL_UINT8(8, pools.blockSize(b));
+    void* c = pools.alloc(9);
+    void* d = pools.alloc(33);
+    TEST_ASSERT_EQUAL_UINT8(16, pools.blockSize(c));
+    TEST_ASSERT_EQUAL_UINT8(64, pools.blockSize(d));
+
+    // Исчерпанный класс уступает следующему
+    void* e = pools.alloc(1);
+    void* f = pools.alloc(1);
+    TEST_ASSERT_EQUAL_UINT8(16, pools.blockSize(e));
+    TEST_ASSERT_EQUAL_UINT8(32, pools.blockSize(f));
+    TEST_ASSERT_EQUAL_UINT16(0, pools.misses());
+
+    // Подходящих блоков нет, больше MAX_SIZE - не промах
+    TEST_ASSERT_NULL(pools.alloc(1));
+    TEST_ASSERT_NULL(pools.alloc(Pools::MAX_SIZE + 1));
+    TEST_ASSERT_EQUAL_UINT16(1, pools.misses());
+
+    Heap::PoolStats stats;
+    TEST_ASSERT_TRUE(pools.stats(0, stats));
+    TEST_ASSERT_EQUAL_UINT8(2, stats.used);
+    TEST_ASSERT_FALSE(pools.stats(Pools::CLASSES, stats));
+
+    // Освобождённый блок выдаётся снова
+    TEST_ASSERT_TRUE(pools.free(b));
+    TEST_ASSERT_EQUAL_PTR(b, pools.alloc(5));
+    void* blocks[] = {a, b, c, d, e, f};
+    for (void* block : blocks) TEST_ASSERT_TRUE(pools.free(block));
+}
+
+void test_foreign_blocks()
+{
+    uint8_t local[8] = {};
+    void* heap = malloc(8);
+    TEST_ASSERT_EQUAL_UINT8(0, pools.blockSize(local));
+    TEST_ASSERT_FALSE(pools.free(local));
+    TEST_ASSERT_FALSE(pools.free(heap));
+    free(heap);
+
+    Heap::PoolStats stats;
+    pools.stats(0, stats);
+    TEST_ASSERT_EQUAL_UINT8(8, stats.blockSize);
+    TEST_ASSERT_EQUAL_UINT8(2, stats.blocks);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.used);
+    TEST_ASSERT_EQUAL_UINT8(2, stats.peak);
+}
+
+void test_cycles()
+{
+    TEST_ASSERT_CYCLES(95, [] { pools.free(pools.alloc(20)); });
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_size_classes);
+    RUN_TEST(test_foreign_blocks);
+    RUN_TEST(test_cycles);
+    return UNITY_END();
+}
+
+PERF_TEST_MAIN(runTests)
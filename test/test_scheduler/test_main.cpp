@@ -0,0 +1,222 @@
+/*
+ * Планировщик: порядок приоритетов, точность периодов, пробуждение по
+ * семафору (в том числе из ISR), поэтапная загрузка, стоимость прохода
+ * run() и постоянство кучи.
+ */
+
+#include "../perf.h"
+#include "system/boot.h"
+
+namespace
+{
+    const uint8_t ORDER_SIZE = 8;
+    uint8_t order[ORDER_SIZE];
+    uint8_t orderCount = 0;
+
+    uint16_t runsA = 0;
+    uint16_t runsB = 0;
+    int semId = -1;
+    uint16_t waiterRuns = 0;
+    bool waiterAcquired = false;
+
+    void record(uint8_t id)
+    {
+        if (orderCount < ORDER_SIZE) order[orderCount++] = id;
+    }
+
+    void task0() { record(0); }
+    void task1() { record(1); }
+    void task2() { record(2); }
+
+    // Шаг загрузки, ждущий устройство один запуск
+    void retryOnce()
+    {
+        static bool retried = false;
+        record(1);
+        if (!retried) Boot::retry();
+        retried = true;
+    }
+
+    void countA() { runsA++; }
+    void countB() { runsB++; }
+
+    void busyTask()
+    {
+        runsA++;
+        perf::busy(4000);
+    }
+
+    void waiter()
+    {
+        waiterRuns++;
+        waiterAcquired = kernel.sem_wait(semId);
+    }
+}
+
+void setUp()
+{
+    perf::clearTasks();
+    orderCount = 0;
+    runsA = runsB = 0;
+    waiterRuns = 0;
+    waiterAcquired = false;
+}
+
+void tearDown()
+{
+    perf::clearTasks();
+}
+
+// Задачи одного периода выполняются в порядке приоритета, а не добавления
+void test_priority_order()
+{
+    kernel.addTask(task2, 5, 2);
+    kernel.addTask(task0, 5, 0);
+    kernel.addTask(task1, 5, 1);
+
+    perf::runFor(6);
+
+    TEST_ASSERT_EQUAL_UINT8(3, orderCount);
+    TEST_ASSERT_EQUAL_UINT8(0, order[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, order[1]);
+    TEST_ASSERT_EQUAL_UINT8(2, order[2]);
+}
+
+// За 1000 мс задача периода P выполняется 1000/P раз с точностью до одного
+void test_period_accuracy()
+{
+    kernel.addTask(countA, 10, 0);
+    kernel.addTask(countB, 25, 1);
+
+    perf::runFor(1000);
+
+    TEST_ASSERT_UINT16_WITHIN(1, 100, runsA);
+    TEST_ASSERT_UINT16_WITHIN(1, 40, runsB);
+}
+
+// Долгое выполнение не сдвигает последующие запуски
+void test_busy_task_no_drift()
+{
+    kernel.addTask(busyTask, 10, 0);
+
+    perf::runFor(1000);
+
+    TEST_ASSERT_UINT16_WITHIN(1, 100, runsA);
+    TaskInfo info;
+    TEST_ASSERT_TRUE(kernel.getTaskInfo(0, info));
+    TEST_ASSERT_EQUAL_UINT16(0, info.misses);
+}
+
+// Задача без семафора блокируется и возобновляется только по sem_signal
+void test_semaphore_wakeup()
+{
+    semId = kernel.sem_create(0);
+    TEST_ASSERT_TRUE(semId >= 0);
+    kernel.addTask(waiter, 5, 0);
+
+    perf::runFor(50);
+    TEST_ASSERT_EQUAL_UINT16(1, waiterRuns);
+    TEST_ASSERT_FALSE(waiterAcquired);
+
+    TEST_ASSERT_TRUE(kernel.sem_signal(semId));
+    perf::runFor(10);
+    TEST_ASSERT_EQUAL_UINT16(2, waiterRuns);
+
+    // Первый сигнал будит задачу, второй без ожидающих увеличивает счётчик
+    TEST_ASSERT_TRUE(kernel.sem_signal(semId));
+    TEST_ASSERT_TRUE(kernel.sem_signal(semId));
+    perf::runFor(10);
+    TEST_ASSERT_TRUE(waiterAcquired);
+
+    TEST_ASSERT_TRUE(kernel.sem_delete(semId));
+}
+
+// Сигнал из ISR не трогает задачи сразу, а применяется в начале прохода run()
+void test_semaphore_signal_isr()
+{
+    semId = kernel.sem_create(0);
+    kernel.addTask(waiter, 5, 0);
+    perf::runFor(20);
+    TEST_ASSERT_EQUAL_UINT16(1, waiterRuns);
+
+    TEST_ASSERT_TRUE(kernel.sem_signal_isr(semId));
+    TEST_ASSERT_TRUE(kernel.sem_signal_isr(semId));
+    TEST_ASSERT_FALSE(kernel.getTask(0)->enabled);
+    perf::runFor(10);
+    TEST_ASSERT_EQUAL_UINT16(2, waiterRuns);
+    TEST_ASSERT_TRUE(waiterAcquired);
+
+    TEST_ASSERT_FALSE(kernel.sem_signal_isr(semId + 1));
+    TEST_ASSERT_TRUE(kernel.sem_delete(semId));
+}
+
+// После begin() задачи запускаются на первом проходе, отложенные шаги
+// загрузки - после них, по одному за период задачи загрузки; шаг с
+// retry() повторяется и отмечает этап только после успешного запуска
+void test_boot_sequence()
+{
+    kernel.addTask(task0, 1000, 0);
+    TEST_ASSERT_TRUE(Boot::defer(retryOnce, Boot::STAGE_LOGGER));
+    TEST_ASSERT_TRUE(Boot::defer(task2, Boot::STAGE_DISPLAY));
+    TEST_ASSERT_TRUE(Boot::start());
+    kernel.begin();
+
+    kernel.run();
+    TEST_ASSERT_EQUAL_UINT8(2, orderCount);
+    TEST_ASSERT_EQUAL_UINT8(0, order[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, order[1]);
+    TEST_ASSERT_TRUE(Boot::isMarked(Boot::STAGE_FIRST_TASK));
+    TEST_ASSERT_FALSE(Boot::isMarked(Boot::STAGE_LOGGER));
+
+    perf::runFor(OS_BOOT_STEP_MS * 3);
+    TEST_ASSERT_EQUAL_UINT8(4, orderCount);
+    TEST_ASSERT_EQUAL_UINT8(1, order[2]);
+    TEST_ASSERT_EQUAL_UINT8(2, order[3]);
+    TEST_ASSERT_TRUE(Boot::isMarked(Boot::STAGE_READY));
+    TEST_ASSERT_TRUE(Boot::stageTime(Boot::STAGE_DISPLAY) - Boot::stageTime(Boot::STAGE_LOGGER) >= OS_BOOT_STEP_MS * 1000UL);
+
+    TaskInfo info;
+    TEST_ASSERT_TRUE(kernel.getTaskInfo(1, info));
+    TEST_ASSERT_EQUAL_PTR(Boot::task, info.function);
+    TEST_ASSERT_FALSE(info.enabled);
+}
+
+// Проход run() без готовых задач
+void test_idle_pass_cycles()
+{
+    kernel.addTask(task0, 60000UL, 0);
+    kernel.addTask(task1, 60000UL, 1);
+    kernel.addTask(task2, 60000UL, 2);
+    kernel.addTask(countA, 60000UL, 3);
+    kernel.addTask(countB, 60000UL, 4);
+
+    TEST_ASSERT_CYCLES(1500, [] { kernel.run(); });
+}
+
+// Работа планировщика не выделяет память
+void test_heap_stable()
+{
+    kernel.addTask(countA, 1, 0);
+    kernel.addTask(countB, 3, 1);
+    perf::runFor(10);
+
+    int32_t before = perf::heapUsed();
+    perf::runFor(200);
+    TEST_ASSERT_EQUAL_INT32(before, perf::heapUsed());
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_period_accuracy);
+    RUN_TEST(test_busy_task_no_drift);
+    RUN_TEST(test_semaphore_wakeup);
+    RUN_TEST(test_semaphore_signal_isr);
+    RUN_TEST(test_boot_sequence);
+    RUN_TEST(test_idle_pass_cycles);
+    RUN_TEST(test_heap_stable);
+    return UNITY_END();
+}
+
+PERF_TEST_MAIN(runTests)
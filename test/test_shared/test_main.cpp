@@ -0,0 +1,91 @@
+/*
+ * Примитивы обмена данными задач и ISR (system/shared.h).
+ */
+
+#include "../perf.h"
+#include "system/shared.h"
+
+namespace
+{
+    struct Sample
+    {
+        uint32_t time;
+        uint16_t value;
+        uint8_t channel;
+    };
+
+    Shared::SeqLock<Sample> sample;
+    Shared::DoubleBuffer<Sample> config;
+    Shared::Atomic<uint16_t> counter16;
+    Shared::Atomic<int32_t> counter32;
+    Shared::Atomic<uint8_t> flag;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_seqlock()
+{
+    uint8_t version = sample.version();
+    sample.write({123456UL, 512, 3});
+    TEST_ASSERT_EQUAL_UINT8((uint8_t)(version + 2), sample.version());
+
+    Sample s;
+    TEST_ASSERT_TRUE(sample.tryRead(s));
+    TEST_ASSERT_EQUAL_UINT32(123456UL, s.time);
+    TEST_ASSERT_EQUAL_UINT16(512, sample.read().value);
+}
+
+// Запись не затрагивает буфер, который видит читатель
+void test_double_buffer()
+{
+    config.write({1, 10, 0});
+    const Sample& before = config.front();
+    config.write({2, 20, 1});
+
+    TEST_ASSERT_EQUAL_UINT32(1, before.time);
+    TEST_ASSERT_EQUAL_UINT32(2, config.read().time);
+    TEST_ASSERT_EQUAL_UINT16(20, config.front().value);
+}
+
+void test_atomic()
+{
+    counter16.store(0xFFFE);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFE, counter16.fetchAdd(3));
+    TEST_ASSERT_EQUAL_UINT16(1, counter16.load());
+
+    counter32.store(-5);
+    TEST_ASSERT_EQUAL_INT32(-5, counter32.exchange(70000L));
+    int32_t expected = 1;
+    TEST_ASSERT_FALSE(counter32.compareExchange(expected, 2));
+    TEST_ASSERT_EQUAL_INT32(70000L, expected);
+    TEST_ASSERT_TRUE(counter32.compareExchange(expected, 2));
+    TEST_ASSERT_EQUAL_INT32(2, counter32);
+
+    flag.store(1);
+    TEST_ASSERT_EQUAL_UINT8(1, flag.load());
+}
+
+// Чтение SeqLock без записи в ISR не повторяется; Atomic держит
+// прерывания запрещёнными на несколько тактов
+void test_cycles()
+{
+    sample.write({1, 2, 3});
+    TEST_ASSERT_CYCLES(95, [] { volatile uint16_t v = sample.read().value; (void)v; });
+    TEST_ASSERT_CYCLES(75, [] { sample.write({4, 5, 6}); });
+    TEST_ASSERT_CYCLES(35, [] { counter16.fetchAdd(1); });
+    TEST_ASSERT_CYCLES(25, [] { volatile uint16_t v = counter16.load(); (void)v; });
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_seqlock);
+    RUN_TEST(test_double_buffer);
+    RUN_TEST(test_atomic);
+    RUN_TEST(test_cycles);
+    return UNITY_END();
+}
+
+PERF_TEST_MAIN(runTests)
@@ -0,0 +1,250 @@
+/*
+ * Том на блочном устройстве: кэш блоков с отложенной записью, рост и
+ * перенос экстентов, сохранность после повторного подключения, отказ
+ * форматировать непустое устройство, файлы тома через FileSystem и лог
+ * без ограничения размера.
+ *
+ * Только env:native: устройство - файл образа (FileBlockDevice).
+ */
+
+#include "../perf.h"
+#include "fs/logger.h"
+#include "hal/native/filedev.h"
+
+#include <stdio.h>
+
+namespace
+{
+    const char* IMAGE = "test_volume.img";
+    const uint32_t BLOCKS = 256;    // 128 КБ
+
+    FileBlockDevice device;
+    // Кэш тома, подключённого к fs: живёт дольше теста
+    BlockCache volumeCache(device);
+
+    String filled(size_t length, char first = 'a')
+    {
+        String s;
+        s.reserve(length);
+        for (size_t i = 0; i < length; i++) s += (char)(first + i % 26);
+        return s;
+    }
+}
+
+void setUp()
+{
+    perf::clearTasks();
+    perf::clearFiles();
+    remove(IMAGE);
+    device.open(IMAGE, BLOCKS);
+    volumeCache.invalidate();
+}
+
+void tearDown()
+{
+    fs.unmountVolume();
+    logger.setFile("log.txt");
+    perf::clearFiles();
+    device.close();
+    remove(IMAGE);
+}
+
+// Повторные чтения горячего блока не доходят до устройства, изменения
+// записываются только при вытеснении или flush()
+void test_cache_lru()
+{
+    BlockCache cache(device);
+    TEST_ASSERT_NOT_NULL(cache.get(1));
+    for (uint8_t i = 0; i < 10; i++) cache.get(1);
+    TEST_ASSERT_EQUAL_UINT32(1, device.getReads());
+    TEST_ASSERT_EQUAL_UINT32(10, cache.getHits());
+
+    uint8_t* data = cache.modify(2, true);
+    data[0] = 0x5A;
+    TEST_ASSERT_EQUAL_UINT32(0, device.getWrites());
+
+    // Блок 1 используется чаще, вытесняется блок 2
+    for (uint32_t block = 3; block < 1 + BlockCache::SLOTS; block++)
+    {
+        cache.get(1);
+        cache.get(block);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, device.getWrites());
+    cache.get(1);
+    cache.get(100);
+    TEST_ASSERT_EQUAL_UINT32(1, device.getWrites());
+    uint32_t reads = device.getReads();
+    cache.get(1);
+    TEST_ASSERT_EQUAL_UINT32(reads, device.getReads());
+    TEST_ASSERT_EQUAL_UINT8(0x5A, cache.get(2)[0]);
+
+    TEST_ASSERT_TRUE(cache.copy(2, 50));
+    TEST_ASSERT_TRUE(cache.flush());
+    cache.invalidate();
+    TEST_ASSERT_EQUAL_UINT8(0x5A, cache.get(50)[0]);
+    TEST_ASSERT_NULL(cache.get(BLOCKS));
+}
+
+// Дописывание за пределы экстента: рост на месте или перенос с копией
+void test_volume_growth()
+{
+    BlockCache cache(device);
+    Volume volume;
+    TEST_ASSERT_FALSE(volume.mount(cache));
+    TEST_ASSERT_TRUE(volume.format(cache));
+
+    String chunk = filled(300);
+    TEST_ASSERT_TRUE(volume.write("a", (const uint8_t*)"", 0, false));
+    TEST_ASSERT_TRUE(volume.write("b", (const uint8_t*)"x", 1, false));
+    uint32_t freeBefore = volume.freeBlocks();
+
+    // "a" упирается в "b" и переносится, дальше растёт на месте
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        TEST_ASSERT_TRUE(volume.append("a", (const uint8_t*)chunk.c_str(), chunk.length()));
+    }
+    Volume::Entry entry;
+    int index = volume.find("a");
+    TEST_ASSERT_TRUE(volume.getEntry(index, entry));
+    TEST_ASSERT_EQUAL_UINT32(12000, entry.size);
+    TEST_ASSERT_TRUE(entry.start > Volume::MIN_BLOCKS);
+    TEST_ASSERT_TRUE(volume.freeBlocks() < freeBefore);
+    TEST_ASSERT_TRUE(volume.verify());
+
+    uint8_t buffer[300];
+    TEST_ASSERT_EQUAL_INT32(300, volume.read(index, 300 * 37, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY(chunk.c_str(), buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_INT32(0, volume.read(index, 12000, buffer, sizeof(buffer)));
+
+    // Место удалённого файла снова выделяется
+    TEST_ASSERT_TRUE(volume.remove("b"));
+    TEST_ASSERT_TRUE(volume.write("c", (const uint8_t*)"y", 1, true));
+    TEST_ASSERT_TRUE(volume.getEntry(volume.find("c"), entry));
+    TEST_ASSERT_EQUAL_UINT32(1, entry.start);
+
+    // Места на устройстве не хватает
+    String big = filled(BlockDevice::BLOCK_SIZE);
+    bool full = false;
+    for (uint16_t i = 0; i < BLOCKS && !full; i++)
+    {
+        full = !volume.append("a", (const uint8_t*)big.c_str(), big.length());
+    }
+    TEST_ASSERT_TRUE(full);
+    TEST_ASSERT_TRUE(volume.verify());
+}
+
+// Содержимое и каталог переживают отключение; повреждение каталога
+// обнаруживается при подключении
+void test_volume_persistence()
+{
+    {
+        BlockCache cache(device);
+        Volume volume;
+        TEST_ASSERT_TRUE(volume.format(cache));
+        String text = filled(1000);
+        TEST_ASSERT_TRUE(volume.write("data.txt", (const uint8_t*)text.c_str(), text.length(), false));
+        volume.unmount();
+    }
+
+    BlockCache cache(device);
+    Volume volume;
+    TEST_ASSERT_TRUE(volume.mount(cache));
+    uint8_t buffer[10];
+    TEST_ASSERT_EQUAL_INT32(10, volume.read(volume.find("data.txt"), 990, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_UINT8('c', buffer[0]);
+
+    uint8_t* directory = cache.modify(0);
+    directory[Volume::HEADER_SIZE] ^= 0x01;
+    TEST_ASSERT_FALSE(volume.verify());
+    TEST_ASSERT_TRUE(cache.flush());
+    cache.invalidate();
+    TEST_ASSERT_FALSE(volume.mount(cache));
+
+    // Непустое устройство без тома не форматируется и не записывается
+    uint32_t writes = device.getWrites();
+    TEST_ASSERT_FALSE(Volume::isBlank(cache));
+    TEST_ASSERT_FALSE(fs.mountVolume(cache, true));
+    TEST_ASSERT_FALSE(fs.isVolumeMounted());
+    TEST_ASSERT_TRUE(cache.flush());
+    TEST_ASSERT_EQUAL_UINT32(writes, device.getWrites());
+}
+
+// Файлы тома через FileSystem: без ограничения MAX_FILE_SIZE, отдельно от RAM
+void test_fs_volume_files()
+{
+    TEST_ASSERT_FALSE(fs.createFile("/early.txt", "x"));
+    TEST_ASSERT_TRUE(fs.mountVolume(volumeCache, true));
+    TEST_ASSERT_TRUE(fs.isVolumeMounted());
+
+    TEST_ASSERT_TRUE(fs.createFile("/a.txt", "hello"));
+    TEST_ASSERT_FALSE(fs.createFile("/a.txt", "again"));
+    TEST_ASSERT_TRUE(fs.fileExists("/a.txt"));
+    TEST_ASSERT_FALSE(fs.fileExists("a.txt"));
+    TEST_ASSERT_EQUAL_STRING("hello", fs.readFile("/a.txt").c_str());
+
+    String chunk = filled(FileSystem::MAX_FILE_SIZE);
+    TEST_ASSERT_TRUE(fs.appendFile("/a.txt", chunk));
+    TEST_ASSERT_TRUE(fs.appendFile("/a.txt", chunk));
+    // Больше MAX_FILE_SIZE целиком не читается, только по частям
+    TEST_ASSERT_EQUAL_STRING("", fs.readFile("/a.txt").c_str());
+    uint8_t buffer[5];
+    TEST_ASSERT_EQUAL_INT32(5, fs.readAt("/a.txt", 0, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("hello", buffer, 5);
+    TEST_ASSERT_EQUAL_INT32(-1, fs.readAt("/none", 0, buffer, sizeof(buffer)));
+
+    uint8_t data[4] = {1, 2, 3, 4};
+    TEST_ASSERT_TRUE(fs.writeBinaryFile("/b.bin", data, sizeof(data)));
+    uint8_t back[4];
+    TEST_ASSERT_TRUE(fs.readBinaryFile("/b.bin", back, sizeof(back)));
+    TEST_ASSERT_EQUAL_MEMORY(data, back, sizeof(data));
+    TEST_ASSERT_FALSE(fs.appendFile("/b.bin", "x"));
+
+    TEST_ASSERT_TRUE(fs.listFiles().indexOf("/a.txt (vol text, 1029 bytes)") >= 0);
+    TEST_ASSERT_TRUE(fs.verifyFilesystem());
+    TEST_ASSERT_TRUE(fs.deleteFile("/b.bin"));
+    TEST_ASSERT_FALSE(fs.fileExists("/b.bin"));
+
+    // Изменения остаются в кэше до sync()
+    TEST_ASSERT_TRUE(fs.sync());
+    uint32_t writes = device.getWrites();
+    TEST_ASSERT_TRUE(fs.writeFile("/a.txt", "short"));
+    TEST_ASSERT_EQUAL_UINT32(writes, device.getWrites());
+    TEST_ASSERT_TRUE(fs.sync());
+    TEST_ASSERT_TRUE(device.getWrites() > writes);
+}
+
+// Лог на томе растёт дальше MAX_LOG_SIZE без удаления старых записей
+void test_logger_on_volume()
+{
+    TEST_ASSERT_TRUE(fs.mountVolume(volumeCache, true));
+    logger.setFile("/log.txt");
+    logger.begin();
+    for (uint16_t i = 0; i < 100; i++)
+    {
+        logger.log("INFO: entry " + String(i));
+    }
+
+    uint8_t buffer[64];
+    int32_t count = fs.readAt("/log.txt", 0, buffer, sizeof(buffer) - 1);
+    TEST_ASSERT_TRUE(count > 0);
+    buffer[count] = 0;
+    TEST_ASSERT_TRUE(strstr((const char*)buffer, "INFO: entry 0\n") != nullptr);
+
+    Volume::Entry entry;
+    TEST_ASSERT_TRUE(fs.getVolume().getEntry(fs.getVolume().find("log.txt"), entry));
+    TEST_ASSERT_TRUE(entry.size > (uint32_t)Logger::MAX_LOG_SIZE);
+    TEST_ASSERT_FALSE(fs.fileExists("log.txt"));
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cache_lru);
+    RUN_TEST(test_volume_growth);
+    RUN_TEST(test_volume_persistence);
+    RUN_TEST(test_fs_volume_files);
+    RUN_TEST(test_logger_on_volume);
+    return UNITY_END();
+}
+
+PERF_TEST_MAIN(runTests)
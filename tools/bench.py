@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+Бенчмарки ядра под simavr: такты на операцию и занимаемая память.
+
+  tools/bench.py run [--out bench.json] [--baseline base.json] [--threshold 5]
+  tools/bench.py compare base.json new.json [--threshold 5]
+
+run собирает env:bench (bench/bench_main.cpp), запускает прошивку в simavr,
+разбирает строки BENCH и пишет JSON с тактами и размерами секций ELF
+(.text/.data/.bss) для прошивки бенчмарков и для env:uno. С --baseline
+сразу сравнивает с сохранённым результатом.
+
+compare печатает разницу и завершается с кодом 1, если минимальные такты
+или размер flash/SRAM выросли больше порога (в процентах).
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+ANSI = re.compile(r"\x1b\[[0-9;]*m")
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+def elf_sections(path):
+    """Размеры размещаемых секций ELF32 (little-endian, как у avr-gcc)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1:
+        raise ValueError("%s: not an ELF32 file" % path)
+    shoff, = struct.unpack_from("<I", data, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+
+    headers = []
+    for i in range(shnum):
+        name, stype, flags, _addr, offset, size = struct.unpack_from("<IIIIII", data, shoff + i * shentsize)
+        headers.append((name, stype, flags, offset, size))
+    strtab_offset = headers[shstrndx][3]
+
+    sections = {}
+    for name, stype, flags, _offset, size in headers:
+        if not flags & SHF_ALLOC:
+            continue
+        end = data.index(b"\0", strtab_offset + name)
+        sections[data[strtab_offset + name:end].decode()] = size
+    return sections
+
+
+def footprint(path):
+    """Flash = .text + .data (начальные значения), SRAM = .data + .bss."""
+    sections = elf_sections(path)
+    text = sections.get(".text", 0)
+    data = sections.get(".data", 0)
+    bss = sections.get(".bss", 0) + sections.get(".noinit", 0)
+    return {"flash": text + data, "sram": data + bss, "sections": sections}
+
+
+def parse_output(text):
+    results = {"benchmarks": {}, "free_memory": None, "complete": False}
+    for line in ANSI.sub("", text).splitlines():
+        fields = line.strip().split()
+        if len(fields) == 6 and fields[0] == "BENCH":
+            reps, cmin, cavg, cmax = (int(v) for v in fields[2:])
+            results["benchmarks"][fields[1]] = {"reps": reps, "min": cmin, "avg": cavg, "max": cmax}
+        elif len(fields) == 2 and fields[0] == "MEM":
+            results["free_memory"] = int(fields[1])
+        elif fields == ["BENCH_DONE"]:
+            results["complete"] = True
+    return results
+
+
+def build(env):
+    subprocess.run(["pio", "run", "-e", env], cwd=ROOT, check=True)
+    return os.path.join(ROOT, ".pio", "build", env, "firmware.elf")
+
+
+def run(args):
+    elf = build("bench") if not args.no_build else os.path.join(ROOT, ".pio", "build", "bench", "firmware.elf")
+    cmd = [args.simavr, "-m", args.mcu, "-f", str(args.freq), elf]
+    proc = subprocess.run(cmd, cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          timeout=args.timeout, universal_newlines=True, errors="replace")
+    results = parse_output(proc.stdout)
+    if not results["complete"]:
+        sys.stderr.write(proc.stdout)
+        sys.exit("bench: simavr output has no BENCH_DONE")
+
+    results["mcu"] = args.mcu
+    results["f_cpu"] = args.freq
+    results["footprint"] = {"bench": footprint(elf)}
+    uno = build("uno") if not args.no_build else os.path.join(ROOT, ".pio", "build", "uno", "firmware.elf")
+    if os.path.exists(uno):
+        results["footprint"]["uno"] = footprint(uno)
+    del results["complete"]
+
+    with open(args.out, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print_results(results)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            return compare_results(json.load(f), results, args.threshold)
+    return 0
+
+
+def print_results(results):
+    print("%-16s %6s %10s %10s %10s" % ("benchmark", "reps", "min", "avg", "max"))
+    for name, r in results["benchmarks"].items():
+        print("%-16s %6d %10d %10d %10d" % (name, r["reps"], r["min"], r["avg"], r["max"]))
+    for target, fp in sorted(results["footprint"].items()):
+        print("%-16s flash %6d  sram %5d" % (target, fp["flash"], fp["sram"]))
+
+
+def delta(old, new):
+    return 100.0 * (new - old) / old if old else (0.0 if new == old else float("inf"))
+
+
+def compare_results(base, new, threshold):
+    regressions = 0
+    print("%-16s %10s %10s %8s" % ("benchmark", "base", "new", "delta"))
+    for name, r in sorted(new["benchmarks"].items()):
+        if name not in base.get("benchmarks", {}):
+            print("%-16s %10s %10d %8s" % (name, "-", r["min"], "new"))
+            continue
+        old = base["benchmarks"][name]["min"]
+        d = delta(old, r["min"])
+        mark = ""
+        if d > threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        print("%-16s %10d %10d %+7.1f%%%s" % (name, old, r["min"], d, mark))
+    for name in sorted(set(base.get("benchmarks", {})) - set(new["benchmarks"])):
+        print("%-16s %10d %10s %8s" % (name, base["benchmarks"][name]["min"], "-", "removed"))
+
+    for target, fp in sorted(new.get("footprint", {}).items()):
+        old_fp = base.get("footprint", {}).get(target)
+        if not old_fp:
+            continue
+        for key in ("flash", "sram"):
+            d = delta(old_fp[key], fp[key])
+            mark = ""
+            if d > threshold:
+                mark = "  REGRESSION"
+                regressions += 1
+            print("%-16s %10d %10d %+7.1f%%%s" % (target + "." + key, old_fp[key], fp[key], d, mark))
+
+    if regressions:
+        print("%d regression(s) above %.1f%%" % (regressions, threshold))
+        return 1
+    return 0
+
+
+def compare(args):
+    with open(args.base) as f:
+        base = json.load(f)
+    with open(args.new) as f:
+        new = json.load(f)
+    return compare_results(base, new, args.threshold)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="simavr cycle benchmarks")
+    sub = parser.add_subparsers(dest="command")
+    sub.required = True
+
+    p = sub.add_parser("run", help="build, run under simavr and save results")
+    p.add_argument("--out", default="bench.json")
+    p.add_argument("--baseline", help="compare with a previous result")
+    p.add_argument("--threshold", type=float, default=5.0, help="allowed growth, %%")
+    p.add_argument("--simavr", default="simavr")
+    p.add_argument("--mcu", default="atmega328p")
+    p.add_argument("--freq", type=int, default=16000000)
+    p.add_argument("--timeout", type=int, default=120, help="simavr wall-clock limit, s")
+    p.add_argument("--no-build", action="store_true", help="use existing .pio/build ELF files")
+    p.set_defaults(func=run)
+
+    p = sub.add_parser("compare", help="compare two result files")
+    p.add_argument("base")
+    p.add_argument("new")
+    p.add_argument("--threshold", type=float, default=5.0, help="allowed growth, %%")
+    p.set_defaults(func=compare)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+Декодер двоичной телеметрии (system/telemetry.h).
+
+  tools/telemetry_decode.py capture.bin [--json]
+  tools/telemetry_decode.py --port /dev/ttyUSB0 [--baud 250000] [--json]
+  [--messages src/fs/logmsg.h]
+
+Кадры разделены байтом 0x00 и закодированы COBS, внутри -
+type:u8 | seq:u8 | тело | crc:u16 (CRC-16/CCITT-FALSE, little-endian).
+Фрагменты, не являющиеся кадрами (текст Serial при загрузке), выводятся
+как есть. Пропуски seq - кадры, отброшенные при заполненном буфере UART.
+Записи лога с номером сообщения (REC_LOG_ID) раскрываются по словарю -
+списку OS_LOG_MESSAGES из fs/logmsg.h той же сборки. Для --port нужен
+pyserial.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+REC_TASK, REC_SYSTEM, REC_MEMORY, REC_LOG, REC_COUNTER, REC_LOG_ID = range(1, 7)
+
+# Порядок полей как в структурах *Body в telemetry.h
+BODIES = {
+    REC_TASK: ("task", struct.Struct("<BBIIIIIHHH"),
+               ["index", "enabled", "period", "runs", "last_us", "max_us", "jitter_us",
+                "overruns", "misses", "load_permille"]),
+    REC_SYSTEM: ("system", struct.Struct("<IIHBBHH"),
+                 ["uptime_ms", "idle_ms", "load_permille", "tasks", "files", "vcc_mv", "dropped"]),
+    REC_MEMORY: ("memory", struct.Struct("<hHHB"),
+                 ["free", "heap_free", "largest", "fragments"]),
+    REC_COUNTER: ("counter", struct.Struct("<Bi"), ["id", "value"]),
+}
+LOG_LEVELS = ["INFO", "WARN", "ERR"]
+DEFAULT_MESSAGES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "fs", "logmsg.h")
+
+
+def load_messages(path):
+    """Словарь сообщений: номер -> (уровень, формат) в порядке X(...) списка."""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    pattern = re.compile(r'X\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+    return [(level, fmt) for _, level, fmt in pattern.findall(text)]
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while pos < len(data):
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+    return None, pos
+
+
+def expand_record(body, messages):
+    """Запись Logger (номер | время | аргументы) -> (уровень, время, текст)."""
+    msg_id = body[0]
+    millis, pos = read_varint(body, 1)
+    if msg_id >= len(messages):
+        return "?", millis, "message %d %s" % (msg_id, body[pos:].hex())
+    level, fmt = messages[msg_id]
+    out = []
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        i += 1
+        if c != "%" or i >= len(fmt):
+            out.append(c)
+            continue
+        spec = fmt[i]
+        i += 1
+        if spec == "d":
+            value, pos = read_varint(body, pos)
+            out.append("?" if value is None else str((value >> 1) ^ -(value & 1)))
+        elif spec == "s":
+            size = body[pos] if pos < len(body) else 0
+            out.append(body[pos + 1:pos + 1 + size].decode("ascii", "replace"))
+            pos += 1 + size
+        elif spec == "%":
+            out.append("%")
+    return level, millis, "".join(out)
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse_frame(chunk, messages=()):
+    """Кадр -> dict или None, если фрагмент не является кадром."""
+    raw = cobs_decode(chunk)
+    if raw is None or len(raw) < 4:
+        return None
+    payload, crc = raw[:-2], struct.unpack("<H", raw[-2:])[0]
+    if crc16(payload) != crc:
+        return None
+    rtype, seq, body = payload[0], payload[1], payload[2:]
+    if rtype == REC_LOG and body:
+        level = LOG_LEVELS[body[0]] if body[0] < len(LOG_LEVELS) else str(body[0])
+        return {"type": "log", "seq": seq, "level": level,
+                "text": body[1:].decode("ascii", "replace")}
+    if rtype == REC_LOG_ID and body:
+        level, millis, text = expand_record(body, messages)
+        return {"type": "log", "seq": seq, "level": level, "id": body[0], "ms": millis, "text": text}
+    if rtype in BODIES:
+        name, layout, fields = BODIES[rtype]
+        if len(body) != layout.size:
+            return None
+        record = {"type": name, "seq": seq}
+        record.update(zip(fields, layout.unpack(body)))
+        return record
+    return None
+
+
+def format_record(record):
+    kind = record["type"]
+    if kind == "log":
+        text = record["text"]
+        if "ms" in record:
+            return "log [%(ms)s ms] %(level)s: %(text)s" % record
+        return "log " + (text if text.startswith(record["level"]) else record["level"] + ": " + text)
+    if kind == "task":
+        return ("task %(index)d%(flag)s period=%(period)d runs=%(runs)d last=%(last_us)dus "
+                "max=%(max_us)dus jitter=%(jitter_us)dus ovr=%(overruns)d miss=%(misses)d "
+                "load=%(load)s%%") % dict(record, flag="" if record["enabled"] else "-",
+                                          load=record["load_permille"] / 10)
+    if kind == "system":
+        return ("system uptime=%(uptime_ms)dms idle=%(idle_ms)dms load=%(load)s%% tasks=%(tasks)d "
+                "files=%(files)d vcc=%(vcc_mv)dmV dropped=%(dropped)d") % dict(
+                    record, load=record["load_permille"] / 10)
+    if kind == "memory":
+        return ("memory free=%(free)d heap_free=%(heap_free)d largest=%(largest)d "
+                "fragments=%(fragments)d") % record
+    return "counter %(id)d = %(value)d" % record
+
+
+class Decoder:
+    def __init__(self, as_json, out, messages=()):
+        self.as_json = as_json
+        self.messages = messages
+        self.out = out
+        self.buffer = bytearray()
+        self.last_seq = None
+        self.lost = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            end = self.buffer.find(b"\x00")
+            if end < 0:
+                return
+            chunk = bytes(self.buffer[:end])
+            del self.buffer[:end + 1]
+            if chunk:
+                self.handle(chunk)
+
+    def handle(self, chunk):
+        record = parse_frame(chunk, self.messages)
+        if record is None and b"\n" in chunk:
+            # Текстовая строка перед кадром без разделителя
+            text, chunk = chunk.rsplit(b"\n", 1)
+            self.text(text)
+            record = parse_frame(chunk, self.messages)
+        if record is None:
+            self.text(chunk)
+            return
+        if self.last_seq is not None:
+            self.lost += (record["seq"] - self.last_seq - 1) & 0xFF
+        self.last_seq = record["seq"]
+        if self.as_json:
+            self.out.write(json.dumps(record) + "\n")
+        else:
+            self.out.write(format_record(record) + "\n")
+        self.out.flush()
+
+    def text(self, chunk):
+        text = chunk.decode("ascii", "replace").strip()
+        if text and not self.as_json:
+            self.out.write(text + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="файл с сырым потоком Serial")
+    parser.add_argument("--port", help="последовательный порт вместо файла")
+    parser.add_argument("--baud", type=int, default=250000)
+    parser.add_argument("--json", action="store_true", help="по записи JSON на строку")
+    parser.add_argument("--messages", default=DEFAULT_MESSAGES, help="словарь сообщений лога (fs/logmsg.h)")
+    args = parser.parse_args()
+
+    messages = load_messages(args.messages) if os.path.exists(args.messages) else []
+    decoder = Decoder(args.json, sys.stdout, messages)
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            try:
+                while True:
+                    decoder.feed(port.read(256))
+            except KeyboardInterrupt:
+                pass
+    else:
+        if not args.capture:
+            parser.error("нужен файл захвата или --port")
+        with open(args.capture, "rb") as f:
+            decoder.feed(f.read())
+    if decoder.lost:
+        sys.stderr.write("lost frames: %d\n" % decoder.lost)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+Декодер двоичной трассы ядра (system/trace.h) в Chrome/Perfetto JSON.
+
+  tools/trace_decode.py capture.bin -o trace.json [--tasks 0=counter,1=led]
+  tools/trace_decode.py capture.bin --list
+
+Вход - сырой поток Serial (например, cat /dev/ttyUSB0 > capture.bin),
+текст между блоками пропускается. Полученный JSON открывается в
+ui.perfetto.dev или chrome://tracing: задачи, операции ФС и логгера -
+вложенные интервалы на дорожке "kernel", прерывания - на дорожке "irq",
+семафоры, перегрузки и аварийный дамп - отметки.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"TRC\x01"
+HEADER = struct.Struct("<HHI")
+
+(EV_SYNC, EV_TASK_START, EV_TASK_STOP, EV_SEM_WAIT, EV_SEM_SIGNAL, EV_IRQ_ENTER, EV_IRQ_EXIT,
+ EV_FS_BEGIN, EV_FS_END, EV_LOG_BEGIN, EV_LOG_END, EV_OVERRUN, EV_DUMP, EV_MARK) = range(14)
+
+# Порядок как в IrqStats::Vector
+VECTORS = ["TIMER1_COMPA", "TIMER1_COMPB", "TIMER2_COMPA", "TIMER2_COMPB", "WDT", "INT0", "INT1",
+           "PCINT0", "PCINT2", "TIMER1_CAPT", "ADC", "SPI_STC", "TWI"]
+FS_OPS = ["fs create", "fs read", "fs write", "fs delete", "fs verify"]
+LOG_LEVELS = ["log", "log WARN", "log ERR"]
+
+TID_KERNEL = 1
+TID_IRQ = 2
+
+
+def xor(data):
+    value = 0
+    for b in data:
+        value ^= b
+    return value
+
+
+def parse_blocks(data):
+    """Блоки трассы из потока: (lost, base, [(type, arg, stamp)])."""
+    pos = 0
+    while True:
+        pos = data.find(MAGIC, pos)
+        if pos < 0:
+            return
+        start = pos + len(MAGIC)
+        if start + HEADER.size > len(data):
+            return
+        count, lost, base = HEADER.unpack_from(data, start)
+        end = start + HEADER.size + 4 * count
+        if end + 1 > len(data) or xor(data[start:end]) != data[end]:
+            pos += 1
+            continue
+        events = [struct.unpack_from("<BBH", data, start + HEADER.size + 4 * i) for i in range(count)]
+        yield lost, base, events
+        pos = end + 1
+
+
+def decode(data):
+    """Список (время в мкс, тип, аргумент) и количество потерянных событий."""
+    timeline = []
+    lost_total = 0
+    epoch = 0
+    last = None
+    for lost, base, events in parse_blocks(data):
+        lost_total += lost
+        # Раскрытие переполнения 32-битного времени (~71 мин) между блоками
+        absolute_base = epoch + base
+        if last is not None and absolute_base < last - (1 << 31):
+            epoch += 1 << 32
+            absolute_base += 1 << 32
+        prev = absolute_base
+        for etype, arg, stamp in events:
+            if etype == EV_SYNC:
+                sync = epoch + ((arg << 24) | (stamp << 8))
+                if sync < prev - (1 << 31):
+                    epoch += 1 << 32
+                    sync += 1 << 32
+                prev = sync
+                continue
+            prev += (stamp - prev) & 0xFFFF
+            timeline.append((prev, etype, arg))
+        last = prev
+    return timeline, lost_total
+
+
+def name_of(table, index, prefix):
+    return table[index] if index < len(table) else "%s %d" % (prefix, index)
+
+
+def to_chrome(timeline, task_names):
+    out = [
+        {"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "ATmega328P"}},
+        {"ph": "M", "pid": 1, "tid": TID_KERNEL, "name": "thread_name", "args": {"name": "kernel"}},
+        {"ph": "M", "pid": 1, "tid": TID_IRQ, "name": "thread_name", "args": {"name": "irq"}},
+    ]
+    stacks = {TID_KERNEL: [], TID_IRQ: []}
+
+    def begin(ts, tid, name, key):
+        stacks[tid].append(key)
+        out.append({"ph": "B", "pid": 1, "tid": tid, "ts": ts, "name": name})
+
+    def end(ts, tid, key):
+        # Начало интервала могло быть потеряно при переполнении буфера
+        if key not in stacks[tid]:
+            return
+        while stacks[tid]:
+            top = stacks[tid].pop()
+            out.append({"ph": "E", "pid": 1, "tid": tid, "ts": ts})
+            if top == key:
+                break
+
+    def instant(ts, name, scope="t", args=None):
+        event = {"ph": "i", "pid": 1, "tid": TID_KERNEL, "ts": ts, "name": name, "s": scope}
+        if args:
+            event["args"] = args
+        out.append(event)
+
+    for ts, etype, arg in timeline:
+        if etype == EV_TASK_START:
+            begin(ts, TID_KERNEL, task_names.get(arg, "task %d" % arg), ("task", arg))
+        elif etype == EV_TASK_STOP:
+            end(ts, TID_KERNEL, ("task", arg))
+        elif etype == EV_FS_BEGIN:
+            begin(ts, TID_KERNEL, name_of(FS_OPS, arg, "fs op"), ("fs", arg))
+        elif etype == EV_FS_END:
+            end(ts, TID_KERNEL, ("fs", arg))
+        elif etype == EV_LOG_BEGIN:
+            begin(ts, TID_KERNEL, name_of(LOG_LEVELS, arg, "log"), ("log", arg))
+        elif etype == EV_LOG_END:
+            end(ts, TID_KERNEL, ("log", arg))
+        elif etype == EV_IRQ_ENTER:
+            begin(ts, TID_IRQ, name_of(VECTORS, arg, "vector"), ("irq", arg))
+        elif etype == EV_IRQ_EXIT:
+            end(ts, TID_IRQ, ("irq", arg))
+        elif etype == EV_SEM_WAIT:
+            blocked = bool(arg & 0x80)
+            instant(ts, "sem_wait %d" % (arg & 0x7F), args={"blocked": blocked})
+        elif etype == EV_SEM_SIGNAL:
+            instant(ts, "sem_signal %d" % arg)
+        elif etype == EV_OVERRUN:
+            instant(ts, "overrun " + task_names.get(arg, "task %d" % arg), "g")
+        elif etype == EV_DUMP:
+            instant(ts, "emergency dump", "g")
+        elif etype == EV_MARK:
+            instant(ts, "mark %d" % arg)
+
+    if timeline:
+        last_ts = timeline[-1][0]
+        for tid, stack in stacks.items():
+            for _ in stack:
+                out.append({"ph": "E", "pid": 1, "tid": tid, "ts": last_ts, "args": {"truncated": True}})
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+EVENT_NAMES = ["sync", "task_start", "task_stop", "sem_wait", "sem_signal", "irq_enter", "irq_exit",
+               "fs_begin", "fs_end", "log_begin", "log_end", "overrun", "dump", "mark"]
+
+
+def parse_tasks(text):
+    names = {}
+    if text:
+        for item in text.split(","):
+            index, _, name = item.partition("=")
+            names[int(index)] = name
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode kernel binary trace")
+    parser.add_argument("input", help="raw serial capture, '-' for stdin")
+    parser.add_argument("-o", "--out", help="Chrome/Perfetto JSON (default stdout)")
+    parser.add_argument("--tasks", help="task names by index: 0=counter,1=led")
+    parser.add_argument("--list", action="store_true", help="print events as text")
+    args = parser.parse_args()
+
+    if args.input == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+
+    timeline, lost = decode(data)
+    if lost:
+        sys.stderr.write("trace: %d event(s) lost\n" % lost)
+
+    if args.list:
+        for ts, etype, arg in timeline:
+            name = EVENT_NAMES[etype] if etype < len(EVENT_NAMES) else "type %d" % etype
+            print("%12.3f ms  %-10s %d" % (ts / 1000.0, name, arg))
+        return
+
+    result = to_chrome(timeline, parse_tasks(args.tasks))
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(result, f)
+    else:
+        json.dump(result, sys.stdout)
+        sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()